@@ -77,7 +77,7 @@ public:
 			auto texture = _device->createTexture
 			({
 				.usage = TextureUsage::ColorAttachment | TextureUsage::Sampled | TextureUsage::CopyDst,
-				.format = _swapchain->getFormat(),
+				.format = _desc.format,
 				.width = getWidth() / (uint32_t)pow(2, i),
 				.height = getHeight() / (uint32_t)pow(2, i),
 				.name = fmt::format("blurTexture{}", i)
@@ -108,7 +108,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.bindSetLayouts = { tex1BindSetLayout },
-				.colorFormats = { _swapchain->getFormat() }
+				.colorFormats = { _desc.format }
 			});
 		}
 
@@ -122,7 +122,7 @@ public:
 				.pushConstantLayout = { sizeof(Param), 0, 0 },
 				.bindSetLayouts = { tex1BindSetLayout },
 				.vertexAttributes ={{ .location = 0, .semantic = "POSITION", .format = Format::RG32Sfloat }},
-				.colorFormats = { _swapchain->getFormat() }
+				.colorFormats = { _desc.format }
 			});
 		}
 
@@ -136,7 +136,7 @@ public:
 				.pushConstantLayout = { sizeof(Param), 0, 0 },
 				.bindSetLayouts = { tex1BindSetLayout },
 				.vertexAttributes = {{.location = 0, .semantic = "POSITION", .format = Format::RG32Sfloat }},
-				.colorFormats = { _swapchain->getFormat() }
+				.colorFormats = { _desc.format }
 			});
 		}
 
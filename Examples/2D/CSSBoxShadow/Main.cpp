@@ -36,7 +36,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.pushConstantLayout = { sizeof(float) * 10 },
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -49,7 +49,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.pushConstantLayout = { sizeof(float) * 18 },
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -177,7 +177,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.bindSetLayouts = { tex1BindSetLayout },
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -195,7 +195,7 @@ public:
 					{ .location = 0, .semantic = "POSITION", .offset = offsetof(Vertex, x), .format = Format::RG32Sfloat },
 					{ .location = 1, .semantic = "TEXCOORD", .offset = offsetof(Vertex, u), .format = Format::RG32Sfloat }
 				},
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -139,7 +139,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.bindSetLayouts = { tex1BindSetLayout },
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
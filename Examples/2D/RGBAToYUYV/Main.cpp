@@ -1,5 +1,5 @@
 #include "WindowApp.h"
-#include "StagingBuffer.h"
+#include "AsyncReadback.h"
 
 #include <imgui/imgui.h>
 
@@ -23,6 +23,7 @@ public:
 	std::shared_ptr<BindSet> yuyvBindSet;
 	std::shared_ptr<Texture> yuyvTexture;
 	std::shared_ptr<TextureView> yuyvTextureView;
+	bool saveRequested = false;
 
 	void onSetup() override
 	{
@@ -40,7 +41,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.bindSetLayouts = { tex1BindSetLayout },
-				.colorFormats = { _swapchain->getFormat() }
+				.colorFormats = { _desc.format }
 			});
 		}
 
@@ -83,26 +84,28 @@ public:
 
 	void onImGui() override
 	{
-		if (ImGui::Button("Save")){
-			auto imageDataSize = rgbaWidth * rgbaHeight * 2;
-			std::vector<uint8_t> imageData(imageDataSize);
-			StagingBuffer::getReadbackGlobal().readbackTexture(yuyvTexture, imageData.data(), imageData.size());
-			{
-				std::string file_name = fmt::format("output_{}x{}.yuv", rgbaWidth, rgbaHeight);
-				std::ofstream file(file_name, std::ios::binary);
-				assert(file);
-				file.write(reinterpret_cast<const char*>(imageData.data()), imageData.size());
-				assert(file);
-				file.close();
-			}
-			{
-				std::string file_name = fmt::format("output_{}x{}.rgb", yuyvWidth, yuyvHeight);
-				std::ofstream file(file_name, std::ios::binary);
-				assert(file);
-				file.write(reinterpret_cast<const char*>(imageData.data()), imageData.size());
-				assert(file);
-				file.close();
-			}
+		// 回读在渲染时记录，几帧后写文件
+		if (ImGui::Button("Save"))
+			saveRequested = true;
+	}
+
+	void saveImage(const void* imageData, size_t imageDataSize)
+	{
+		{
+			std::string file_name = fmt::format("output_{}x{}.yuv", rgbaWidth, rgbaHeight);
+			std::ofstream file(file_name, std::ios::binary);
+			assert(file);
+			file.write(reinterpret_cast<const char*>(imageData), imageDataSize);
+			assert(file);
+			file.close();
+		}
+		{
+			std::string file_name = fmt::format("output_{}x{}.rgb", yuyvWidth, yuyvHeight);
+			std::ofstream file(file_name, std::ios::binary);
+			assert(file);
+			file.write(reinterpret_cast<const char*>(imageData), imageDataSize);
+			assert(file);
+			file.close();
 		}
 	}
 
@@ -125,6 +128,12 @@ public:
 		commandList->draw(3);
 		commandList->endRenderPass();
 		commandList->resourceBarrier({ yuyvTexture, TextureState::ColorAttachment, TextureState::ShaderRead });
+		if (saveRequested)
+		{
+			AsyncReadback::singleton().readbackTexture(*commandList, yuyvTexture, rgbaWidth * rgbaHeight * 2,
+				[this](const void* data, size_t size) { saveImage(data, size); });
+			saveRequested = false;
+		}
 		commandList->endLabel();
 
 		// Draw yuyv
@@ -176,7 +176,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.bindSetLayouts = { tex1BindSetLayout },
-				.colorFormats = { _swapchain->getFormat() }
+				.colorFormats = { _desc.format }
 			});
 		}
 		{
@@ -192,7 +192,7 @@ public:
 				{
 					{.location = 0, .semantic = "POSITION", .format = Format::RG32Sfloat }
 				},
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -208,7 +208,7 @@ public:
 				{
 					{.location = 0, .semantic = "POSITION", .format = Format::RG32Sfloat }
 				},
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -224,7 +224,7 @@ public:
 				{
 					{.location = 0, .semantic = "POSITION", .format = Format::RG32Sfloat }
 				},
-				.colorFormats = { _swapchain->getFormat() },
+				.colorFormats = { _desc.format },
 				.colorBlends = {{ true }}
 			});
 		}
@@ -47,10 +47,9 @@ public:
 	Param param;
 	std::shared_ptr<Buffer> paramBuffer;
 
+	std::shared_ptr<RenderGraphResourcePool> resourcePool;
 	std::unique_ptr<RenderGraph> renderGraph;
 	RenderGraphScope scope;
-	RenderGraphResource lastTaa = 0;
-	RenderGraphResource nextTaa = 0;
 
 	Camera camera;
 	CameraControl cameraControl;
@@ -59,9 +58,6 @@ public:
 	{
 		auto& registry = renderGraph->getRegistry();
 		RenderGraphResource paramBuffer = registry.importBuffer(this->paramBuffer, "Param");
-		// 指向同一份资源，防止图出现循环
-		lastTaa = registry.importTexture(nullptr, nullptr, "LastTAA");
-		nextTaa = registry.importTexture(nullptr, nullptr, "NextTAA");
 
 		struct GBufferOut
 		{
@@ -76,51 +72,21 @@ public:
 				builder.read(paramBuffer);
 
 				RenderGraphResource outPosition = builder.createTexture({ .format = Format::RGBA16Sfloat, .name = "Position" });
-				builder.write(outPosition);
+				builder.writeColorAttachment(outPosition, LoadOp::Clear, { 0.0f, 0.0f, 0.0f, 1.0f });
 				RenderGraphResource outNormal = builder.createTexture({ .format = Format::RGBA16Sfloat, .name = "Normal" });
-				builder.write(outNormal);
+				builder.writeColorAttachment(outNormal, LoadOp::Clear);
 				RenderGraphResource outBaseColor = builder.createTexture({ .format = Format::RGBA8Unorm, .name = "BaseColor" });
-				builder.write(outBaseColor);
+				builder.writeColorAttachment(outBaseColor, LoadOp::Clear);
 				RenderGraphResource outVelocity = builder.createTexture({ .format = Format::RG32Sfloat, .name = "Velocity" });
-				builder.write(outVelocity);
+				builder.writeColorAttachment(outVelocity, LoadOp::Clear);
 				RenderGraphResource outDepth = builder.createTexture({ .format = Format::D32Sfloat, .name = "Depth" });
-				builder.write(outDepth);
+				builder.writeDepthAttachment(outDepth, LoadOp::Clear, 1.0f);
 				
 				scope.add<GBufferOut>({ outPosition, outNormal, outBaseColor, outVelocity, outDepth });
 
 				return [=, this](RenderGraphRegistry& registry, CommandList& commandList)
 					{
 						auto scene = Project::singleton()->getScene();
-						commandList.beginRenderPass
-						({
-							.colorAttachments =
-							{
-								{
-									.textureView = std::get<1>(registry.getTexture(outPosition)),
-									.loadOp = LoadOp::Clear,
-									.clearValue = { 0.0f, 0.0f, 0.0f, 1.0f }
-								},
-								{
-									.textureView = std::get<1>(registry.getTexture(outNormal)),
-									.loadOp = LoadOp::Clear,
-									.clearValue = { 0.0f, 0.0f, 0.0f, 0.0f }
-								},
-								{
-									.textureView = std::get<1>(registry.getTexture(outBaseColor)),
-									.loadOp = LoadOp::Clear
-								},
-								{
-									.textureView = std::get<1>(registry.getTexture(outVelocity)),
-									.loadOp = LoadOp::Clear
-								}
-							},
-							.depthAttachment =
-							{
-								.textureView = std::get<1>(registry.getTexture(outDepth)),
-								.loadOp = LoadOp::Clear,
-								.clearValue = 1.0f
-							}
-						});
 						commandList.setPipeline(gBufferPipeline);
 						commandList.setViewport(0, 0, getWidth(), getHeight());
 						commandList.setScissor(0, 0, getWidth(), getHeight());
@@ -128,7 +94,6 @@ public:
 						commandList.setVertexBuffer(0, scene->verticesBuffer);
 						commandList.setIndexBuffer(scene->indicesBuffer);
 						commandList.drawIndexedIndirect(scene->drawCommandsBuffer, scene->drawCommandCount);
-						commandList.endRenderPass();
 					};
 			});
 
@@ -145,7 +110,7 @@ public:
 				builder.read(inBaseColor);
 
 				lightResult = builder.createTexture({ .format = Format::RGBA16Sfloat, .name = "LightResult" });
-				builder.write(lightResult);
+				builder.writeColorAttachment(lightResult);
 
 				return [=, this](RenderGraphRegistry& registry, CommandList& commandList)
 					{
@@ -156,13 +121,11 @@ public:
 						UPDATE_TEXTURE_BIND(lightingBindSet, 3, inNormalTV);
 						UPDATE_TEXTURE_BIND(lightingBindSet, 4, inBaseColorTV);
 						
-						commandList.beginRenderPass({{{ .textureView = std::get<1>(registry.getTexture(lightResult)) }}});
 						commandList.setPipeline(lightingPipeline);
 						commandList.setBindSet(0, lightingBindSet);
 						commandList.setViewport(0, 0, getWidth(), getHeight());
 						commandList.setScissor(0, 0, getWidth(), getHeight());
 						commandList.draw(3);
-						commandList.endRenderPass();
 					};
 			});
 
@@ -170,14 +133,15 @@ public:
 		renderGraph->addPass("TAA", RenderGraphPassType::FrameRaster, [&](RenderGraphBuilder& builder)
 			{
 				builder.read(lightResult);
-				builder.read(lastTaa);
 				RenderGraphResource inVelocity = scope.get<GBufferOut>().velocity;
 				builder.read(inVelocity);
 				RenderGraphResource inDepth = scope.get<GBufferOut>().depth;
 				builder.read(inDepth);
 
 				taaResult = builder.createTexture({ .usage = TextureUsage::Sampled, .format = Format::RGBA16Sfloat, .name = "TaaResult" });
-				builder.write(taaResult);
+				builder.writeColorAttachment(taaResult);
+				// 上一帧的TAA结果，渲染图每帧轮换
+				RenderGraphResource lastTaa = builder.readHistory(taaResult);
 
 				return [=](RenderGraphRegistry& registry, CommandList& commandList)
 					{
@@ -190,8 +154,6 @@ public:
 						UPDATE_TEXTURE_BIND(taaBindSet, 3, inVelocityTV);
 						UPDATE_TEXTURE_BIND(taaBindSet, 4, inDepthTV);
 
-						const auto& [taaTexture, taaTextureView] = registry.getTexture(taaResult);
-						commandList.beginRenderPass({{{ .textureView = taaTextureView }}});
 						commandList.setPipeline(taaPipeline);
 						struct PushConstant
 						{
@@ -199,7 +161,7 @@ public:
 							int32_t simpleMode;
 							glm::vec2 screenSize;
 						} param;
-						param.ignoreTemporaly = (_frameTotalCount == 0);
+						param.ignoreTemporaly = !registry.isHistoryValid(lastTaa);
 						param.simpleMode = true;
 						param.screenSize = { getWidth(), getHeight() };
 						commandList.setPushConstant(&param);
@@ -207,23 +169,9 @@ public:
 						commandList.setViewport(0, 0, getWidth(), getHeight());
 						commandList.setScissor(0, 0, getWidth(), getHeight());
 						commandList.draw(3);
-						commandList.endRenderPass();
 					};
 			});
 
-		renderGraph->addPass("StoreTAA", RenderGraphPassType::Copy, [&](RenderGraphBuilder& builder)
-			{
-				builder.read(taaResult);
-				builder.write(nextTaa);
-
-				return [=](RenderGraphRegistry& registry, CommandList& commandList)
-					{
-						const auto& taaTexture = std::get<0>(registry.getTexture(taaResult));
-						const auto& temporalTexture = std::get<0>(registry.getTexture(nextTaa));
-						commandList.copyTexture(taaTexture, temporalTexture, { getWidth(), getHeight() });
-					};
-			}, true);
-
 		renderGraph->addPass("ToneMapping", RenderGraphPassType::FrameRaster, [&](RenderGraphBuilder& builder)
 			{
 				builder.read(paramBuffer);
@@ -362,7 +310,7 @@ public:
 				.vertex = vsShader,
 				.pixel = psShader,
 				.bindSetLayouts = { cbuff1tex1BindSetLayout },
-				.colorFormats = { _swapchain->getFormat() }
+				.colorFormats = { _desc.format }
 			});
 		}
 
@@ -389,12 +337,19 @@ public:
 		toneMappingBindSet->bindBuffer(0, paramBuffer);
 		toneMappingBindSet->bindSampler(1, _nearestClampSampler);
 
+		resourcePool = std::make_shared<RenderGraphResourcePool>(_device);
 		renderGraph = std::make_unique<RenderGraph>(_device);
 		renderGraph->name = "RealTimeRender";
+		renderGraph->setResourcePool(resourcePool);
+		renderGraph->setProfiler(std::make_shared<RenderGraphProfiler>(_device));
 		defineRenderGraph();
 		onResize();
 		renderGraph->genDotFile("RenderGraph.dot", false);
+		// 同一显卡和后端上次编译的结果，图结构变化时自动完整编译
+		const std::string deviceTag = fmt::format("{}-{}", _adapter->getName(), (int)_desc.backend);
+		renderGraph->loadCompileCache("RenderGraph.cache", deviceTag);
 		renderGraph->compile();
+		renderGraph->saveCompileCache("RenderGraph.cache", deviceTag);
 
 		camera.lookAt(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f));
 		cameraControl.setCamera(&camera);
@@ -408,21 +363,6 @@ public:
 		if (renderGraph)
 		{
 			renderGraph->resize(getWidth(), getHeight());
-
-			{
-				auto texture = _device->createTexture
-				({
-					.usage = TextureUsage::CopyDst | TextureUsage::Sampled,
-					.format = Format::RGBA16Sfloat,
-					.width = getWidth(),
-					.height = getHeight(),
-					.name = "TemporaTaaResult"
-				});
-				transitionTextureState(texture, TextureState::ShaderRead);
-				auto textureView = texture->createView({});
-				renderGraph->getRegistry().setImportedTexture(lastTaa, texture, textureView);
-				renderGraph->getRegistry().setImportedTexture(nextTaa, texture, textureView);
-			}
 		}
 	}
 
@@ -472,6 +412,7 @@ public:
 		ImGui::End();
 
 		renderGraph->drawImNodes(dpiScale);
+		renderGraph->getProfiler()->drawImGui();
 	}
 
 	void onUpdate(float deltaTime) override
@@ -540,6 +481,7 @@ public:
 	void onRender(const std::shared_ptr<CommandList>& commandList) override
 	{
 		memcpy(paramBuffer->map(), &param, sizeof(Param));
+		resourcePool->beginFrame();
 		renderGraph->setCommandList(commandList);
 		renderGraph->execute();
 	}
@@ -548,6 +490,7 @@ public:
 		Project::singleton()->close();
 		Project::singleton()->deinit();
 		renderGraph.reset();
+		resourcePool.reset();
 	}
 };
 
@@ -0,0 +1,180 @@
+#include "AsyncReadback.h"
+
+namespace kdGfx
+{
+	static AsyncReadback gAsyncReadback;
+
+	void AsyncReadback::initSingleton(BackendType backend, const std::shared_ptr<Device>& device, uint32_t frameLatency)
+	{
+		gAsyncReadback._backend = backend;
+		gAsyncReadback._device = device;
+		gAsyncReadback._frameLatency = std::max(frameLatency, 1u);
+	}
+
+	void AsyncReadback::destroySingleton()
+	{
+		if (!gAsyncReadback._device) return;
+
+		// 没交付的回读直接丢弃，调用者需要先等待队列空闲
+		gAsyncReadback._requests.clear();
+		gAsyncReadback._freeBuffers.clear();
+		gAsyncReadback._nextTicket = 1;
+		gAsyncReadback._device.reset();
+	}
+
+	AsyncReadback& AsyncReadback::singleton()
+	{
+		return gAsyncReadback;
+	}
+
+	ReadbackTicket AsyncReadback::readbackTexture(CommandList& commandList, const std::shared_ptr<Texture>& texture, size_t size,
+		ReadbackCallback callback)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto buffer = _acquireBuffer(size);
+
+		// 只复制第0级第0层，其他子资源的状态可能不同，不能一起切换
+		const TextureState textureState = texture->getState(0, 0);
+		if (textureState != TextureState::CopySrc)
+		{
+			commandList.resourceBarrier
+			({
+				.texture = texture,
+				.oldState = textureState,
+				.newState = TextureState::CopySrc,
+				.subRange = { 0, 1, 0, 1 }
+			});
+		}
+		commandList.copyTextureToBuffer(texture, buffer);
+		// 原来是Undefined时内容没有意义，留在CopySrc
+		if (textureState != TextureState::CopySrc && textureState != TextureState::Undefined)
+		{
+			commandList.resourceBarrier
+			({
+				.texture = texture,
+				.oldState = TextureState::CopySrc,
+				.newState = textureState,
+				.subRange = { 0, 1, 0, 1 }
+			});
+		}
+
+		const ReadbackTicket ticket = _nextTicket++;
+		_requests.push_back({ .ticket = ticket, .buffer = buffer, .size = size, .callback = std::move(callback) });
+		return ticket;
+	}
+
+	void AsyncReadback::commit(const std::shared_ptr<Fence>& fence, uint64_t value)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& request : _requests)
+		{
+			if (request.fence) continue;
+			request.fence = fence;
+			request.fenceValue = value;
+		}
+	}
+
+	uint32_t AsyncReadback::poll()
+	{
+		std::vector<Request> completed;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (auto it = _requests.begin(); it != _requests.end();)
+			{
+				if (it->callback && _isComplete(*it))
+				{
+					completed.push_back(std::move(*it));
+					it = _requests.erase(it);
+				}
+				else
+					++it;
+			}
+		}
+
+		// 回调里可以再发起回读，不持有锁
+		for (auto& request : completed)
+		{
+			request.callback(request.buffer->map(), request.size);
+			request.buffer->unmap();
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& request : completed)
+			_releaseBuffer(std::move(request.buffer));
+		return (uint32_t)completed.size();
+	}
+
+	bool AsyncReadback::isReady(ReadbackTicket ticket)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = std::find_if(_requests.begin(), _requests.end(), [ticket](const Request& request) { return request.ticket == ticket; });
+		return it != _requests.end() && _isComplete(*it);
+	}
+
+	bool AsyncReadback::getData(ReadbackTicket ticket, void* data, size_t size)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = std::find_if(_requests.begin(), _requests.end(), [ticket](const Request& request) { return request.ticket == ticket; });
+		if (it == _requests.end() || !_isComplete(*it))
+			return false;
+
+		memcpy(data, it->buffer->map(), std::min(size, it->size));
+		it->buffer->unmap();
+		_releaseBuffer(std::move(it->buffer));
+		_requests.erase(it);
+		return true;
+	}
+
+	void AsyncReadback::wait(ReadbackTicket ticket)
+	{
+		std::shared_ptr<Fence> fence;
+		uint64_t fenceValue = 0;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto it = std::find_if(_requests.begin(), _requests.end(), [ticket](const Request& request) { return request.ticket == ticket; });
+			if (it == _requests.end()) return;
+			if (!it->fence)
+			{
+				spdlog::error("readback {} waited before commit", ticket);
+				return;
+			}
+			fence = it->fence;
+			fenceValue = it->fenceValue;
+		}
+		fence->wait(fenceValue);
+		poll();
+	}
+
+	std::shared_ptr<Buffer> AsyncReadback::_acquireBuffer(size_t size)
+	{
+		// 取能放下的最小的缓冲
+		auto best = _freeBuffers.end();
+		for (auto it = _freeBuffers.begin(); it != _freeBuffers.end(); ++it)
+		{
+			if ((*it)->getSize() >= size && (best == _freeBuffers.end() || (*it)->getSize() < (*best)->getSize()))
+				best = it;
+		}
+		if (best != _freeBuffers.end())
+		{
+			auto buffer = std::move(*best);
+			_freeBuffers.erase(best);
+			return buffer;
+		}
+
+		return _device->createBuffer
+		({
+			.size = (size + _alignment - 1) & ~(_alignment - 1),
+			.usage = BufferUsage::CopyDst,
+			.hostVisible = HostVisible::Readback,
+			.name = "Async Readback"
+		});
+	}
+
+	void AsyncReadback::_releaseBuffer(std::shared_ptr<Buffer> buffer)
+	{
+		_freeBuffers.push_back(std::move(buffer));
+		// 稳定状态下每帧一次回读，同时在路上的不超过frameLatency个，多余的先释放最早放回的
+		if (_freeBuffers.size() > _frameLatency)
+			_freeBuffers.erase(_freeBuffers.begin());
+	}
+}
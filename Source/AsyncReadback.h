@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#include "RHI/Device.h"
+
+namespace kdGfx
+{
+	// 回读的票据，0无效
+	using ReadbackTicket = uint64_t;
+	// data在回调返回后失效
+	using ReadbackCallback = std::function<void(const void* data, size_t size)>;
+
+	// 复制记录到调用者的命令列表，不额外提交也不等待，几帧之后通过回调或者轮询拿到数据
+	// 回读缓冲从池里轮换使用，数据交付后放回池中
+	class AsyncReadback final
+	{
+	public:
+		static void initSingleton(BackendType backend, const std::shared_ptr<Device>& device, uint32_t frameLatency = MaxFrameLatency);
+		static void destroySingleton();
+		static AsyncReadback& singleton();
+
+		// 复制第0级第0层。先切换到CopySrc，复制后恢复原来的状态，原来是Undefined时留在CopySrc。没有回调时用getData取数据
+		ReadbackTicket readbackTexture(CommandList& commandList, const std::shared_ptr<Texture>& texture, size_t size,
+			ReadbackCallback callback = {});
+		// 记录了复制的命令列表提交之后调用，fence到达value时数据可读
+		void commit(const std::shared_ptr<Fence>& fence, uint64_t value);
+		// 调用完成的回读的回调，返回完成的数量
+		uint32_t poll();
+		bool isReady(ReadbackTicket ticket);
+		// 拷贝完成的数据并释放票据，还没完成时返回false
+		bool getData(ReadbackTicket ticket, void* data, size_t size);
+		// CPU等待回读完成，回调在这里调用
+		void wait(ReadbackTicket ticket);
+
+	private:
+		struct Request
+		{
+			ReadbackTicket ticket = 0;
+			std::shared_ptr<Buffer> buffer;
+			size_t size = 0;
+			ReadbackCallback callback;
+			std::shared_ptr<Fence> fence;
+			uint64_t fenceValue = 0;
+		};
+
+		BackendType _backend = BackendType::Vulkan;
+		std::shared_ptr<Device> _device;
+		uint32_t _frameLatency = 0;
+		ReadbackTicket _nextTicket = 1;
+		std::deque<Request> _requests;
+		std::vector<std::shared_ptr<Buffer>> _freeBuffers;
+		std::mutex _mutex;
+
+		std::shared_ptr<Buffer> _acquireBuffer(size_t size);
+		void _releaseBuffer(std::shared_ptr<Buffer> buffer);
+		static inline bool _isComplete(const Request& request)
+		{
+			return request.fence && request.fence->getCompletedValue() >= request.fenceValue;
+		}
+		static constexpr size_t _alignment = 64ull << 10;
+	};
+}
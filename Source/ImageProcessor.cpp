@@ -578,38 +578,46 @@ namespace kdGfx
 		return gImageProcessor;
 	}
 
-	void ImageProcessor::process(const Param& param, const std::shared_ptr<Texture>& texture, uint32_t mipLevel)
+	void ImageProcessor::process(CommandList& commandList, const Param& param, const std::shared_ptr<Texture>& texture, Recording& recording,
+		uint32_t mipLevel)
 	{
-		auto bindSet = _device->createBindSet(_bindSetLayout);
-		auto textureView = texture->createView({ .baseMipLevel = mipLevel });
+		auto bindSet = recording.bindSets.emplace_back(_device->createBindSet(_bindSetLayout));
+		auto textureView = recording.textureViews.emplace_back(texture->createView({ .baseMipLevel = mipLevel }));
 		bindSet->bindTexture(0, textureView);
 
-		auto queue = _device->getCommandQueue(CommandListType::General);
-		auto commandList = _device->createCommandList(CommandListType::General);
-		commandList->begin();
-		commandList->resourceBarrier
+		commandList.resourceBarrier
 		({
 			.texture = texture,
 			.oldState = TextureState::ShaderRead,
 			.newState = TextureState::General,
 			.subRange = { mipLevel, 1, 0, 1}
 		});
-		commandList->setPipeline(_pipeline);
-		commandList->setPushConstant(&param);
-		commandList->setBindSet(0, bindSet);
+		commandList.setPipeline(_pipeline);
+		commandList.setPushConstant(&param);
+		commandList.setBindSet(0, bindSet);
 		constexpr uint32_t threadWidth = 8;
 		constexpr uint32_t threadHeight = 8;
 		uint32_t groupCountX = (texture->getWidth() + threadWidth - 1) / threadWidth;
 		uint32_t groupCountY = (texture->getHeight() + threadHeight - 1) / threadHeight;
-		commandList->dispatch(groupCountX, groupCountY, 1);
-		commandList->resourceBarrier
+		commandList.dispatch(groupCountX, groupCountY, 1);
+		// 之后读取这一级之前需要等待写入完成
+		commandList.resourceBarrier
 		({
 			.texture = texture,
 			.oldState = TextureState::General,
 			.newState = TextureState::ShaderRead,
 			.subRange = { mipLevel, 1, 0, 1}
 		});
+	}
+
+	void ImageProcessor::process(const Param& param, const std::shared_ptr<Texture>& texture, uint32_t mipLevel)
+	{
+		Recording recording;
+		auto commandList = _device->createCommandList(CommandListType::General);
+		commandList->begin();
+		process(*commandList, param, texture, recording, mipLevel);
 		commandList->end();
+		auto queue = _device->getCommandQueue(CommandListType::General);
 		queue->submit({ commandList });
 		queue->waitIdle();
 	}
@@ -17,6 +17,17 @@ namespace kdGfx
 		static void destroySingleton();
 		static ImageProcessor& singleton();
 
+		// 记录时创建的绑定组和视图，命令执行完之前要保留
+		struct Recording
+		{
+			std::vector<std::shared_ptr<BindSet>> bindSets;
+			std::vector<std::shared_ptr<TextureView>> textureViews;
+		};
+
+		// 记录到调用者的命令列表，不提交也不等待。进入和退出时mipLevel是ShaderRead
+		void process(CommandList& commandList, const Param& param, const std::shared_ptr<Texture>& texture, Recording& recording,
+			uint32_t mipLevel = 0);
+		// 单独提交并等待完成
 		void process(const Param& param, const std::shared_ptr<Texture>& texture, uint32_t mipLevel = 0);
 
 	private:
@@ -1,5 +1,13 @@
 #include "MipMapsGen.h"
-
+#include "UploadRing.h"
+#ifdef MIPMAPSGEN_COMPILED
+// 由Shaders/MipMapsGen.compute编译生成
+#include "MipMapsGen.spv.h"
+#ifdef _WIN32
+#include "MipMapsGen.dxil.h"
+#endif
+#else
+// 构建时没有dxc，使用预编译的逐级采样版本
 /* Shader Source
 struct PushConstant
 {
@@ -23,7 +31,7 @@ void main(uint2 pixelPos : SV_DispatchThreadID)
 }
 */
 
-const static uint8_t MipMapsGen_spv[1824] =
+const static uint8_t MipMapsGenPerLevel_spv[1824] =
 {
 	0x03, 0x02, 0x23, 0x07, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0e,
 	0x00, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x00,
@@ -193,7 +201,7 @@ const static uint8_t MipMapsGen_spv[1824] =
 	0x00, 0xfd, 0x00, 0x01, 0x00, 0x38, 0x00, 0x01, 0x00
 };
 
-const static uint8_t MipMapsGen_dxil[4444] =
+const static uint8_t MipMapsGenPerLevel_dxil[4444] =
 {
 	0x44, 0x58, 0x42, 0x43, 0x47, 0x9c, 0x6b, 0x79, 0xaf, 0xc1, 0x87,
 	0xaf, 0xc0, 0x2a, 0x48, 0x38, 0x1b, 0x14, 0x03, 0xf4, 0x01, 0x00,
@@ -600,15 +608,32 @@ const static uint8_t MipMapsGen_dxil[4444] =
 	0xa4, 0x02, 0x1b, 0x04, 0xd8, 0x15, 0x07, 0x05, 0x31, 0x08, 0x6b,
 	0x30, 0x4b, 0x30, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
+#endif
 
 namespace kdGfx
 {
 	struct Param
+	{
+		glm::uvec2 srcSize{ 0 };
+		uint32_t levelCount = 0;
+		uint32_t groupCount = 0;
+		uint32_t filter = 0;
+		uint32_t srgb = 0;
+	};
+
+	struct PerLevelParam
 	{
 		glm::vec2 dstSize{ 0.0f };
 		uint32_t srcMip = 0;
 	};
 
+	// 着色器里的输出个数
+	constexpr uint32_t MaxLevelCount = 12;
+	// 第6级结果按线程组存放，源不超过4096时线程组最多64x64
+	constexpr uint32_t MaxGroupCount = 64 * 64;
+	// 超过这个尺寸的源一次只生成6级，剩下的级别从第6级开始再dispatch
+	constexpr uint32_t MaxSingleDispatchExtent = 4096;
+
 	static MipMapsGen gMipMapsGen;
 
 	void MipMapsGen::initSingleton(BackendType backend, const std::shared_ptr<Device>& device)
@@ -616,6 +641,7 @@ namespace kdGfx
 		gMipMapsGen._backend = backend;
 		gMipMapsGen._device = device;
 
+#ifndef MIPMAPSGEN_COMPILED
 		gMipMapsGen._bindSetLayout = gMipMapsGen._device->createBindSetLayout
 		({
 			{ .binding = 0, .type = BindEntryType::Sampler },
@@ -623,6 +649,42 @@ namespace kdGfx
 			{ .binding = 2, .type = BindEntryType::StorageTexture }
 		});
 
+		Shader shader;
+		switch (backend)
+		{
+		case BackendType::Vulkan:
+			shader.code = MipMapsGenPerLevel_spv;
+			shader.codeSize = ArraySize(MipMapsGenPerLevel_spv);
+			break;
+		case BackendType::DirectX12:
+			shader.code = MipMapsGenPerLevel_dxil;
+			shader.codeSize = ArraySize(MipMapsGenPerLevel_dxil);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+
+		gMipMapsGen._pipeline = gMipMapsGen._device->createComputePipeline
+		({
+			.shader = shader,
+			.pushConstantLayout = { sizeof(PerLevelParam) },
+			.bindSetLayouts = { gMipMapsGen._bindSetLayout }
+		});
+		gMipMapsGen._sampler = gMipMapsGen._device->createSampler({ Filter::Linear, AddressMode::Clamp });
+#else
+		std::vector<BindEntryLayout> entryLayouts =
+		{
+			{ .binding = 0, .type = BindEntryType::SampledTexture },
+			{ .binding = 1, .shaderRegister = 0, .type = BindEntryType::StorageBuffer },
+			{ .binding = 2, .shaderRegister = 1, .type = BindEntryType::StorageBuffer }
+		};
+		for (uint32_t i = 0; i < MaxLevelCount; i++)
+		{
+			entryLayouts.push_back({ .binding = 3 + i, .shaderRegister = 2 + i, .type = BindEntryType::StorageTexture });
+		}
+		gMipMapsGen._bindSetLayout = gMipMapsGen._device->createBindSetLayout(entryLayouts);
+
 		Shader shader;
 		switch (backend)
 		{
@@ -630,10 +692,12 @@ namespace kdGfx
 			shader.code = MipMapsGen_spv;
 			shader.codeSize = ArraySize(MipMapsGen_spv);
 			break;
+#ifdef _WIN32
 		case BackendType::DirectX12:
 			shader.code = MipMapsGen_dxil;
 			shader.codeSize = ArraySize(MipMapsGen_dxil);
 			break;
+#endif
 		default:
 			assert(false);
 			break;
@@ -645,10 +709,33 @@ namespace kdGfx
 			.pushConstantLayout = { sizeof(Param) },
 			.bindSetLayouts = { gMipMapsGen._bindSetLayout }
 		});
+
+		gMipMapsGen._counterBuffer = gMipMapsGen._device->createBuffer
+		({
+			.size = sizeof(uint32_t),
+			.stride = sizeof(uint32_t),
+			.usage = BufferUsage::Storage | BufferUsage::CopyDst,
+			.name = "MipMapsGen-Counter"
+		});
+		gMipMapsGen._texelBuffer = gMipMapsGen._device->createBuffer
+		({
+			.size = sizeof(glm::vec4) * MaxGroupCount,
+			.stride = sizeof(glm::vec4),
+			.usage = BufferUsage::Storage,
+			.name = "MipMapsGen-Texels"
+		});
+		// 计数器只需要初始清零一次，之后每次dispatch由最后一个线程组清零
+		const uint32_t zero = 0;
+		auto& uploadRing = UploadRing::singleton();
+		uploadRing.wait(uploadRing.uploadBuffer(gMipMapsGen._counterBuffer, &zero, sizeof(zero), 0, BufferState::ShaderWrite));
+#endif
 	}
 
 	void MipMapsGen::destroySingleton()
 	{
+		gMipMapsGen._sampler.reset();
+		gMipMapsGen._texelBuffer.reset();
+		gMipMapsGen._counterBuffer.reset();
 		gMipMapsGen._pipeline.reset();
 		gMipMapsGen._bindSetLayout.reset();
 		gMipMapsGen._device.reset();
@@ -659,57 +746,132 @@ namespace kdGfx
 		return gMipMapsGen;
 	}
 
-	void MipMapsGen::generate(const std::shared_ptr<Texture>& texture)
+	void MipMapsGen::generate(CommandList& commandList, const std::shared_ptr<Texture>& texture, Recording& recording,
+		MipMapsFilter filter, bool srgb)
 	{
 		const auto& desc = texture->getDesc();
-		auto bindSet = _device->createBindSet(_bindSetLayout);
-		auto sampler = _device->createSampler({ Filter::Linear, AddressMode::Clamp });
-		bindSet->bindSampler(0, sampler);
+		if (desc.mipLevels <= 1) return;
+#ifndef MIPMAPSGEN_COMPILED
+		_generatePerLevel(commandList, texture, recording);
+		return;
+#endif
 
-		std::vector<std::shared_ptr<TextureView>> mipMapViews(desc.mipLevels);
+		const size_t firstView = recording.textureViews.size();
 		for (uint32_t mip = 0; mip < desc.mipLevels; mip++)
 		{
-			mipMapViews[mip] = texture->createView({ .baseMipLevel = mip });
+			recording.textureViews.push_back(texture->createView({ .baseMipLevel = mip }));
 		}
 
-		auto queue = _device->getCommandQueue(CommandListType::General);
-		auto commandList = _device->createCommandList(CommandListType::General);
+		commandList.setPipeline(_pipeline);
+		uint32_t baseMip = 0;
+		while (baseMip + 1 < desc.mipLevels)
+		{
+			// 非2的幂的尺寸每级至少1像素
+			const uint32_t srcWidth = std::max(desc.width >> baseMip, 1u);
+			const uint32_t srcHeight = std::max(desc.height >> baseMip, 1u);
+			const uint32_t groupCountX = (srcWidth + 63) / 64;
+			const uint32_t groupCountY = (srcHeight + 63) / 64;
+			uint32_t maxLevelCount = std::max(srcWidth, srcHeight) > MaxSingleDispatchExtent ? 6 : MaxLevelCount;
+			// Kaiser的窗口跨过tile边界，多个线程组时只生成直接读源的第1级，直到源在一个线程组内
+			if (filter == MipMapsFilter::Kaiser && groupCountX * groupCountY > 1) maxLevelCount = 1;
+			const uint32_t levelCount = std::min(desc.mipLevels - 1 - baseMip, maxLevelCount);
+
+			// 每次dispatch一个绑定组，记录期间不能改写。用不到的输出绑定最后一级，着色器不会写入
+			auto bindSet = recording.bindSets.emplace_back(_device->createBindSet(_bindSetLayout));
+			bindSet->bindTexture(0, recording.textureViews[firstView + baseMip]);
+			bindSet->bindBuffer(1, _counterBuffer);
+			bindSet->bindBuffer(2, _texelBuffer);
+			for (uint32_t i = 0; i < MaxLevelCount; i++)
+			{
+				bindSet->bindTexture(3 + i, recording.textureViews[firstView + baseMip + 1 + std::min(i, levelCount - 1)]);
+			}
+
+			Param param
+			{
+				.srcSize = { srcWidth, srcHeight },
+				.levelCount = levelCount,
+				.groupCount = groupCountX * groupCountY,
+				.filter = (uint32_t)filter,
+				.srgb = srgb ? 1u : 0u
+			};
+
+			commandList.resourceBarrier
+			({
+				.texture = texture,
+				.oldState = TextureState::ShaderRead,
+				.newState = TextureState::General,
+				.subRange = { baseMip + 1, levelCount, 0, 1 }
+			});
+			commandList.setPushConstant(&param);
+			commandList.setBindSet(0, bindSet);
+			commandList.dispatch(groupCountX, groupCountY, 1);
+			// 下一次dispatch读取这次的结果，复用计数器和第6级缓冲之前需要等待写入完成
+			commandList.resourceBarriers
+			(
+				{
+					{
+						.texture = texture,
+						.oldState = TextureState::General,
+						.newState = TextureState::ShaderRead,
+						.subRange = { baseMip + 1, levelCount, 0, 1 }
+					}
+				},
+				{
+					{ .buffer = _counterBuffer, .oldState = BufferState::ShaderWrite, .newState = BufferState::ShaderWrite },
+					{ .buffer = _texelBuffer, .oldState = BufferState::ShaderWrite, .newState = BufferState::ShaderWrite }
+				}
+			);
+			baseMip += levelCount;
+		}
+	}
+
+	void MipMapsGen::_generatePerLevel(CommandList& commandList, const std::shared_ptr<Texture>& texture, Recording& recording)
+	{
+		const auto& desc = texture->getDesc();
+		commandList.setPipeline(_pipeline);
 		for (uint32_t mip = 1; mip < desc.mipLevels; mip++)
 		{
-			bindSet->bindTexture(1, mipMapViews[mip - 1]);
-			bindSet->bindTexture(2, mipMapViews[mip]);
+			auto srcView = recording.textureViews.emplace_back(texture->createView({ .baseMipLevel = mip - 1 }));
+			auto dstView = recording.textureViews.emplace_back(texture->createView({ .baseMipLevel = mip }));
+			auto bindSet = recording.bindSets.emplace_back(_device->createBindSet(_bindSetLayout));
+			bindSet->bindSampler(0, _sampler);
+			bindSet->bindTexture(1, srcView);
+			bindSet->bindTexture(2, dstView);
 
-			uint32_t dstWidth = desc.width >> mip;
-			uint32_t dstHeight = desc.height >> mip;
-			Param param{ .dstSize = { dstWidth, dstHeight }, .srcMip = mip - 1 };
+			const uint32_t dstWidth = std::max(desc.width >> mip, 1u);
+			const uint32_t dstHeight = std::max(desc.height >> mip, 1u);
+			// 源视图只有一级
+			PerLevelParam param{ .dstSize = glm::vec2(dstWidth, dstHeight), .srcMip = 0 };
 
-			commandList->reset();
-			commandList->begin();
-			commandList->resourceBarrier
+			commandList.resourceBarrier
 			({
 				.texture = texture,
 				.oldState = TextureState::ShaderRead,
 				.newState = TextureState::General,
-				.subRange = { mip, 1, 0, 1}
+				.subRange = { mip, 1, 0, 1 }
 			});
-			commandList->setPipeline(_pipeline);
-			commandList->setPushConstant(&param);
-			commandList->setBindSet(0, bindSet);
-			constexpr uint32_t threadWidth = 8;
-			constexpr uint32_t threadHeight = 8;
-			uint32_t groupCountX = (dstWidth + threadWidth - 1) / threadWidth;
-			uint32_t groupCountY = (dstHeight + threadHeight - 1) / threadHeight;
-			commandList->dispatch(groupCountX, groupCountY, 1);
-			commandList->resourceBarrier
+			commandList.setPushConstant(&param);
+			commandList.setBindSet(0, bindSet);
+			commandList.dispatch((dstWidth + 7) / 8, (dstHeight + 7) / 8, 1);
+			commandList.resourceBarrier
 			({
 				.texture = texture,
 				.oldState = TextureState::General,
 				.newState = TextureState::ShaderRead,
-				.subRange = { mip, 1, 0, 1}
+				.subRange = { mip, 1, 0, 1 }
 			});
-			commandList->end();
-			queue->submit({ commandList });
-			queue->waitIdle();
 		}
 	}
+
+	void MipMapsGen::generate(const std::shared_ptr<Texture>& texture, MipMapsFilter filter, bool srgb)
+	{
+		Recording recording;
+		auto commandList = _device->createCommandList(CommandListType::General);
+		commandList->begin();
+		generate(*commandList, texture, recording, filter, srgb);
+		commandList->end();
+		auto queue = _device->getCommandQueue(CommandListType::General);
+		queue->submit({ commandList });
+		queue->waitIdle();
+	}
 }
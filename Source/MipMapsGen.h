@@ -4,6 +4,16 @@
 
 namespace kdGfx
 {
+	enum struct MipMapsFilter
+	{
+		// 2x2平均
+		Box,
+		// 4x4 Kaiser窗，比Box锐利。源大于64x64时每级一次dispatch，直到源在一个线程组内
+		Kaiser
+	};
+
+	// 单次dispatch生成最多12级，每个线程组归约源的64x64块，最后完成的线程组生成剩下的级别
+	// 构建时没有dxc的话使用预编译的着色器，每级一次dispatch双线性采样上一级，filter和srgb不生效
 	class MipMapsGen final
 	{
 	public:
@@ -11,12 +21,32 @@ namespace kdGfx
 		static void destroySingleton();
 		static MipMapsGen& singleton();
 
-		void generate(const std::shared_ptr<Texture>& texture);
+		// 记录时创建的绑定组和视图，命令执行完之前要保留
+		struct Recording
+		{
+			std::vector<std::shared_ptr<BindSet>> bindSets;
+			std::vector<std::shared_ptr<TextureView>> textureViews;
+		};
+
+		// 所有级别记录到调用者的命令列表，不提交也不等待。进入和退出时所有级别都是ShaderRead
+		// srgb为true时贴图里是sRGB编码的数据，在线性空间过滤后再编码写回
+		void generate(CommandList& commandList, const std::shared_ptr<Texture>& texture, Recording& recording,
+			MipMapsFilter filter = MipMapsFilter::Box, bool srgb = false);
+		// 单独提交并等待完成
+		void generate(const std::shared_ptr<Texture>& texture, MipMapsFilter filter = MipMapsFilter::Box, bool srgb = false);
 
 	private:
+		void _generatePerLevel(CommandList& commandList, const std::shared_ptr<Texture>& texture, Recording& recording);
+
 		BackendType _backend = BackendType::Vulkan;
 		std::shared_ptr<Device> _device;
 		std::shared_ptr<BindSetLayout> _bindSetLayout;
 		std::shared_ptr<Pipeline> _pipeline;
+		// 完成的线程组数，着色器里最后一个线程组清零
+		std::shared_ptr<Buffer> _counterBuffer;
+		// 每个线程组的第6级结果
+		std::shared_ptr<Buffer> _texelBuffer;
+		// 逐级采样版本使用
+		std::shared_ptr<Sampler> _sampler;
 	};
 }
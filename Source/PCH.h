@@ -13,6 +13,7 @@
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <atomic>
 #include <iostream>
 #include <filesystem>
 
@@ -10,6 +10,9 @@ namespace kdGfx
         DirectX12
     };
 
+    // 同时在GPU上执行的最大帧数，延迟回收的组件默认等待这么多帧后才复用资源
+    inline constexpr uint32_t MaxFrameLatency = 3;
+
     enum struct Format
     {
         Undefined,
@@ -32,6 +35,40 @@ namespace kdGfx
         S8Uint
     };
 
+    inline uint32_t GetBytesPerPixel(Format format)
+    {
+        switch (format)
+        {
+        case Format::RGBA8Unorm:
+        case Format::RGBA8Srgb:
+        case Format::BGRA8Unorm:
+        case Format::BGRA8Srgb:
+        case Format::R32Uint:
+        case Format::R32Sfloat:
+        case Format::D32Sfloat:
+        case Format::D24UnormS8Uint:
+        case Format::S8Uint:
+            return 4;
+        case Format::R8Unorm:
+            return 1;
+        case Format::R16Uint:
+        case Format::D16Unorm:
+            return 2;
+        case Format::RGBA16Unorm:
+        case Format::RGBA16Sfloat:
+            return 8;
+        case Format::RG32Sfloat:
+            return 8;
+        case Format::RGB32Sfloat:
+            return 12;
+        case Format::RGBA32Sfloat:
+            return 16;
+        default:
+            assert(false);
+            return 0;
+        }
+    }
+
     enum struct CommandListType
     {
         General,
@@ -50,9 +87,21 @@ namespace kdGfx
     {
         size_t size = 0;
         MemoryType type = MemoryType::Device;
+        // 放置在上面的资源都支持的内存类型，按位对应Vulkan的内存类型，DX12忽略
+        uint32_t memoryTypeBits = UINT32_MAX;
         std::string name;
     };
 
+    // 资源放置到Memory需要的大小和对齐
+    struct AllocateInfo
+    {
+        size_t size = 0;
+        size_t alignment = 1;
+        uint32_t memoryTypeBits = UINT32_MAX;
+        // buffer是线性资源，和非线性的贴图相邻放置时要按bufferImageGranularity隔开
+        bool linear = false;
+    };
+
     enum struct BufferUsage
     {
         Undefined = 0,
@@ -134,6 +183,23 @@ namespace kdGfx
         Present,
     };
 
+    // 屏障同步的管线阶段，None表示不需要等待或不需要阻塞
+    enum struct PipelineStage
+    {
+        None = 0,
+        DrawIndirect = 1 << 0,
+        VertexInput = 1 << 1,
+        VertexShader = 1 << 2,
+        PixelShader = 1 << 3,
+        DepthStencil = 1 << 4,
+        ColorAttachment = 1 << 5,
+        ComputeShader = 1 << 6,
+        Copy = 1 << 7,
+        Resolve = 1 << 8,
+        AllCommands = 1 << 9
+    };
+    ENUM_BITWISE_OPERATOR(PipelineStage)
+
     class Texture;
     struct TextureBarrierDesc
     {
@@ -147,6 +213,38 @@ namespace kdGfx
             uint32_t baseArrayLayer = 0;
             uint32_t layerCount = 1;
         } subRange;
+        // 跨队列使用时转移所有权，释放和获取两侧队列各记录一次相同的屏障
+        CommandListType srcQueue = CommandListType::General;
+        CommandListType dstQueue = CommandListType::General;
+        // 等待srcStage的访问完成后才开始dstStage
+        PipelineStage srcStage = PipelineStage::AllCommands;
+        PipelineStage dstStage = PipelineStage::AllCommands;
+    };
+
+    // buffer没有布局，状态只用于确定访问类型
+    enum struct BufferState
+    {
+        Undefined,
+        CopyDst,
+        CopySrc,
+        VertexIndex,
+        Indirect,
+        Constant,
+        ShaderRead,
+        ShaderWrite
+    };
+
+    class Buffer;
+    struct BufferBarrierDesc
+    {
+        std::shared_ptr<Buffer> buffer;
+        BufferState oldState = BufferState::Undefined;
+        BufferState newState = BufferState::Undefined;
+        // 和贴图一样，跨队列族使用时两侧各记录一次
+        CommandListType srcQueue = CommandListType::General;
+        CommandListType dstQueue = CommandListType::General;
+        PipelineStage srcStage = PipelineStage::AllCommands;
+        PipelineStage dstStage = PipelineStage::AllCommands;
     };
 
     struct TextureViewDesc
@@ -429,6 +527,33 @@ namespace kdGfx
         }
     };
 
+    struct PipelineCacheStats
+    {
+        uint32_t pipelines = 0;
+        // 驱动管线缓存命中，不需要重新编译
+        uint32_t pipelineHits = 0;
+        uint32_t shaderModules = 0;
+        uint32_t shaderModuleHits = 0;
+        uint32_t pipelineLayouts = 0;
+        uint32_t pipelineLayoutHits = 0;
+        // 创建管线的总耗时，纳秒
+        uint64_t pipelineCreationTime = 0;
+    };
+
+    struct MemoryStats
+    {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+        // 向驱动申请的总大小，包括独占分配
+        uint64_t reservedSize = 0;
+        // 分配出去的大小，按伙伴节点计算
+        uint64_t usedSize = 0;
+        uint64_t largestFreeSize = 0;
+        // 1 - 最大连续空闲 / 总空闲，越大碎片越多
+        float fragmentation = 0.0f;
+    };
+
     class TextureView;
     struct RenderPassColorAttachment
     {
@@ -464,4 +589,29 @@ namespace kdGfx
         int32_t vertexOffset;
         uint32_t firstInstance;
     };
+
+    enum struct QueryType
+    {
+        Timestamp,
+        PipelineStatistics
+    };
+
+    struct QueryPoolDesc
+    {
+        QueryType type = QueryType::Timestamp;
+        uint32_t count = 0;
+        std::string name;
+    };
+
+    // 字段顺序和Vulkan统计位的顺序一致
+    struct PipelineStatistics
+    {
+        uint64_t inputVertices = 0;
+        uint64_t inputPrimitives = 0;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t clippingInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t pixelShaderInvocations = 0;
+        uint64_t computeShaderInvocations = 0;
+    };
 }
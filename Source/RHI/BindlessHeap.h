@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BaseTypes.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include "BindSetLayout.h"
+#include "BindSet.h"
+
+namespace kdGfx
+{
+    using BindlessIndex = uint32_t;
+    inline constexpr BindlessIndex InvalidBindlessIndex = UINT32_MAX;
+
+    // 设备级的bindless描述符堆，资源注册一次得到固定的索引，着色器按索引访问
+    // 绑定组固定布局：binding 0采样贴图，1存储贴图，2存储buffer，3采样器
+    // 可以在多个线程注册和释放。释放的索引frameLatency帧之后才重用，之前堆持有资源引用
+    // 同一资源重复注册返回同一索引，释放和注册次数相同时才回收
+    class BindlessHeap
+    {
+    public:
+        virtual ~BindlessHeap() = default;
+
+        // type是SampledTexture或StorageTexture，堆满时返回InvalidBindlessIndex
+        virtual BindlessIndex registerTexture(const std::shared_ptr<TextureView>& textureView, BindEntryType type = BindEntryType::SampledTexture) = 0;
+        virtual BindlessIndex registerBuffer(const std::shared_ptr<Buffer>& buffer) = 0;
+        virtual BindlessIndex registerSampler(const std::shared_ptr<Sampler>& sampler) = 0;
+        virtual void releaseTexture(BindlessIndex index, BindEntryType type = BindEntryType::SampledTexture) = 0;
+        virtual void releaseBuffer(BindlessIndex index) = 0;
+        virtual void releaseSampler(BindlessIndex index) = 0;
+
+        virtual uint32_t getCapacity(BindEntryType type) const = 0;
+        inline const std::shared_ptr<BindSetLayout>& getBindSetLayout() const { return _layout; }
+        inline const std::shared_ptr<BindSet>& getBindSet() const { return _bindSet; }
+
+    protected:
+        std::shared_ptr<BindSetLayout> _layout;
+        std::shared_ptr<BindSet> _bindSet;
+    };
+}
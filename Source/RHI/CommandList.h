@@ -5,6 +5,7 @@
 #include "BindSet.h"
 #include "Buffer.h"
 #include "Texture.h"
+#include "QueryPool.h"
 
 namespace kdGfx
 {
@@ -21,6 +22,10 @@ namespace kdGfx
         virtual void endLabel() = 0;
         // DX12切换状态只允许在主队列
         virtual void resourceBarrier(const TextureBarrierDesc& desc) = 0;
+        virtual void resourceBarrier(const BufferBarrierDesc& desc) = 0;
+        // 合并成一次屏障调用。状态相同也会生成屏障，用于同步前面的写入
+        virtual void resourceBarriers(const std::vector<TextureBarrierDesc>& textureBarriers,
+                                      const std::vector<BufferBarrierDesc>& bufferBarriers = {}) = 0;
         virtual void setPipeline(const std::shared_ptr<Pipeline>& pipeline) = 0;
         virtual void setPushConstant(const void* data) = 0;
         // 必须要setPipeline之后调用
@@ -51,18 +56,34 @@ namespace kdGfx
             // compute
         virtual void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
         // copy
-        virtual void copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size) = 0;
+        virtual void copyBuffer(const std::shared_ptr<Buffer>& src,
+                                const std::shared_ptr<Buffer>& dst,
+                                size_t size,
+                                size_t srcOffset = 0,
+                                size_t dstOffset = 0) = 0;
+        // bufferOffset在DX12需要512字节对齐
         virtual void copyBufferToTexture(const std::shared_ptr<Buffer>& buffer,
                                          const std::shared_ptr<Texture>& texture,
-                                         uint32_t mipLevel = 0) = 0;
+                                         uint32_t mipLevel = 0,
+                                         size_t bufferOffset = 0) = 0;
         virtual void copyTextureToBuffer(const std::shared_ptr<Texture>& texture,
                                          const std::shared_ptr<Buffer>& buffer,
-                                         uint32_t mipLevel = 0) = 0;
+                                         uint32_t mipLevel = 0,
+                                         size_t bufferOffset = 0) = 0;
         virtual void copyTexture(const std::shared_ptr<Texture>& src,
                                  const std::shared_ptr<Texture>& dst,
                                  glm::uvec2 size,
                                  glm::ivec2 srcOffset = { 0, 0 },
                                  glm::ivec2 dstOffset = { 0, 0 }) = 0;
         virtual void resolveTexture(const std::shared_ptr<Texture>& src, const std::shared_ptr<Texture>& dst) = 0;
+        // query。重置和解析都要在RenderPass外调用，DX12复制队列不支持时间戳
+        virtual void resetQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count) = 0;
+        // 前面的命令全部执行完时写入时间戳，begin时在命令开始执行时写入，作为计时起点
+        virtual void writeTimestamp(const std::shared_ptr<QueryPool>& queryPool, uint32_t index, bool begin = false) = 0;
+        // 管线统计只能在主队列
+        virtual void beginQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index) = 0;
+        virtual void endQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index) = 0;
+        // 结果写到CPU可读取的位置，之后才能getResults
+        virtual void resolveQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count) = 0;
     };
 }
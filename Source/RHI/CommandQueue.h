@@ -6,6 +6,28 @@
 
 namespace kdGfx
 {
+    // 等待的值到达之前，只阻塞stage之后的阶段
+    struct FenceWait
+    {
+        std::shared_ptr<Fence> fence;
+        uint64_t value = 0;
+        PipelineStage stage = PipelineStage::AllCommands;
+    };
+
+    struct FenceSignal
+    {
+        std::shared_ptr<Fence> fence;
+        uint64_t value = 0;
+    };
+
+    // 等待、命令列表和信号合并成一次提交
+    struct SubmitDesc
+    {
+        std::vector<FenceWait> waits;
+        std::vector<std::shared_ptr<CommandList>> commandLists;
+        std::vector<FenceSignal> signals;
+    };
+
     // 执行命令的队列
     class CommandQueue
     {
@@ -16,5 +38,8 @@ namespace kdGfx
         virtual void wait(const std::shared_ptr<Fence>& fence, uint64_t value) = 0;
         virtual void waitIdle() = 0;
         virtual void submit(const std::vector<std::shared_ptr<CommandList>>& commandLists) = 0;
+        virtual void submit(const SubmitDesc& desc) = 0;
+        // 时间戳每秒的计数
+        virtual uint64_t getTimestampFrequency() = 0;
     };
 }
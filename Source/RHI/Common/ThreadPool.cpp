@@ -0,0 +1,97 @@
+#include "ThreadPool.h"
+
+namespace kdGfx
+{
+	static thread_local uint32_t tThreadIndex = 0;
+
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			_threads.emplace_back([this, i]()
+				{
+					tThreadIndex = i + 1;
+					while (true)
+					{
+						std::function<void()> task;
+						{
+							std::unique_lock lock(_mutex);
+							_condition.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+							if (_stop && _tasks.empty()) return;
+							task = std::move(_tasks.front());
+							_tasks.pop();
+						}
+						task();
+					}
+				});
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_stop = true;
+		}
+		_condition.notify_all();
+		for (auto& thread : _threads)
+			thread.join();
+	}
+
+	void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+	{
+		if (count == 0) return;
+
+		// 辅助任务可能在返回后才被调度，状态用共享指针保存
+		struct State
+		{
+			std::function<void(uint32_t)> func;
+			uint32_t count = 0;
+			std::atomic<uint32_t> next = 0;
+			std::atomic<uint32_t> done = 0;
+			std::mutex mutex;
+			std::condition_variable condition;
+		};
+		auto state = std::make_shared<State>();
+		state->func = func;
+		state->count = count;
+
+		auto run = [state]()
+			{
+				uint32_t index;
+				while ((index = state->next++) < state->count)
+				{
+					state->func(index);
+					if (++state->done == state->count)
+					{
+						std::lock_guard lock(state->mutex);
+						state->condition.notify_all();
+					}
+				}
+			};
+		uint32_t helperCount = std::min(count - 1, getThreadCount());
+		for (uint32_t i = 0; i < helperCount; ++i)
+			_enqueue(run);
+		run();
+
+		std::unique_lock lock(state->mutex);
+		state->condition.wait(lock, [&state]() { return state->done == state->count; });
+	}
+
+	uint32_t ThreadPool::getCurrentThreadIndex()
+	{
+		return tThreadIndex;
+	}
+
+	void ThreadPool::_enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_tasks.push(std::move(task));
+		}
+		_condition.notify_one();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "PCH.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+namespace kdGfx
+{
+	// 固定数量的工作线程，执行提交的任务
+	class ThreadPool
+	{
+	public:
+		// threadCount为0时按硬件线程数创建
+		ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		template<typename F>
+		auto submit(F&& func) -> std::future<std::invoke_result_t<F>>
+		{
+			using ResultType = std::invoke_result_t<F>;
+			auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(func));
+			auto future = task->get_future();
+			_enqueue([task]() { (*task)(); });
+			return future;
+		}
+		// 分成count份并行执行，调用线程也参与，全部完成后返回
+		void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+		inline uint32_t getThreadCount() const { return (uint32_t)_threads.size(); }
+		// 工作线程序号从1开始，其他线程返回0
+		static uint32_t getCurrentThreadIndex();
+
+	private:
+		std::vector<std::thread> _threads;
+		std::queue<std::function<void()>> _tasks;
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		bool _stop = false;
+
+	private:
+		void _enqueue(std::function<void()> task);
+	};
+}
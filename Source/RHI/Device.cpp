@@ -0,0 +1,64 @@
+#include "Device.h"
+
+namespace kdGfx
+{
+    // 拷贝shader代码并指向拷贝，调用者的代码在编译前可能已经释放
+    static Shader CopyShader(const Shader& shader, std::vector<std::shared_ptr<std::vector<char>>>& codes)
+    {
+        if (!shader.code) return shader;
+        auto& code = codes.emplace_back(std::make_shared<std::vector<char>>(
+            static_cast<const char*>(shader.code), static_cast<const char*>(shader.code) + shader.codeSize));
+        return { .codeSize = shader.codeSize, .code = code->data() };
+    }
+
+    std::shared_ptr<AsyncPipeline> Device::createComputePipelineAsync(const ComputePipelineDesc& desc)
+    {
+        std::vector<std::shared_ptr<std::vector<char>>> codes;
+        ComputePipelineDesc compileDesc = desc;
+        compileDesc.shader = CopyShader(desc.shader, codes);
+        return _submitPipelineCompile([this, compileDesc, codes]() { return createComputePipeline(compileDesc); });
+    }
+
+    std::shared_ptr<AsyncPipeline> Device::createRasterPipelineAsync(const RasterPipelineDesc& desc)
+    {
+        std::vector<std::shared_ptr<std::vector<char>>> codes;
+        RasterPipelineDesc compileDesc = desc;
+        compileDesc.vertex = CopyShader(desc.vertex, codes);
+        compileDesc.pixel = CopyShader(desc.pixel, codes);
+        return _submitPipelineCompile([this, compileDesc, codes]() { return createRasterPipeline(compileDesc); });
+    }
+
+    void Device::setPipelineThreadPool(const std::shared_ptr<ThreadPool>& threadPool)
+    {
+        std::lock_guard<std::mutex> lock(_pipelineCompileMutex);
+        _pipelineThreadPool = threadPool;
+    }
+
+    void Device::waitPipelineCompiles()
+    {
+        std::vector<std::shared_future<std::shared_ptr<Pipeline>>> compiles;
+        {
+            std::lock_guard<std::mutex> lock(_pipelineCompileMutex);
+            compiles.swap(_pipelineCompiles);
+        }
+        for (auto& compile : compiles)
+            compile.wait();
+    }
+
+    std::shared_ptr<AsyncPipeline> Device::_submitPipelineCompile(std::function<std::shared_ptr<Pipeline>()> compile)
+    {
+        std::lock_guard<std::mutex> lock(_pipelineCompileMutex);
+        // 默认用一半的硬件线程，不和渲染线程抢
+        if (!_pipelineThreadPool)
+            _pipelineThreadPool = std::make_shared<ThreadPool>(std::max(std::thread::hardware_concurrency() / 2, 1u));
+
+        std::shared_future<std::shared_ptr<Pipeline>> future = _pipelineThreadPool->submit(std::move(compile)).share();
+        // 只保留还没完成的编译
+        std::erase_if(_pipelineCompiles, [](const std::shared_future<std::shared_ptr<Pipeline>>& compile)
+            {
+                return compile.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            });
+        _pipelineCompiles.push_back(future);
+        return std::make_shared<AsyncPipeline>(future);
+    }
+}
@@ -10,7 +10,10 @@
 #include "Swapchain.h"
 #include "BindSetLayout.h"
 #include "BindSet.h"
+#include "BindlessHeap.h"
 #include "Pipeline.h"
+#include "QueryPool.h"
+#include "Common/ThreadPool.h"
 
 namespace kdGfx
 {
@@ -21,7 +24,8 @@ namespace kdGfx
         virtual ~Device() = default;
 
         virtual std::shared_ptr<CommandQueue> getCommandQueue(CommandListType type) = 0;
-        virtual size_t getTextureAllocateSize(const TextureDesc& desc) = 0;
+        virtual AllocateInfo getTextureAllocateInfo(const TextureDesc& desc) = 0;
+        virtual AllocateInfo getBufferAllocateInfo(const BufferDesc& desc) = 0;
         virtual std::shared_ptr<CommandList> createCommandList(CommandListType type) = 0;
         virtual std::shared_ptr<Fence> createFence(uint64_t initialValue) = 0;
         virtual std::shared_ptr<Memory> createMemory(const MemoryDesc& desc) = 0;
@@ -35,10 +39,45 @@ namespace kdGfx
         virtual std::shared_ptr<BindSet> createBindSet(const std::shared_ptr<BindSetLayout>& layout) = 0;
         virtual std::shared_ptr<Pipeline> createComputePipeline(const ComputePipelineDesc& desc) = 0;
         virtual std::shared_ptr<Pipeline> createRasterPipeline(const RasterPipelineDesc& desc) = 0;
+        virtual std::shared_ptr<QueryPool> createQueryPool(const QueryPoolDesc& desc) = 0;
+        // 设备共用一个bindless堆，第一次调用时创建，不支持时返回空
+        virtual std::shared_ptr<BindlessHeap> getBindlessHeap() { return nullptr; }
+        // 驱动的管线编译缓存，保存到文件下次启动加载。文件和设备不匹配时忽略，不支持时返回false
+        virtual bool loadPipelineCache(const std::string& filename) { return false; }
+        virtual bool savePipelineCache(const std::string& filename) { return false; }
+        virtual PipelineCacheStats getPipelineCacheStats() { return {}; }
+        // 资源内存的分配统计
+        virtual MemoryStats getMemoryStats() { return {}; }
+
+        // 每帧开始调用一次，延迟回收的绑定组和bindless索引按帧号判断GPU是否已经用完
+        inline void beginFrame() { _frame.fetch_add(1, std::memory_order_relaxed); }
+        inline uint64_t getFrame() const { return _frame.load(std::memory_order_relaxed); }
+
+        // 在后台线程编译管线，立即返回。shader代码会拷贝一份，调用后可以释放
+        std::shared_ptr<AsyncPipeline> createComputePipelineAsync(const ComputePipelineDesc& desc);
+        std::shared_ptr<AsyncPipeline> createRasterPipelineAsync(const RasterPipelineDesc& desc);
+        // 后台编译使用的线程池，不设置时第一次异步编译创建
+        void setPipelineThreadPool(const std::shared_ptr<ThreadPool>& threadPool);
+        // 等待所有后台编译完成，派生类析构时先调用
+        void waitPipelineCompiles();
 
         inline const bool isRayQuerySupported() const { return _rayQuerySupported; }
+        inline const bool isPipelineStatisticsSupported() const { return _pipelineStatisticsSupported; }
+        // 同时存活的线性和非线性资源不能放在同一个粒度页内
+        inline size_t getBufferImageGranularity() const { return _bufferImageGranularity; }
 
     protected:
         bool _rayQuerySupported = false;
+        bool _pipelineStatisticsSupported = false;
+        size_t _bufferImageGranularity = 1;
+
+    private:
+        std::shared_ptr<AsyncPipeline> _submitPipelineCompile(std::function<std::shared_ptr<Pipeline>()> compile);
+
+        std::atomic<uint64_t> _frame = 0;
+
+        std::mutex _pipelineCompileMutex;
+        std::shared_ptr<ThreadPool> _pipelineThreadPool;
+        std::vector<std::shared_future<std::shared_ptr<Pipeline>>> _pipelineCompiles;
     };
 }
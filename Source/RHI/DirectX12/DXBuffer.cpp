@@ -26,12 +26,7 @@ namespace kdGfx
 			    break;
         }
         
-        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
-        if (HasAnyBits(desc.usage, BufferUsage::Storage))
-        {
-            flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-        }
-        D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(MemAlign(_desc.size, 255), flags);
+        D3D12_RESOURCE_DESC resourceDesc = getResourceDesc(_desc);
         if (FAILED(_device.getDevice()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, 
             &resourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&_resource))))
         {
@@ -59,12 +54,7 @@ namespace kdGfx
             break;
         }
 
-        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
-        if (HasAnyBits(desc.usage, BufferUsage::Storage))
-        {
-            flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-        }
-        D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(MemAlign(_desc.size, 255), flags);
+        D3D12_RESOURCE_DESC resourceDesc = getResourceDesc(_desc);
         if (FAILED(device.getDevice()->CreatePlacedResource(memory->getHeap().Get(), offset, &resourceDesc,
             D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&_resource))))
         {
@@ -77,6 +67,17 @@ namespace kdGfx
         _memoryOffset = offset;
     }
 
+    D3D12_RESOURCE_DESC DXBuffer::getResourceDesc(const BufferDesc& desc)
+    {
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+        if (HasAnyBits(desc.usage, BufferUsage::Storage))
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        }
+        // 常量缓冲区要求256字节对齐
+        return CD3DX12_RESOURCE_DESC::Buffer(MemAlign(desc.size, 256), flags);
+    }
+
     void* DXBuffer::map()
     {
         if (_mappedPtr == nullptr && (_desc.hostVisible != HostVisible::Invisible))
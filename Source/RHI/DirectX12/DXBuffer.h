@@ -18,6 +18,8 @@ namespace kdGfx
         void* map() override;
         void unmap() override;
 
+        static D3D12_RESOURCE_DESC getResourceDesc(const BufferDesc& desc);
+
         inline Microsoft::WRL::ComPtr<ID3D12Resource> getResource() const { return _resource; }
 
     private:
@@ -7,6 +7,7 @@
 #include "DXTexture.h"
 #include "DXPipeline.h"
 #include "DXBindSet.h"
+#include "DXQueryPool.h"
 #include "DescriptorAllocator.h"
 #include "Misc.h"
 
@@ -14,40 +15,6 @@ using namespace Microsoft::WRL;
 
 namespace kdGfx
 {
-	uint32_t GetBytesPerPixel(Format format)
-	{
-		switch (format)
-		{
-		case Format::RGBA8Unorm:
-		case Format::RGBA8Srgb:
-		case Format::BGRA8Unorm:
-		case Format::BGRA8Srgb:
-		case Format::R32Uint:
-		case Format::R32Sfloat:
-		case Format::D32Sfloat:
-		case Format::D24UnormS8Uint:
-		case Format::S8Uint:
-			return 4;
-		case Format::R8Unorm:
-			return 1;
-		case Format::R16Uint:
-		case Format::D16Unorm:
-			return 2;
-		case Format::RGBA16Unorm:
-		case Format::RGBA16Sfloat:
-			return 8;
-		case Format::RG32Sfloat:
-			return 8;
-		case Format::RGB32Sfloat:
-			return 12;
-		case Format::RGBA32Sfloat:
-			return 16;
-		default:
-			assert(false);
-			return 0;
-		}
-	}
-
 	DXCommandList::DXCommandList(DXDevice& device, CommandListType type) :
 		_device(device),
 		_type(type)
@@ -108,23 +75,117 @@ namespace kdGfx
 
 	void DXCommandList::resourceBarrier(const TextureBarrierDesc& desc)
 	{
-		auto dxTexture = std::dynamic_pointer_cast<DXTexture>(desc.texture);
-		if (!dxTexture) return;
-		if (!dxTexture->getResource()) return;
+		resourceBarriers({ desc }, {});
+	}
+
+	void DXCommandList::resourceBarrier(const BufferBarrierDesc& desc)
+	{
+		resourceBarriers({}, { desc });
+	}
+
+	void DXCommandList::resourceBarriers(const std::vector<TextureBarrierDesc>& textureBarriers,
+		const std::vector<BufferBarrierDesc>& bufferBarriers)
+	{
+		// DX12的屏障没有阶段，只合并成一次调用
+		std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+		barriers.reserve(textureBarriers.size() + bufferBarriers.size());
+		for (const auto& desc : textureBarriers)
+		{
+			auto dxTexture = std::dynamic_pointer_cast<DXTexture>(desc.texture);
+			if (!dxTexture) continue;
+			if (!dxTexture->getResource()) continue;
+
+			// DX12没有队列所有权，切换状态放在主队列一侧，没有主队列时放在获取一侧
+			if (desc.srcQueue != desc.dstQueue)
+			{
+				CommandListType transitionQueue = desc.srcQueue == CommandListType::General ? desc.srcQueue : desc.dstQueue;
+				if (_type != transitionQueue) continue;
+			}
+
+			// 内容无效的placed贴图可能和其他资源共用内存，先激活
+			if (desc.oldState == TextureState::Undefined && dxTexture->isPlaced())
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, dxTexture->getResource().Get()));
+
+			D3D12_RESOURCE_STATES stateBefore = _device.toDxResourceStates(desc.oldState);
+			D3D12_RESOURCE_STATES stateAfter = _device.toDxResourceStates(desc.newState);
+			// 各子资源状态不同时旧状态以追踪的为准
+			const bool isUniform = dxTexture->isStateUniform();
+			// 连续的UAV读写需要等待前面写入完成
+			if (desc.oldState == TextureState::General && desc.newState == TextureState::General)
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(dxTexture->getResource().Get()));
+			if (stateBefore == stateAfter && isUniform)
+				continue;
+
+			// 只切换部分mip或数组层，或者各子资源状态不同时逐个子资源切换
+			const auto& textureDesc = dxTexture->getDesc();
+			const auto& subRange = desc.subRange;
+			if (isUniform && subRange.baseMipLevel == 0 && subRange.baseArrayLayer == 0 &&
+				subRange.levelCount >= textureDesc.mipLevels && subRange.layerCount >= textureDesc.arrayLayers)
+			{
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition
+				(
+					dxTexture->getResource().Get(),
+					stateBefore,
+					stateAfter
+				));
+			}
+			else
+			{
+				const uint32_t endMip = std::min(subRange.baseMipLevel + subRange.levelCount, textureDesc.mipLevels);
+				const uint32_t endLayer = std::min(subRange.baseArrayLayer + subRange.layerCount, textureDesc.arrayLayers);
+				for (uint32_t layer = subRange.baseArrayLayer; layer < endLayer; layer++)
+				{
+					for (uint32_t mip = subRange.baseMipLevel; mip < endMip; mip++)
+					{
+						D3D12_RESOURCE_STATES subresourceBefore = isUniform ? stateBefore :
+							_device.toDxResourceStates(dxTexture->getState(mip, layer));
+						if (subresourceBefore == stateAfter) continue;
+						barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition
+						(
+							dxTexture->getResource().Get(),
+							subresourceBefore,
+							stateAfter,
+							D3D12CalcSubresource(mip, layer, 0, textureDesc.mipLevels, textureDesc.arrayLayers)
+						));
+					}
+				}
+			}
+			dxTexture->setState(desc.newState, { subRange.baseMipLevel, subRange.levelCount, subRange.baseArrayLayer, subRange.layerCount });
+		}
+		// 隐式提升到UAV或COPY_DEST的buffer在ExecuteCommandLists结束前不会退回，之后的读取需要显式切换
+		for (const auto& desc : bufferBarriers)
+		{
+			auto dxBuffer = std::dynamic_pointer_cast<DXBuffer>(desc.buffer);
+			if (!dxBuffer) continue;
+			if (!dxBuffer->getResource()) continue;
+			// upload和readback堆的buffer状态固定
+			if (dxBuffer->getDesc().hostVisible != HostVisible::Invisible) continue;
+
+			if (desc.srcQueue != desc.dstQueue)
+			{
+				CommandListType transitionQueue = desc.srcQueue == CommandListType::General ? desc.srcQueue : desc.dstQueue;
+				if (_type != transitionQueue) continue;
+			}
 
-		D3D12_RESOURCE_STATES stateBefore = _device.toDxResourceStates(desc.oldState);
-		D3D12_RESOURCE_STATES stateAfter = _device.toDxResourceStates(desc.newState);
-		if (stateBefore == stateAfter) return;
+			// 内容无效的placed buffer可能和其他资源共用内存，先激活
+			if (desc.oldState == BufferState::Undefined && dxBuffer->isPlaced())
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, dxBuffer->getResource().Get()));
 
-		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition
-		(
-			dxTexture->getResource().Get(),
-			stateBefore,
-			stateAfter
-		);
-		_commandList4->ResourceBarrier(1, &barrier);
+			D3D12_RESOURCE_STATES stateBefore = _device.toDxResourceStates(desc.oldState);
+			D3D12_RESOURCE_STATES stateAfter = _device.toDxResourceStates(desc.newState);
+			if (stateBefore != stateAfter)
+			{
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(dxBuffer->getResource().Get(), stateBefore, stateAfter));
+			}
+			else if (desc.newState == BufferState::ShaderWrite)
+			{
+				// 连续的UAV读写需要等待前面写入完成
+				barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(dxBuffer->getResource().Get()));
+			}
+		}
 
-		dxTexture->setState(desc.newState);
+		if (!barriers.empty())
+			_commandList4->ResourceBarrier((UINT)barriers.size(), barriers.data());
 	}
 
 	void DXCommandList::setPipeline(const std::shared_ptr<Pipeline>& pipeline)
@@ -374,16 +435,16 @@ namespace kdGfx
 		_commandList4->Dispatch(groupCountX, groupCountY, groupCountZ);
 	}
 
-	void DXCommandList::copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size)
+	void DXCommandList::copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size, size_t srcOffset, size_t dstOffset)
 	{
 		auto dxBufferSrc = std::dynamic_pointer_cast<DXBuffer>(src);
 		auto dxBufferDst = std::dynamic_pointer_cast<DXBuffer>(dst);
 
-		_commandList->CopyBufferRegion(dxBufferDst->getResource().Get(), 0, 
-			dxBufferSrc->getResource().Get(), 0, size);
+		_commandList->CopyBufferRegion(dxBufferDst->getResource().Get(), dstOffset, 
+			dxBufferSrc->getResource().Get(), srcOffset, size);
 	}
 
-	void DXCommandList::copyBufferToTexture(const std::shared_ptr<Buffer>& buffer, const std::shared_ptr<Texture>& texture, uint32_t mipLevel)
+	void DXCommandList::copyBufferToTexture(const std::shared_ptr<Buffer>& buffer, const std::shared_ptr<Texture>& texture, uint32_t mipLevel, size_t bufferOffset)
 	{
 		auto dxBuffer = std::dynamic_pointer_cast<DXBuffer>(buffer);
 		auto dxTexture = std::dynamic_pointer_cast<DXTexture>(texture);
@@ -394,7 +455,7 @@ namespace kdGfx
 		dstLocation.SubresourceIndex = mipLevel;
 
 		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
-		footprint.Offset = 0; 
+		footprint.Offset = bufferOffset; 
 		footprint.Footprint.Format = dxTexture->getDxgiFormat();
 		footprint.Footprint.Width = texture->getWidth();
 		footprint.Footprint.Height = texture->getHeight();
@@ -409,7 +470,7 @@ namespace kdGfx
 		_commandList4->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
 	}
 
-	void DXCommandList::copyTextureToBuffer(const std::shared_ptr<Texture>& texture, const std::shared_ptr<Buffer>& buffer, uint32_t mipLevel)
+	void DXCommandList::copyTextureToBuffer(const std::shared_ptr<Texture>& texture, const std::shared_ptr<Buffer>& buffer, uint32_t mipLevel, size_t bufferOffset)
 	{
 		auto dxBuffer = std::dynamic_pointer_cast<DXBuffer>(buffer);
 		auto dxTexture = std::dynamic_pointer_cast<DXTexture>(texture);
@@ -420,7 +481,7 @@ namespace kdGfx
 		srcLocation.SubresourceIndex = mipLevel;
 
 		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
-		footprint.Offset = 0;
+		footprint.Offset = bufferOffset;
 		footprint.Footprint.Format = dxTexture->getDxgiFormat();
 		footprint.Footprint.Width = texture->getWidth();
 		footprint.Footprint.Height = texture->getHeight();
@@ -469,6 +530,37 @@ namespace kdGfx
 			dxTextureSrc->getResource().Get(), 0, dxTextureDst->getDxgiFormat());
 	}
 
+	void DXCommandList::resetQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count)
+	{
+		// DX12查询不需要重置
+	}
+
+	void DXCommandList::writeTimestamp(const std::shared_ptr<QueryPool>& queryPool, uint32_t index, bool begin)
+	{
+		// DX12时间戳总是在前面的命令完成后写入
+		auto dxQueryPool = std::dynamic_pointer_cast<DXQueryPool>(queryPool);
+		_commandList->EndQuery(dxQueryPool->getQueryHeap().Get(), D3D12_QUERY_TYPE_TIMESTAMP, index);
+	}
+
+	void DXCommandList::beginQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index)
+	{
+		auto dxQueryPool = std::dynamic_pointer_cast<DXQueryPool>(queryPool);
+		_commandList->BeginQuery(dxQueryPool->getQueryHeap().Get(), dxQueryPool->getQueryType(), index);
+	}
+
+	void DXCommandList::endQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index)
+	{
+		auto dxQueryPool = std::dynamic_pointer_cast<DXQueryPool>(queryPool);
+		_commandList->EndQuery(dxQueryPool->getQueryHeap().Get(), dxQueryPool->getQueryType(), index);
+	}
+
+	void DXCommandList::resolveQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count)
+	{
+		auto dxQueryPool = std::dynamic_pointer_cast<DXQueryPool>(queryPool);
+		_commandList->ResolveQueryData(dxQueryPool->getQueryHeap().Get(), dxQueryPool->getQueryType(), first, count,
+			dxQueryPool->getReadbackBuffer().Get(), first * dxQueryPool->getResultSize());
+	}
+
 	void DXCommandList::_applyRootDescriptorTable(DXPipeline* dxPipeline, bool isCompute)
 	{
 		if (_type == CommandListType::Copy)	return;
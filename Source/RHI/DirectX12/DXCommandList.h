@@ -23,6 +23,9 @@ namespace kdGfx
         void beginLabel(const std::string& label, uint32_t color) override;
         void endLabel() override;
         void resourceBarrier(const TextureBarrierDesc& desc) override;
+        void resourceBarrier(const BufferBarrierDesc& desc) override;
+        void resourceBarriers(const std::vector<TextureBarrierDesc>& textureBarriers,
+            const std::vector<BufferBarrierDesc>& bufferBarriers) override;
         void setPipeline(const std::shared_ptr<Pipeline>& pipeline) override;
         void setPushConstant(const void* data)  override;
         void setBindSet(uint32_t set, const std::shared_ptr<BindSet>& bindSet) override;
@@ -37,12 +40,17 @@ namespace kdGfx
         void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) override;
         void drawIndexedIndirect(const std::shared_ptr<Buffer>& buffer, uint32_t drawCount) override;
         void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
-        void copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size) override;
-        void copyBufferToTexture(const std::shared_ptr<Buffer>& buffer, const std::shared_ptr<Texture>& texture, uint32_t mipLevel) override;
-        void copyTextureToBuffer(const std::shared_ptr<Texture>& texture, const std::shared_ptr<Buffer>& buffer, uint32_t mipLevel) override;
+        void copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size, size_t srcOffset, size_t dstOffset) override;
+        void copyBufferToTexture(const std::shared_ptr<Buffer>& buffer, const std::shared_ptr<Texture>& texture, uint32_t mipLevel, size_t bufferOffset) override;
+        void copyTextureToBuffer(const std::shared_ptr<Texture>& texture, const std::shared_ptr<Buffer>& buffer, uint32_t mipLevel, size_t bufferOffset) override;
         void copyTexture(const std::shared_ptr<Texture>& src, const std::shared_ptr<Texture>& dst,
             glm::uvec2 size, glm::ivec2 srcOffset, glm::ivec2 dstOffset) override;
         void resolveTexture(const std::shared_ptr<Texture>& src, const std::shared_ptr<Texture>& dst) override;
+        void resetQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count) override;
+        void writeTimestamp(const std::shared_ptr<QueryPool>& queryPool, uint32_t index, bool begin) override;
+        void beginQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index) override;
+        void endQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index) override;
+        void resolveQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count) override;
 
         inline Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> getCommandList() const { return _commandList; }
 
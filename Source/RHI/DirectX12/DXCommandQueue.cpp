@@ -76,4 +76,27 @@ namespace kdGfx
 		}
 		_commandQueue->ExecuteCommandLists(dxCommandLists.size(), dxCommandLists.data());
 	}
+
+	void DXCommandQueue::submit(const SubmitDesc& desc)
+	{
+		for (const auto& wait : desc.waits)
+		{
+			this->wait(wait.fence, wait.value);
+		}
+		if (!desc.commandLists.empty())
+		{
+			submit(desc.commandLists);
+		}
+		for (const auto& signal : desc.signals)
+		{
+			this->signal(signal.fence, signal.value);
+		}
+	}
+
+	uint64_t DXCommandQueue::getTimestampFrequency()
+	{
+		uint64_t frequency = 0;
+		_commandQueue->GetTimestampFrequency(&frequency);
+		return frequency;
+	}
 }
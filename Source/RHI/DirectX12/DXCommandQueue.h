@@ -19,6 +19,9 @@ namespace kdGfx
         void wait(const std::shared_ptr<Fence>& fence, uint64_t value) override;
         void waitIdle() override;
         void submit(const std::vector<std::shared_ptr<CommandList>>& commandLists) override;
+        // dx12的等待不区分阶段
+        void submit(const SubmitDesc& desc) override;
+        uint64_t getTimestampFrequency() override;
 
         inline Microsoft::WRL::ComPtr<ID3D12CommandQueue> getQueue() const { return _commandQueue; }
 
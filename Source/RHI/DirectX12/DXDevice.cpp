@@ -8,6 +8,7 @@
 #include "DXBindSetLayout.h"
 #include "DXBindSet.h"
 #include "DXPipeline.h"
+#include "DXQueryPool.h"
 #include <directx/d3dx12.h>
 
 using namespace Microsoft::WRL;
@@ -35,6 +36,7 @@ namespace kdGfx
         {
            _rayQuerySupported = featureSupport5.RaytracingTier >= D3D12_RAYTRACING_TIER_1_1;
         }
+        _pipelineStatisticsSupported = true;
 
         D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_HIGHEST_SHADER_MODEL };
         if (SUCCEEDED(_device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel))))
@@ -54,16 +56,28 @@ namespace kdGfx
         _dsvDA = std::make_unique<DescriptorAllocator>(_device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 16);
 	}
 
+    DXDevice::~DXDevice()
+    {
+        waitPipelineCompiles();
+    }
+
     std::shared_ptr<CommandQueue> DXDevice::getCommandQueue(CommandListType type)
     {
         return _queues[type];
     }
 
-    size_t DXDevice::getTextureAllocateSize(const TextureDesc& desc)
+    AllocateInfo DXDevice::getTextureAllocateInfo(const TextureDesc& desc)
     {
         D3D12_RESOURCE_DESC resourceDesc = std::move(DXTexture::getResourceDesc(*this, desc));
         D3D12_RESOURCE_ALLOCATION_INFO allocInfo = _device->GetResourceAllocationInfo(0, 1, &resourceDesc);
-        return MemAlign(allocInfo.SizeInBytes, allocInfo.Alignment);
+        return { MemAlign(allocInfo.SizeInBytes, allocInfo.Alignment), allocInfo.Alignment };
+    }
+
+    AllocateInfo DXDevice::getBufferAllocateInfo(const BufferDesc& desc)
+    {
+        D3D12_RESOURCE_DESC resourceDesc = DXBuffer::getResourceDesc(desc);
+        D3D12_RESOURCE_ALLOCATION_INFO allocInfo = _device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+        return { MemAlign(allocInfo.SizeInBytes, allocInfo.Alignment), allocInfo.Alignment, UINT32_MAX, true };
     }
 
     std::shared_ptr<CommandList> DXDevice::createCommandList(CommandListType type)
@@ -133,6 +147,11 @@ namespace kdGfx
         return std::make_shared<DXRasterPipeline>(*this, desc);
     }
 
+    std::shared_ptr<QueryPool> DXDevice::createQueryPool(const QueryPoolDesc& desc)
+    {
+        return std::make_shared<DXQueryPool>(*this, desc);
+    }
+
     ID3D12CommandSignature* DXDevice::getCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE type, uint32_t stride)
     {
         auto it = _commandSignatures.find(std::make_tuple(type, stride));
@@ -230,4 +249,21 @@ namespace kdGfx
         assert(mapping.count(state));
         return mapping[state];
     }
+
+    D3D12_RESOURCE_STATES DXDevice::toDxResourceStates(BufferState state) const
+    {
+        static std::unordered_map<BufferState, D3D12_RESOURCE_STATES> mapping =
+        {
+            { BufferState::Undefined, D3D12_RESOURCE_STATE_COMMON },
+            { BufferState::CopyDst, D3D12_RESOURCE_STATE_COPY_DEST },
+            { BufferState::CopySrc, D3D12_RESOURCE_STATE_COPY_SOURCE },
+            { BufferState::VertexIndex, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER },
+            { BufferState::Indirect, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT },
+            { BufferState::Constant, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER },
+            { BufferState::ShaderRead, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE },
+            { BufferState::ShaderWrite, D3D12_RESOURCE_STATE_UNORDERED_ACCESS }
+        };
+        assert(mapping.count(state));
+        return mapping[state];
+    }
 }
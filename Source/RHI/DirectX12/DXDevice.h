@@ -14,9 +14,11 @@ namespace kdGfx
     {
     public:
         DXDevice(DXAdapter& adapter);
+        virtual ~DXDevice();
 
         std::shared_ptr<CommandQueue> getCommandQueue(CommandListType type) override;
-        size_t getTextureAllocateSize(const TextureDesc& desc) override;
+        AllocateInfo getTextureAllocateInfo(const TextureDesc& desc) override;
+        AllocateInfo getBufferAllocateInfo(const BufferDesc& desc) override;
         std::shared_ptr<CommandList> createCommandList(CommandListType type) override;
         std::shared_ptr<Fence> createFence(uint64_t initialValue) override;
         std::shared_ptr<Memory> createMemory(const MemoryDesc& desc) override;
@@ -30,11 +32,13 @@ namespace kdGfx
         std::shared_ptr<BindSet> createBindSet(const std::shared_ptr<BindSetLayout>& layout) override;
         std::shared_ptr<Pipeline> createComputePipeline(const ComputePipelineDesc& desc) override;
         std::shared_ptr<Pipeline> createRasterPipeline(const RasterPipelineDesc& desc) override;
+        std::shared_ptr<QueryPool> createQueryPool(const QueryPoolDesc& desc) override;
 
         ID3D12CommandSignature* getCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE type, uint32_t stride);
         Format fromDxgiFormat(DXGI_FORMAT format) const;
         DXGI_FORMAT toDxgiFormat(Format format) const;
         D3D12_RESOURCE_STATES toDxResourceStates(TextureState state) const;
+        D3D12_RESOURCE_STATES toDxResourceStates(BufferState state) const;
 
         inline const DXAdapter& getAdapter() const { return _adapter; }
         inline Microsoft::WRL::ComPtr<ID3D12Device> getDevice() const { return _device; }
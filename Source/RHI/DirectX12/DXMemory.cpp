@@ -6,6 +6,8 @@ namespace kdGfx
     DXMemory::DXMemory(DXDevice& device, const MemoryDesc& desc) :
         _device(device)
     {
+        _desc = desc;
+
 		D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_DEFAULT;
         switch (desc.type)
         {
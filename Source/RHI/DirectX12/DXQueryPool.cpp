@@ -0,0 +1,80 @@
+#include <directx/d3dx12.h>
+
+#include "DXQueryPool.h"
+#include "DXDevice.h"
+#include "Misc.h"
+
+using namespace Microsoft::WRL;
+
+namespace kdGfx
+{
+    DXQueryPool::DXQueryPool(DXDevice& device, const QueryPoolDesc& desc) :
+        _device(device)
+    {
+        _desc = desc;
+
+        D3D12_QUERY_HEAP_DESC heapDesc =
+        {
+            .Type = _desc.type == QueryType::PipelineStatistics ? D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS : D3D12_QUERY_HEAP_TYPE_TIMESTAMP,
+            .Count = _desc.count
+        };
+        if (FAILED(_device.getDevice()->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&_queryHeap))))
+        {
+            spdlog::error("failed to create dx12 query heap: {}", _desc.name);
+            return;
+        }
+        _queryHeap->SetName(StringToWString(_desc.name).c_str());
+
+        D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+        D3D12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(getResultSize() * _desc.count);
+        if (FAILED(_device.getDevice()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE,
+            &resourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&_readbackBuffer))))
+        {
+            spdlog::error("failed to create dx12 query readback buffer: {}", _desc.name);
+            return;
+        }
+    }
+
+    bool DXQueryPool::getResults(uint32_t first, uint32_t count, uint64_t* timestamps)
+    {
+        if (_desc.type != QueryType::Timestamp) return false;
+        return _readResults(first, count, timestamps);
+    }
+
+    bool DXQueryPool::getResults(uint32_t first, uint32_t count, PipelineStatistics* statistics)
+    {
+        if (_desc.type != QueryType::PipelineStatistics) return false;
+
+        std::vector<D3D12_QUERY_DATA_PIPELINE_STATISTICS> dxStatistics(count);
+        if (!_readResults(first, count, dxStatistics.data())) return false;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const auto& dxStatistic = dxStatistics[i];
+            statistics[i] =
+            {
+                .inputVertices = dxStatistic.IAVertices,
+                .inputPrimitives = dxStatistic.IAPrimitives,
+                .vertexShaderInvocations = dxStatistic.VSInvocations,
+                .clippingInvocations = dxStatistic.CInvocations,
+                .clippingPrimitives = dxStatistic.CPrimitives,
+                .pixelShaderInvocations = dxStatistic.PSInvocations,
+                .computeShaderInvocations = dxStatistic.CSInvocations
+            };
+        }
+        return true;
+    }
+
+    bool DXQueryPool::_readResults(uint32_t first, uint32_t count, void* data)
+    {
+        if (!_readbackBuffer) return false;
+
+        const size_t resultSize = getResultSize();
+        D3D12_RANGE readRange = { first * resultSize, (first + count) * resultSize };
+        void* mapped = nullptr;
+        if (FAILED(_readbackBuffer->Map(0, &readRange, &mapped))) return false;
+        memcpy(data, (uint8_t*)mapped + readRange.Begin, count * resultSize);
+        D3D12_RANGE writeRange = { 0, 0 };
+        _readbackBuffer->Unmap(0, &writeRange);
+        return true;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <wrl.h>
+#include <directx/d3d12.h>
+
+#include "../QueryPool.h"
+
+namespace kdGfx
+{
+    class DXDevice;
+
+    // 解析到回读buffer后读取，DX12无法查询是否完成，需要调用者保证GPU已经执行完
+    class DXQueryPool : public QueryPool
+    {
+    public:
+        DXQueryPool(DXDevice& device, const QueryPoolDesc& desc);
+
+        bool getResults(uint32_t first, uint32_t count, uint64_t* timestamps) override;
+        bool getResults(uint32_t first, uint32_t count, PipelineStatistics* statistics) override;
+
+        inline Microsoft::WRL::ComPtr<ID3D12QueryHeap> getQueryHeap() const { return _queryHeap; }
+        inline Microsoft::WRL::ComPtr<ID3D12Resource> getReadbackBuffer() const { return _readbackBuffer; }
+        inline D3D12_QUERY_TYPE getQueryType() const
+        {
+            return _desc.type == QueryType::PipelineStatistics ? D3D12_QUERY_TYPE_PIPELINE_STATISTICS : D3D12_QUERY_TYPE_TIMESTAMP;
+        }
+        inline size_t getResultSize() const
+        {
+            return _desc.type == QueryType::PipelineStatistics ? sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) : sizeof(uint64_t);
+        }
+
+    private:
+        bool _readResults(uint32_t first, uint32_t count, void* data);
+
+        DXDevice& _device;
+        Microsoft::WRL::ComPtr<ID3D12QueryHeap> _queryHeap;
+        Microsoft::WRL::ComPtr<ID3D12Resource> _readbackBuffer;
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BaseTypes.h"
+#include <future>
 
 namespace kdGfx
 {
@@ -9,4 +10,22 @@ namespace kdGfx
     public:
         virtual ~Pipeline() = default;
     };
+
+    // 后台编译的管线，编译完成前可以先用其他管线代替
+    class AsyncPipeline
+    {
+    public:
+        AsyncPipeline(std::shared_future<std::shared_ptr<Pipeline>> future) : _future(std::move(future)) {}
+
+        inline bool isReady() const { return _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+        inline void wait() const { _future.wait(); }
+        // 不阻塞，编译完成前返回fallback
+        inline std::shared_ptr<Pipeline> get(const std::shared_ptr<Pipeline>& fallback = nullptr) const
+        {
+            return isReady() ? _future.get() : fallback;
+        }
+
+    private:
+        std::shared_future<std::shared_ptr<Pipeline>> _future;
+    };
 }
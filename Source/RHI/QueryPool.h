@@ -0,0 +1,22 @@
+#pragma once
+
+#include "BaseTypes.h"
+
+namespace kdGfx
+{
+    // GPU查询，时间戳或管线统计
+    class QueryPool
+    {
+    public:
+        virtual ~QueryPool() = default;
+
+        // 不等待GPU，查询还没有全部完成时返回false
+        virtual bool getResults(uint32_t first, uint32_t count, uint64_t* timestamps) = 0;
+        virtual bool getResults(uint32_t first, uint32_t count, PipelineStatistics* statistics) = 0;
+
+        inline const QueryPoolDesc& getDesc() const { return _desc; }
+
+    protected:
+        QueryPoolDesc _desc;
+    };
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Memory.h"
+#include <algorithm>
+#include <mutex>
 
 namespace kdGfx
 {
@@ -17,15 +19,61 @@ namespace kdGfx
         inline uint32_t getWidth() const { return _desc.width; }
         inline uint32_t getHeight() const { return _desc.height; }
         // 当前追踪状态。跨命令切换状态需要确认前面状态执行完毕
-        inline TextureState getState() const { return _state; }
-        inline void setState(TextureState state) const { _state = state; }
+        // 各mip和数组层状态不同时返回第一个子资源的状态
+        inline TextureState getState() const { return getState(0, 0); }
+        inline TextureState getState(uint32_t mipLevel, uint32_t arrayLayer) const
+        {
+            std::lock_guard<std::mutex> lock(_stateMutex);
+            if (_subresourceStates.empty()) return _state;
+            return _subresourceStates[arrayLayer * _desc.mipLevels + mipLevel];
+        }
+        // 所有mip和数组层状态相同
+        inline bool isStateUniform() const
+        {
+            std::lock_guard<std::mutex> lock(_stateMutex);
+            return _subresourceStates.empty();
+        }
+        inline void setState(TextureState state) const
+        {
+            std::lock_guard<std::mutex> lock(_stateMutex);
+            _state = state;
+            _subresourceStates.clear();
+        }
+        // 只设置range内的mip和数组层
+        inline void setState(TextureState state, const TextureViewDesc& range) const
+        {
+            std::lock_guard<std::mutex> lock(_stateMutex);
+            const uint32_t mipLevels = std::max(_desc.mipLevels, 1u);
+            const uint32_t arrayLayers = std::max(_desc.arrayLayers, 1u);
+            if (range.baseMipLevel >= mipLevels || range.baseArrayLayer >= arrayLayers) return;
+            const uint32_t endMip = range.baseMipLevel + std::min(range.levelCount, mipLevels - range.baseMipLevel);
+            const uint32_t endLayer = range.baseArrayLayer + std::min(range.layerCount, arrayLayers - range.baseArrayLayer);
+
+            if (_subresourceStates.empty())
+                _subresourceStates.assign(mipLevels * arrayLayers, _state);
+            for (uint32_t layer = range.baseArrayLayer; layer < endLayer; layer++)
+            {
+                for (uint32_t mip = range.baseMipLevel; mip < endMip; mip++)
+                    _subresourceStates[layer * mipLevels + mip] = state;
+            }
+            // 全部相同时退回整体状态
+            if (std::all_of(_subresourceStates.begin(), _subresourceStates.end(), [state](TextureState s) { return s == state; }))
+            {
+                _state = state;
+                _subresourceStates.clear();
+            }
+        }
 		// 是否在外部分配的显存
         inline bool isPlaced() const { return !_memory.expired(); }
         inline std::shared_ptr<Memory> getMemory() const { return _memory.lock(); }
 
     protected:
         TextureDesc _desc;
+        // 多线程录制命令时会同时切换状态
+        mutable std::mutex _stateMutex;
         mutable TextureState _state = TextureState::Undefined;
+        // 各子资源状态不同时按数组层、mip排列，相同时为空
+        mutable std::vector<TextureState> _subresourceStates;
 		std::weak_ptr<Memory> _memory;
 		size_t _memoryOffset = 0;
     };
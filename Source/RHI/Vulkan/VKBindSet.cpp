@@ -13,66 +13,19 @@ namespace kdGfx
 
 		assert(entryLayouts.size() > 0);
 
-		bool hasBindless = false;
-		uint32_t maxVarDescriptorCount = 0;
-		// 绑定组分配池
-		std::vector<VkDescriptorPoolSize> poolSizes(entryLayouts.size());
-		for (uint32_t i = 0; i < entryLayouts.size(); ++i)
-		{
-			const BindEntryLayout& entryLayout = entryLayouts[i];
-			VkDescriptorType type = _device.toVkDescriptorType(entryLayout.type);
-			_entriesType[entryLayout.binding] = type;
-			const bool isBindless = (entryLayout.count == UINT32_MAX);
-			if (!hasBindless)	hasBindless = isBindless;
-			const uint32_t maxDescriptorCount = _device.getMaxDescriptorCount(entryLayout.type);
-			maxVarDescriptorCount = std::max(maxVarDescriptorCount, maxDescriptorCount);
-			VkDescriptorPoolSize& poolSize = poolSizes[i];
-			poolSize.descriptorCount = isBindless ? maxDescriptorCount : 1;
-			poolSize.type = type;
-		}
-		VkDescriptorPoolCreateInfo poolInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-			.maxSets = 1,
-			.poolSizeCount = (uint32_t)poolSizes.size(),
-			.pPoolSizes = poolSizes.data()
-		};
-		VkResult vkResult = vkCreateDescriptorPool(_device.getDevice(), &poolInfo, nullptr, &_descriptorPool);
-		if (vkResult != VK_SUCCESS)
-		{
-			spdlog::error("failed to create descriptor pool");
-			return;
-		}
+		for (const BindEntryLayout& entryLayout : entryLayouts)
+			_entriesType[entryLayout.binding] = _device.toVkDescriptorType(entryLayout.type);
 
-		// 绑定组
+		// 从布局共用的池分配，销毁时回收给之后的绑定组
 		auto vkLayout = std::dynamic_pointer_cast<VKBindSetLayout>(_layout);
-		VkDescriptorSetLayout setLayout = vkLayout->getDescriptorSetLayout();
-		VkDescriptorSetAllocateInfo allocInfo = 
-		{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-			.descriptorPool = _descriptorPool,
-			.descriptorSetCount = 1,
-			.pSetLayouts = &setLayout
-		};
-		VkDescriptorSetVariableDescriptorCountAllocateInfo bindlessAllocInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
-			.descriptorSetCount = 1,
-			.pDescriptorCounts = &maxVarDescriptorCount
-		};
-		if (hasBindless)	allocInfo.pNext = &bindlessAllocInfo;
-		vkResult = vkAllocateDescriptorSets(_device.getDevice(), &allocInfo, &_descriptorSet);
-		if (vkResult != VK_SUCCESS)
-		{
-			vkDestroyDescriptorPool(_device.getDevice(), _descriptorPool, nullptr);
-			spdlog::error("failed to allocate descriptor set");
-			return;
-		}
+		auto allocation = vkLayout->getSetPool().allocate();
+		_descriptorSet = allocation.set;
+		_setSlot = allocation.slot;
 	}
 
 	VKBindSet::~VKBindSet()
 	{
-		if (_descriptorPool) vkDestroyDescriptorPool(_device.getDevice(), _descriptorPool, nullptr);
+		if (_descriptorSet) std::dynamic_pointer_cast<VKBindSetLayout>(_layout)->getSetPool().free(_setSlot);
 	}
 
 	void VKBindSet::bindBuffer(uint32_t binding, const std::shared_ptr<Buffer>& buffer)
@@ -26,8 +26,8 @@ namespace kdGfx
 
     private:
         VKDevice& _device;
-        VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
         VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+        uint32_t _setSlot = 0;
         std::unordered_map<uint32_t, VkDescriptorType> _entriesType;
     };
 }
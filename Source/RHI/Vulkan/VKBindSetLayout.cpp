@@ -3,14 +3,17 @@
 
 namespace kdGfx
 {
-	VKBindSetLayout::VKBindSetLayout(VKDevice& device, const std::vector<BindEntryLayout>& entryLayouts) :
+	VKBindSetLayout::VKBindSetLayout(VKDevice& device, const std::vector<BindEntryLayout>& entryLayouts, bool updateAfterBind, bool partiallyBound) :
 		_device(device)
 	{
 		_entryLayouts = entryLayouts;
 
 		bool hasBindless = false;
+		uint32_t variableDescriptorCount = 0;
 		std::vector<VkDescriptorSetLayoutBinding> descLayoutBindings(entryLayouts.size());
 		std::vector<VkDescriptorBindingFlags> descLayoutBindingFlags(entryLayouts.size());
+		// 绑定组分配池的大小
+		std::vector<VkDescriptorPoolSize> poolSizes(entryLayouts.size());
 		for (size_t i = 0; i < entryLayouts.size(); ++i)
 		{
 			const BindEntryLayout& entryLayout = entryLayouts[i];
@@ -18,17 +21,25 @@ namespace kdGfx
 			const uint32_t maxDescriptorCount = _device.getMaxDescriptorCount(entryLayout.type);
 			VkDescriptorSetLayoutBinding& descLayoutBinding = descLayoutBindings[i];
 			descLayoutBinding.binding = entryLayout.binding;
-			descLayoutBinding.descriptorCount = isBindless ? maxDescriptorCount : 1;
+			descLayoutBinding.descriptorCount = isBindless ? maxDescriptorCount : entryLayout.count;
 			descLayoutBinding.descriptorType = _device.toVkDescriptorType(entryLayout.type);
 			descLayoutBinding.stageFlags = _device.toVkShaderStageFlags(entryLayout.visible);
 			if (!hasBindless)	hasBindless = isBindless;
 			VkDescriptorBindingFlags flags = 0;
 			if (isBindless) flags = VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+			if (updateAfterBind) flags |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+			if (partiallyBound) flags |= VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
 			descLayoutBindingFlags[i] = flags;
+			_content.insert(_content.end(), { descLayoutBinding.binding, (uint32_t)descLayoutBinding.descriptorType,
+				descLayoutBinding.descriptorCount, descLayoutBinding.stageFlags, flags });
+			if (isBindless)	variableDescriptorCount = maxDescriptorCount;
+			poolSizes[i] = { descLayoutBinding.descriptorType, descLayoutBinding.descriptorCount };
 		}
+		for (uint32_t value : _content) HashCombine(_hash, value);
 		VkDescriptorSetLayoutCreateInfo descLayoutInfoCreateInfo =
 		{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = updateAfterBind ? (VkDescriptorSetLayoutCreateFlags)VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0,
 			.bindingCount = (uint32_t)descLayoutBindings.size(),
 			.pBindings = descLayoutBindings.data()
 		};
@@ -38,12 +49,15 @@ namespace kdGfx
 			.bindingCount = (uint32_t)descLayoutBindingFlags.size(),
 			.pBindingFlags = descLayoutBindingFlags.data()
 		};
-		if (hasBindless)	descLayoutInfoCreateInfo.pNext = &descSetLayoutBindingFlagsCreateInfo;
+		if (hasBindless || updateAfterBind || partiallyBound)	descLayoutInfoCreateInfo.pNext = &descSetLayoutBindingFlagsCreateInfo;
 		vkCreateDescriptorSetLayout(_device.getDevice(), &descLayoutInfoCreateInfo, nullptr, &_descriptorSetLayout);
+
+		_setPool = std::make_unique<VKDescriptorSetPool>(_device, _descriptorSetLayout, poolSizes, variableDescriptorCount, updateAfterBind);
 	}
 
 	VKBindSetLayout::~VKBindSetLayout()
 	{
+		_setPool.reset();
 		vkDestroyDescriptorSetLayout(_device.getDevice(), _descriptorSetLayout, nullptr);
 	}
 }
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 
 #include "../BindSetLayout.h"
+#include "VKDescriptorHeap.h"
 
 namespace kdGfx
 {
@@ -11,13 +12,24 @@ namespace kdGfx
     class VKBindSetLayout : public BindSetLayout
     {
     public:
-        VKBindSetLayout(VKDevice& device, const std::vector<BindEntryLayout>& entryLayouts);
+        // updateAfterBind的布局绑定后还可以更新没有使用的描述符
+        // partiallyBound的布局允许着色器没有访问的描述符不写入
+        VKBindSetLayout(VKDevice& device, const std::vector<BindEntryLayout>& entryLayouts, bool updateAfterBind = false, bool partiallyBound = false);
         virtual ~VKBindSetLayout();
 
         inline VkDescriptorSetLayout getDescriptorSetLayout() const { return _descriptorSetLayout; }
+        // 内容哈希，内容相同的布局兼容
+        inline size_t getHash() const { return _hash; }
+        // 每个绑定的binding、类型、数量、着色器阶段和标志依次排列，哈希相同时比较
+        inline const std::vector<uint32_t>& getContent() const { return _content; }
+        // 这个布局的绑定组都从这里分配
+        inline VKDescriptorSetPool& getSetPool() { return *_setPool; }
 
     private:
         VKDevice& _device;
         VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+        size_t _hash = 0;
+        std::vector<uint32_t> _content;
+        std::unique_ptr<VKDescriptorSetPool> _setPool;
     };
 }
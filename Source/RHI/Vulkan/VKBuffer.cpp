@@ -50,12 +50,7 @@ namespace kdGfx
 			_desc.hostVisible = HostVisible::Upload;
 		}
 
-		VkBufferCreateInfo bufferCreateInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-			.size = desc.size,
-			.usage = BufferUsageToVkBufferUsage(_desc.usage)
-		};
+		VkBufferCreateInfo bufferCreateInfo = getCreateInfo(_desc);
 		if (vkCreateBuffer(_device.getDevice(), &bufferCreateInfo, nullptr, &_buffer) != VK_SUCCESS)
 		{
 			spdlog::error("failed to create vulkan buffer: {}", _desc.name);
@@ -67,19 +62,7 @@ namespace kdGfx
 			properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
 				VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
 		}
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(_device.getDevice(), _buffer, &memRequirements);
-		VkMemoryAllocateInfo allocInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = memRequirements.size,
-			.memoryTypeIndex = _device.findMemoryType(memRequirements.memoryTypeBits, properties)
-		};
-		if (vkAllocateMemory(_device.getDevice(), &allocInfo, nullptr, &_bufferMemory) != VK_SUCCESS)
-		{
-			RuntimeError("failed to allocate vulkan buffer memory");
-		}
-		vkBindBufferMemory(_device.getDevice(), _buffer, _bufferMemory, 0);
+		_allocation = _device.getMemoryAllocator().allocateBufferMemory(_buffer, properties);
 
 		if (!_desc.name.empty())
 		{
@@ -104,17 +87,18 @@ namespace kdGfx
 			_desc.hostVisible = HostVisible::Upload;
 		}
 
-		VkBufferCreateInfo bufferCreateInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-			.size = desc.size,
-			.usage = BufferUsageToVkBufferUsage(_desc.usage)
-		};
+		VkBufferCreateInfo bufferCreateInfo = getCreateInfo(_desc);
 		if (vkCreateBuffer(_device.getDevice(), &bufferCreateInfo, nullptr, &_buffer) != VK_SUCCESS)
 		{
 			spdlog::error("failed to create vulkan buffer: {}", _desc.name);
 		}
 
+		VkMemoryRequirements memRequirements = {};
+		vkGetBufferMemoryRequirements(device.getDevice(), _buffer, &memRequirements);
+		if (!(memRequirements.memoryTypeBits & (1u << memory->getMemoryTypeIndex())))
+		{
+			spdlog::error("vulkan memory type {} not supported by buffer: {}", memory->getMemoryTypeIndex(), _desc.name);
+		}
 		vkBindBufferMemory(device.getDevice(), _buffer, memory->getMemory(), offset);
 
 		if (!_desc.name.empty())
@@ -133,28 +117,31 @@ namespace kdGfx
 		_memoryOffset = offset;
 	}
 
+	VkBufferCreateInfo VKBuffer::getCreateInfo(const BufferDesc& desc)
+	{
+		return
+		{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = desc.size,
+			.usage = BufferUsageToVkBufferUsage(desc.usage)
+		};
+	}
+
 	VKBuffer::~VKBuffer()
 	{
-		if (_bufferMemory)
-			vkFreeMemory(_device.getDevice(), _bufferMemory, nullptr);
 		vkDestroyBuffer(_device.getDevice(), _buffer, nullptr);
+		_device.getMemoryAllocator().free(_allocation);
 	}
 
+	// host可见的内存块是持久映射的，直接返回分配的地址
 	void* VKBuffer::map()
 	{
-		if (_mappedPtr == nullptr && (_desc.hostVisible != HostVisible::Invisible))
-		{
-			vkMapMemory(_device.getDevice(), _bufferMemory, 0, _desc.size, 0, &_mappedPtr);
-		}
-		return _mappedPtr;
+		if (_desc.hostVisible == HostVisible::Invisible)
+			return nullptr;
+		return _allocation.mappedPtr;
 	}
 
 	void VKBuffer::unmap()
 	{
-		if (_mappedPtr && (_desc.hostVisible != HostVisible::Invisible))
-		{
-			vkUnmapMemory(_device.getDevice(), _bufferMemory);
-			_mappedPtr = nullptr;
-		}
 	}
 }
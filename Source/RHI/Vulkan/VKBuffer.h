@@ -18,12 +18,13 @@ namespace kdGfx
         void* map() override;
         void unmap() override;
 
+        static VkBufferCreateInfo getCreateInfo(const BufferDesc& desc);
+
         inline VkBuffer getBuffer() const { return _buffer; }
 
     private:
         VKDevice& _device;
-        VkDeviceMemory _bufferMemory = VK_NULL_HANDLE;
+        VKAllocation _allocation;
         VkBuffer _buffer = VK_NULL_HANDLE;
-        void* _mappedPtr = nullptr;
     };
 }
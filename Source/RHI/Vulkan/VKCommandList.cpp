@@ -5,42 +5,28 @@
 #include "VKBindSet.h"
 #include "VKBuffer.h"
 #include "VKTexture.h"
+#include "VKQueryPool.h"
 
 namespace kdGfx
 {
 	VKCommandList::VKCommandList(VKDevice& device, CommandListType type) :
-		_device(device)
+		_device(device),
+		_type(type),
+		_queue(static_cast<VKCommandQueue&>(*device.getCommandQueue(type)))
 	{
-		uint32_t queueFamilyIndex = device.getQueueFamilyIndex(type);
-
-		VkCommandPoolCreateInfo cmdPoolCreateInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-			.queueFamilyIndex = queueFamilyIndex
-		};
-		vkCreateCommandPool(_device.getDevice(), &cmdPoolCreateInfo, nullptr, &_commandPool);
-
-		VkCommandBufferAllocateInfo cmdAllocCreateInfo = 
-		{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = _commandPool,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = 1
-		};
-		vkAllocateCommandBuffers(_device.getDevice(), &cmdAllocCreateInfo, &_commandBuffer);
+		// 命令池从队列的空闲列表取，销毁时还回去
+		_allocator = _queue.acquireCommandAllocator();
+		_commandBuffer = _allocator.commandBuffer;
 	}
 
 	VKCommandList::~VKCommandList()
 	{
-		vkFreeCommandBuffers(_device.getDevice(), _commandPool, 1, &_commandBuffer);
-		vkDestroyCommandPool(_device.getDevice(), _commandPool, nullptr);
+		_queue.releaseCommandAllocator(_allocator, _submitQueue, _submitValue);
 	}
 
 	void VKCommandList::reset()
 	{
-		vkResetCommandPool(_device.getDevice(), _commandPool, 0);
-		vkResetCommandBuffer(_commandBuffer, 0);
+		vkResetCommandPool(_device.getDevice(), _allocator.commandPool, 0);
 	}
 
 	void VKCommandList::begin()
@@ -75,34 +61,112 @@ namespace kdGfx
 
 	void VKCommandList::resourceBarrier(const TextureBarrierDesc& desc)
 	{
-		auto vkTexture = std::dynamic_pointer_cast<VKTexture>(desc.texture);
-		if (!vkTexture) return;
-		if (!vkTexture->getImage()) return;
+		resourceBarriers({ desc }, {});
+	}
 
-		VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-		VkImageLayout oldLayout = _device.toVkImageLayout(desc.oldState);
-		VkImageLayout newLayout = _device.toVkImageLayout(desc.newState);
-		if (oldLayout == newLayout) return;
+	void VKCommandList::resourceBarrier(const BufferBarrierDesc& desc)
+	{
+		resourceBarriers({}, { desc });
+	}
 
-		imageBarrier.oldLayout = oldLayout;
-		imageBarrier.newLayout = newLayout;
-		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		imageBarrier.image = vkTexture->getImage();
+	void VKCommandList::resourceBarriers(const std::vector<TextureBarrierDesc>& textureBarriers,
+		const std::vector<BufferBarrierDesc>& bufferBarriers)
+	{
+		PipelineStage srcStage = PipelineStage::None;
+		PipelineStage dstStage = PipelineStage::None;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		imageBarriers.reserve(textureBarriers.size());
+		for (const auto& desc : textureBarriers)
+		{
+			auto vkTexture = std::dynamic_pointer_cast<VKTexture>(desc.texture);
+			if (!vkTexture) continue;
+			if (!vkTexture->getImage()) continue;
+
+			VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+			VkImageLayout oldLayout = _device.toVkImageLayout(desc.oldState);
+			VkImageLayout newLayout = _device.toVkImageLayout(desc.newState);
+			uint32_t srcQueueFamilyIndex = _device.getQueueFamilyIndex(_device.getAvailableCommandListType(desc.srcQueue));
+			uint32_t dstQueueFamilyIndex = _device.getQueueFamilyIndex(_device.getAvailableCommandListType(desc.dstQueue));
+			bool queueTransfer = srcQueueFamilyIndex != dstQueueFamilyIndex;
+
+			imageBarrier.oldLayout = oldLayout;
+			imageBarrier.newLayout = newLayout;
+			imageBarrier.srcQueueFamilyIndex = queueTransfer ? srcQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = queueTransfer ? dstQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = vkTexture->getImage();
+
+			imageBarrier.subresourceRange.aspectMask = _device.getAspectFlagsFromFormat(vkTexture->getVkFormat());
+			imageBarrier.subresourceRange.baseMipLevel = desc.subRange.baseMipLevel;
+			imageBarrier.subresourceRange.levelCount = desc.subRange.levelCount;
+			imageBarrier.subresourceRange.baseArrayLayer = desc.subRange.baseArrayLayer;
+			imageBarrier.subresourceRange.layerCount = desc.subRange.layerCount;
+
+			imageBarrier.srcAccessMask = _device.getAccessFlagsFromImageLayout(oldLayout);
+			imageBarrier.dstAccessMask = _device.getAccessFlagsFromImageLayout(newLayout);
+
+			// 释放一侧只等待源阶段，获取一侧只阻塞目标阶段
+			bool isRelease = queueTransfer && _device.getQueueFamilyIndex(_type) == srcQueueFamilyIndex;
+			bool isAcquire = queueTransfer && !isRelease;
+			if (isRelease)
+				imageBarrier.dstAccessMask = 0;
+			else
+				dstStage |= desc.dstStage;
+			if (isAcquire)
+				imageBarrier.srcAccessMask = 0;
+			else
+				srcStage |= desc.srcStage;
 
-		imageBarrier.subresourceRange.aspectMask = _device.getAspectFlagsFromFormat(vkTexture->getVkFormat());
-		imageBarrier.subresourceRange.baseMipLevel = desc.subRange.baseMipLevel;
-		imageBarrier.subresourceRange.levelCount = desc.subRange.levelCount;
-		imageBarrier.subresourceRange.baseArrayLayer = desc.subRange.baseArrayLayer;
-		imageBarrier.subresourceRange.layerCount = desc.subRange.layerCount;
+			imageBarriers.push_back(imageBarrier);
+			vkTexture->setState(desc.newState, { desc.subRange.baseMipLevel, desc.subRange.levelCount, desc.subRange.baseArrayLayer, desc.subRange.layerCount });
+		}
 
-		imageBarrier.srcAccessMask = _device.getAccessFlagsFromImageLayout(oldLayout);
-		imageBarrier.dstAccessMask = _device.getAccessFlagsFromImageLayout(newLayout);
+		std::vector<VkBufferMemoryBarrier> vkBufferBarriers;
+		vkBufferBarriers.reserve(bufferBarriers.size());
+		for (const auto& desc : bufferBarriers)
+		{
+			auto vkBuffer = std::dynamic_pointer_cast<VKBuffer>(desc.buffer);
+			if (!vkBuffer) continue;
+			if (!vkBuffer->getBuffer()) continue;
 
-		vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-			0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+			uint32_t srcQueueFamilyIndex = _device.getQueueFamilyIndex(_device.getAvailableCommandListType(desc.srcQueue));
+			uint32_t dstQueueFamilyIndex = _device.getQueueFamilyIndex(_device.getAvailableCommandListType(desc.dstQueue));
+			bool queueTransfer = srcQueueFamilyIndex != dstQueueFamilyIndex;
+
+			VkBufferMemoryBarrier bufferBarrier =
+			{
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+				.srcAccessMask = _device.getAccessFlagsFromBufferState(desc.oldState),
+				.dstAccessMask = _device.getAccessFlagsFromBufferState(desc.newState),
+				.srcQueueFamilyIndex = queueTransfer ? srcQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = queueTransfer ? dstQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED,
+				.buffer = vkBuffer->getBuffer(),
+				.offset = 0,
+				.size = VK_WHOLE_SIZE
+			};
+
+			bool isRelease = queueTransfer && _device.getQueueFamilyIndex(_type) == srcQueueFamilyIndex;
+			bool isAcquire = queueTransfer && !isRelease;
+			if (isRelease)
+				bufferBarrier.dstAccessMask = 0;
+			else
+				dstStage |= desc.dstStage;
+			if (isAcquire)
+				bufferBarrier.srcAccessMask = 0;
+			else
+				srcStage |= desc.srcStage;
 
-		vkTexture->setState(desc.newState);
+			vkBufferBarriers.push_back(bufferBarrier);
+		}
+
+		if (imageBarriers.empty() && vkBufferBarriers.empty()) return;
+
+		VkPipelineStageFlags srcStageMask = srcStage == PipelineStage::None ?
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : _device.toVkPipelineStageFlags(srcStage, _type);
+		VkPipelineStageFlags dstStageMask = dstStage == PipelineStage::None ?
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : _device.toVkPipelineStageFlags(dstStage, _type);
+		vkCmdPipelineBarrier(_commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr,
+			(uint32_t)vkBufferBarriers.size(), vkBufferBarriers.data(),
+			(uint32_t)imageBarriers.size(), imageBarriers.data());
 	}
 
 	void VKCommandList::setPipeline(const std::shared_ptr<Pipeline>& pipeline)
@@ -350,27 +414,28 @@ namespace kdGfx
 		vkCmdDispatch(_commandBuffer, groupCountX, groupCountY, groupCountZ);
 	}
 
-	void VKCommandList::copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size)
+	void VKCommandList::copyBuffer(const std::shared_ptr<Buffer>& src, const std::shared_ptr<Buffer>& dst, size_t size, size_t srcOffset, size_t dstOffset)
 	{
 		auto vkBufferSrc = std::dynamic_pointer_cast<VKBuffer>(src);
 		auto vkBufferDst = std::dynamic_pointer_cast<VKBuffer>(dst);
 
 		VkBufferCopy copyRegion = 
 		{
-			.srcOffset = 0,
-			.dstOffset = 0,
+			.srcOffset = srcOffset,
+			.dstOffset = dstOffset,
 			.size = size
 		};
 		vkCmdCopyBuffer(_commandBuffer, vkBufferSrc->getBuffer(), vkBufferDst->getBuffer(), 1, &copyRegion);
 	}
 
-	void VKCommandList::copyBufferToTexture(const std::shared_ptr<Buffer>& buffer, const std::shared_ptr<Texture>& texture, uint32_t mipLevel)
+	void VKCommandList::copyBufferToTexture(const std::shared_ptr<Buffer>& buffer, const std::shared_ptr<Texture>& texture, uint32_t mipLevel, size_t bufferOffset)
 	{
 		auto vkBuffer = std::dynamic_pointer_cast<VKBuffer>(buffer);
 		auto vkTexture = std::dynamic_pointer_cast<VKTexture>(texture);
 
 		VkBufferImageCopy copyRegion = 
 		{
+			.bufferOffset = bufferOffset,
 			.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, 1 },
 			.imageOffset = { 0, 0, 0 },
 			.imageExtent = { texture->getWidth(), texture->getHeight(), 1 }
@@ -379,13 +444,14 @@ namespace kdGfx
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
 	}
 	
-	void VKCommandList::copyTextureToBuffer(const std::shared_ptr<Texture>& texture, const std::shared_ptr<Buffer>& buffer, uint32_t mipLevel)
+	void VKCommandList::copyTextureToBuffer(const std::shared_ptr<Texture>& texture, const std::shared_ptr<Buffer>& buffer, uint32_t mipLevel, size_t bufferOffset)
 	{
 		auto vkBuffer = std::dynamic_pointer_cast<VKBuffer>(buffer);
 		auto vkTexture = std::dynamic_pointer_cast<VKTexture>(texture);
 
 		VkBufferImageCopy copyRegion =
 		{
+			.bufferOffset = bufferOffset,
 			.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 0, 1 },
 			.imageOffset = { 0, 0, 0 },
 			.imageExtent = { texture->getWidth(), texture->getHeight(), 1 }
@@ -429,4 +495,34 @@ namespace kdGfx
 		vkCmdResolveImage(_commandBuffer, vkTextureSrc->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			vkTextureDst->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &resolveRegion);
 	}
+
+	void VKCommandList::resetQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count)
+	{
+		auto vkQueryPool = std::dynamic_pointer_cast<VKQueryPool>(queryPool);
+		vkCmdResetQueryPool(_commandBuffer, vkQueryPool->getQueryPool(), first, count);
+	}
+
+	void VKCommandList::writeTimestamp(const std::shared_ptr<QueryPool>& queryPool, uint32_t index, bool begin)
+	{
+		auto vkQueryPool = std::dynamic_pointer_cast<VKQueryPool>(queryPool);
+		VkPipelineStageFlagBits stage = begin ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		vkCmdWriteTimestamp(_commandBuffer, stage, vkQueryPool->getQueryPool(), index);
+	}
+
+	void VKCommandList::beginQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index)
+	{
+		auto vkQueryPool = std::dynamic_pointer_cast<VKQueryPool>(queryPool);
+		vkCmdBeginQuery(_commandBuffer, vkQueryPool->getQueryPool(), index, 0);
+	}
+
+	void VKCommandList::endQuery(const std::shared_ptr<QueryPool>& queryPool, uint32_t index)
+	{
+		auto vkQueryPool = std::dynamic_pointer_cast<VKQueryPool>(queryPool);
+		vkCmdEndQuery(_commandBuffer, vkQueryPool->getQueryPool(), index);
+	}
+
+	void VKCommandList::resolveQueries(const std::shared_ptr<QueryPool>& queryPool, uint32_t first, uint32_t count)
+	{
+		// Vulkan直接从查询池读取结果
+	}
 }
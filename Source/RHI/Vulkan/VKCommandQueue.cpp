@@ -5,86 +5,232 @@
 
 namespace kdGfx
 {
-	VKCommandQueue::VKCommandQueue(VKDevice& device, uint32_t queueFamilyIndex) :
+	VKCommandQueue::VKCommandQueue(VKDevice& device, CommandListType type, uint32_t queueFamilyIndex) :
 		_device(device),
+		_type(type),
 		_queueFamilyIndex(queueFamilyIndex)
 	{
 		vkGetDeviceQueue(_device.getDevice(), _queueFamilyIndex, 0, &_queue);
-	}
 
-	void VKCommandQueue::signal(const std::shared_ptr<Fence>& fence, uint64_t value)
-	{
-		auto vkFence = std::dynamic_pointer_cast<VKFence>(fence);
-		if (!vkFence) return;
-		if (!vkFence->getTimelineSemaphore()) return;
-
-		VkTimelineSemaphoreSubmitInfo timelineInfo =
+		VkSemaphoreTypeCreateInfo timelineCreateInfo =
 		{
-			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
-			.signalSemaphoreValueCount = 1,
-			.pSignalSemaphoreValues = &value
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue = 0
 		};
-		VkSemaphore timelineSemaphore = vkFence->getTimelineSemaphore();
-		VkSubmitInfo submitInfo =
+		VkSemaphoreCreateInfo semaphoreCreateInfo =
 		{
-			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-			.pNext = &timelineInfo,
-			.signalSemaphoreCount = 1,
-			.pSignalSemaphores = &timelineSemaphore
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = &timelineCreateInfo
 		};
-		vkQueueSubmit(_queue, 1, &submitInfo, nullptr);
+		vkCreateSemaphore(_device.getDevice(), &semaphoreCreateInfo, nullptr, &_submitSemaphore);
 	}
 
-	void VKCommandQueue::wait(const std::shared_ptr<Fence>& fence, uint64_t value)
+	VKCommandQueue::~VKCommandQueue()
 	{
-		auto vkFence = std::dynamic_pointer_cast<VKFence>(fence);
-		if (!vkFence) return;
-		if (!vkFence->getTimelineSemaphore()) return;
-
-		VkTimelineSemaphoreSubmitInfo timelineInfo =
+		waitIdle();
+		for (auto& retired : _retiredAllocators)
 		{
-			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
-			.waitSemaphoreValueCount = 1,
-			.pWaitSemaphoreValues = &value,
-		};
-		VkSemaphore timelineSemaphore = vkFence->getTimelineSemaphore();
-		VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-		VkSubmitInfo submitInfo = 
-		{
-			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-			.pNext = &timelineInfo,
-			.waitSemaphoreCount = 1,
-			.pWaitSemaphores = &timelineSemaphore,
-			.pWaitDstStageMask = &waitDstStageMask
+			vkDestroyCommandPool(_device.getDevice(), retired.allocator.commandPool, nullptr);
+		}
+		vkDestroySemaphore(_device.getDevice(), _submitSemaphore, nullptr);
+	}
 
-		};
-		vkQueueSubmit(_queue, 1, &submitInfo, nullptr);
+	void VKCommandQueue::signal(const std::shared_ptr<Fence>& fence, uint64_t value)
+	{
+		submit({ .signals = { { fence, value } } });
+	}
+
+	void VKCommandQueue::wait(const std::shared_ptr<Fence>& fence, uint64_t value)
+	{
+		submit({ .waits = { { fence, value } } });
 	}
 
 	void VKCommandQueue::submit(const std::vector<std::shared_ptr<CommandList>>& commandLists)
 	{
+		submit({ .commandLists = commandLists });
+	}
+
+	void VKCommandQueue::submit(const SubmitDesc& desc)
+	{
+		struct SemaphoreOp
+		{
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			uint64_t value = 0;
+			VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		};
+		std::vector<SemaphoreOp> waits;
+		std::vector<SemaphoreOp> signals;
 		std::vector<VkCommandBuffer> commandBuffers;
-		for (auto& commandList : commandLists)
+		for (const auto& wait : desc.waits)
+		{
+			auto vkFence = std::dynamic_pointer_cast<VKFence>(wait.fence);
+			if (!vkFence || !vkFence->getTimelineSemaphore()) continue;
+			VkPipelineStageFlags stage = _device.toVkPipelineStageFlags(wait.stage, _type);
+			waits.push_back({ vkFence->getTimelineSemaphore(), wait.value, stage ? stage : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT });
+		}
+		for (auto& commandList : desc.commandLists)
 		{
 			auto vkCommandList = std::dynamic_pointer_cast<VKCommandList>(commandList);
 			if (!vkCommandList) continue;
 			if (!vkCommandList->getCommandBuffer()) continue;
 			commandBuffers.emplace_back(vkCommandList->getCommandBuffer());
+			vkCommandList->setSubmitted(this, _submitValue + 1);
+		}
+		for (const auto& signal : desc.signals)
+		{
+			auto vkFence = std::dynamic_pointer_cast<VKFence>(signal.fence);
+			if (!vkFence || !vkFence->getTimelineSemaphore()) continue;
+			signals.push_back({ vkFence->getTimelineSemaphore(), signal.value });
 		}
+		// 内部的timeline semaphore标记这次提交，命令池执行完之后才回收
+		if (!commandBuffers.empty())
+		{
+			signals.push_back({ _submitSemaphore, ++_submitValue });
+		}
+		if (waits.empty() && signals.empty())
+			return;
 
-		VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-		VkSubmitInfo submitInfo = 
+		if (_device.isSynchronization2Supported())
+		{
+			std::vector<VkSemaphoreSubmitInfo> waitInfos;
+			for (const auto& wait : waits)
+			{
+				waitInfos.push_back
+				({
+					.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+					.semaphore = wait.semaphore,
+					.value = wait.value,
+					.stageMask = wait.stage
+				});
+			}
+			std::vector<VkSemaphoreSubmitInfo> signalInfos;
+			for (const auto& signal : signals)
+			{
+				signalInfos.push_back
+				({
+					.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+					.semaphore = signal.semaphore,
+					.value = signal.value,
+					.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+				});
+			}
+			std::vector<VkCommandBufferSubmitInfo> commandBufferInfos;
+			for (auto commandBuffer : commandBuffers)
+			{
+				commandBufferInfos.push_back({ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = commandBuffer });
+			}
+			VkSubmitInfo2 submitInfo =
+			{
+				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+				.waitSemaphoreInfoCount = (uint32_t)waitInfos.size(),
+				.pWaitSemaphoreInfos = waitInfos.data(),
+				.commandBufferInfoCount = (uint32_t)commandBufferInfos.size(),
+				.pCommandBufferInfos = commandBufferInfos.data(),
+				.signalSemaphoreInfoCount = (uint32_t)signalInfos.size(),
+				.pSignalSemaphoreInfos = signalInfos.data()
+			};
+			vkQueueSubmit2(_queue, 1, &submitInfo, VK_NULL_HANDLE);
+			return;
+		}
+
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<VkPipelineStageFlags> waitStages;
+		for (const auto& wait : waits)
+		{
+			waitSemaphores.push_back(wait.semaphore);
+			waitValues.push_back(wait.value);
+			waitStages.push_back(wait.stage);
+		}
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+		for (const auto& signal : signals)
+		{
+			signalSemaphores.push_back(signal.semaphore);
+			signalValues.push_back(signal.value);
+		}
+		VkTimelineSemaphoreSubmitInfo timelineInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.waitSemaphoreValueCount = (uint32_t)waitValues.size(),
+			.pWaitSemaphoreValues = waitValues.data(),
+			.signalSemaphoreValueCount = (uint32_t)signalValues.size(),
+			.pSignalSemaphoreValues = signalValues.data()
+		};
+		VkSubmitInfo submitInfo =
 		{
 			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-			.pWaitDstStageMask = &waitDstStageMask,
+			.pNext = &timelineInfo,
+			.waitSemaphoreCount = (uint32_t)waitSemaphores.size(),
+			.pWaitSemaphores = waitSemaphores.data(),
+			.pWaitDstStageMask = waitStages.data(),
 			.commandBufferCount = (uint32_t)commandBuffers.size(),
-			.pCommandBuffers = commandBuffers.data()
+			.pCommandBuffers = commandBuffers.data(),
+			.signalSemaphoreCount = (uint32_t)signalSemaphores.size(),
+			.pSignalSemaphores = signalSemaphores.data()
 		};
-		vkQueueSubmit(_queue, 1, &submitInfo, nullptr);
+		vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
 	}
 
 	void VKCommandQueue::waitIdle()
 	{
 		vkQueueWaitIdle(_queue);
 	}
+
+	uint64_t VKCommandQueue::getTimestampFrequency()
+	{
+		// timestampPeriod是每个计数的纳秒数
+		return (uint64_t)(1e9 / _device.getAdapter().getProperties().limits.timestampPeriod);
+	}
+
+	VKCommandQueue::CommandAllocator VKCommandQueue::acquireCommandAllocator()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_allocatorMutex);
+			for (auto it = _retiredAllocators.begin(); it != _retiredAllocators.end(); ++it)
+			{
+				if (it->submitQueue && it->submitQueue->getCompletedValue() < it->submitValue)
+					continue;
+
+				CommandAllocator allocator = it->allocator;
+				_retiredAllocators.erase(it);
+				// 整池重置，命令缓冲一起回到初始状态
+				vkResetCommandPool(_device.getDevice(), allocator.commandPool, 0);
+				return allocator;
+			}
+		}
+
+		CommandAllocator allocator;
+		VkCommandPoolCreateInfo cmdPoolCreateInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = _queueFamilyIndex
+		};
+		vkCreateCommandPool(_device.getDevice(), &cmdPoolCreateInfo, nullptr, &allocator.commandPool);
+
+		VkCommandBufferAllocateInfo cmdAllocCreateInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = allocator.commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		vkAllocateCommandBuffers(_device.getDevice(), &cmdAllocCreateInfo, &allocator.commandBuffer);
+		return allocator;
+	}
+
+	void VKCommandQueue::releaseCommandAllocator(const CommandAllocator& allocator, VKCommandQueue* submitQueue, uint64_t submitValue)
+	{
+		std::lock_guard<std::mutex> lock(_allocatorMutex);
+		_retiredAllocators.push_back({ allocator, submitQueue, submitValue });
+	}
+
+	uint64_t VKCommandQueue::getCompletedValue()
+	{
+		uint64_t value = 0;
+		vkGetSemaphoreCounterValue(_device.getDevice(), _submitSemaphore, &value);
+		return value;
+	}
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <deque>
+#include <mutex>
 
 #include "../BaseTypes.h"
 #include "../CommandQueue.h"
@@ -12,18 +14,48 @@ namespace kdGfx
     class VKCommandQueue : public CommandQueue
     {
     public:
-        VKCommandQueue(VKDevice& device, uint32_t queueFamilyIndex);
+        // 命令池和命令缓冲一一对应，整池重置
+        struct CommandAllocator
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        };
+
+        VKCommandQueue(VKDevice& device, CommandListType type, uint32_t queueFamilyIndex);
+        virtual ~VKCommandQueue();
 
         void signal(const std::shared_ptr<Fence>& fence, uint64_t value) override;
         void wait(const std::shared_ptr<Fence>& fence, uint64_t value) override;
         void waitIdle() override;
         void submit(const std::vector<std::shared_ptr<CommandList>>& commandLists) override;
+        // 支持synchronization2时用vkQueueSubmit2
+        void submit(const SubmitDesc& desc) override;
+        uint64_t getTimestampFrequency() override;
+
+        // 优先复用已经执行完的命令池，没有时新建
+        CommandAllocator acquireCommandAllocator();
+        // submitQueue为空表示没有提交过，可以直接复用
+        void releaseCommandAllocator(const CommandAllocator& allocator, VKCommandQueue* submitQueue, uint64_t submitValue);
+        // 每次submit递增，执行完成后内部的timeline semaphore到达这个值
+        uint64_t getCompletedValue();
         
         inline VkQueue getQueue() const { return _queue; }
 
     private:
         VKDevice& _device;
+        CommandListType _type;
         uint32_t _queueFamilyIndex;
         VkQueue _queue = VK_NULL_HANDLE;
+        VkSemaphore _submitSemaphore = VK_NULL_HANDLE;
+        uint64_t _submitValue = 0;
+
+        struct RetiredAllocator
+        {
+            CommandAllocator allocator;
+            VKCommandQueue* submitQueue = nullptr;
+            uint64_t submitValue = 0;
+        };
+        std::mutex _allocatorMutex;
+        std::deque<RetiredAllocator> _retiredAllocators;
     };
 }
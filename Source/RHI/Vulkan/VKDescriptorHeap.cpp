@@ -0,0 +1,363 @@
+#include "VKDescriptorHeap.h"
+#include "VKDevice.h"
+#include "VKBindSetLayout.h"
+#include "VKBindSet.h"
+#include "VKBuffer.h"
+#include "VKTexture.h"
+
+namespace kdGfx
+{
+	VKDescriptorSetPool::VKDescriptorSetPool(VKDevice& device, VkDescriptorSetLayout setLayout, const std::vector<VkDescriptorPoolSize>& poolSizes,
+		uint32_t variableDescriptorCount, bool updateAfterBind, uint32_t frameLatency) :
+		_device(device),
+		_setLayout(setLayout),
+		_poolSizes(poolSizes),
+		_variableDescriptorCount(variableDescriptorCount),
+		_updateAfterBind(updateAfterBind),
+		_blockSize(variableDescriptorCount > 0 ? 1 : _defaultBlockSize),
+		_frameLatency(frameLatency)
+	{
+		for (auto& poolSize : _poolSizes)
+			poolSize.descriptorCount *= _blockSize;
+	}
+
+	VKDescriptorSetPool::~VKDescriptorSetPool()
+	{
+		const uint32_t blockCount = _blockCount.load();
+		for (uint32_t i = 0; i < blockCount; ++i)
+			vkDestroyDescriptorPool(_device.getDevice(), _blocks[i]->pool, nullptr);
+	}
+
+	VKDescriptorSetPool::Allocation VKDescriptorSetPool::allocate()
+	{
+		auto getNext = [this](uint32_t slot) -> std::atomic<uint32_t>& { return _getNext(slot); };
+		uint32_t slot = _freeList.pop(getNext);
+		if (slot == VKFreeIndexList::Empty)
+		{
+			std::lock_guard<std::mutex> lock(_growMutex);
+			// 等锁期间可能有绑定组被回收
+			slot = _freeList.pop(getNext);
+			if (slot == VKFreeIndexList::Empty)
+			{
+				_recycleRetired();
+				slot = _freeList.pop(getNext);
+			}
+			if (slot == VKFreeIndexList::Empty)
+				slot = _addBlock();
+			if (slot == VKFreeIndexList::Empty)
+				return {};
+		}
+		return { _blocks[slot / _blockSize]->sets[slot % _blockSize], slot };
+	}
+
+	void VKDescriptorSetPool::free(uint32_t slot)
+	{
+		if (slot == VKFreeIndexList::Empty) return;
+		// GPU可能还在用，等frameLatency帧后再复用
+		_blocks[slot / _blockSize]->freedFrames[slot % _blockSize].store(_device.getFrame(), std::memory_order_relaxed);
+		_retiredList.push(slot, [this](uint32_t slot) -> std::atomic<uint32_t>& { return _getNext(slot); });
+	}
+
+	void VKDescriptorSetPool::_recycleRetired()
+	{
+		auto getNext = [this](uint32_t slot) -> std::atomic<uint32_t>& { return _getNext(slot); };
+		const uint64_t frame = _device.getFrame();
+		uint32_t slot = _retiredList.popAll();
+		while (slot != VKFreeIndexList::Empty)
+		{
+			const uint32_t next = getNext(slot).load(std::memory_order_relaxed);
+			const uint64_t freedFrame = _blocks[slot / _blockSize]->freedFrames[slot % _blockSize].load(std::memory_order_relaxed);
+			if (freedFrame + _frameLatency <= frame)
+				_freeList.push(slot, getNext);
+			else
+				_retiredList.push(slot, getNext);
+			slot = next;
+		}
+	}
+
+	uint32_t VKDescriptorSetPool::_addBlock()
+	{
+		const uint32_t blockIndex = _blockCount.load(std::memory_order_relaxed);
+		if (blockIndex >= _blocks.size())
+		{
+			spdlog::error("vulkan descriptor set pool out of blocks");
+			return VKFreeIndexList::Empty;
+		}
+
+		auto block = std::make_unique<Block>();
+		VkDescriptorPoolCreateInfo poolInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.flags = _updateAfterBind ? (VkDescriptorPoolCreateFlags)VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0,
+			.maxSets = _blockSize,
+			.poolSizeCount = (uint32_t)_poolSizes.size(),
+			.pPoolSizes = _poolSizes.data()
+		};
+		VkResult vkResult = vkCreateDescriptorPool(_device.getDevice(), &poolInfo, nullptr, &block->pool);
+		if (vkResult != VK_SUCCESS)
+		{
+			spdlog::error("failed to create descriptor pool");
+			return VKFreeIndexList::Empty;
+		}
+
+		std::vector<VkDescriptorSetLayout> setLayouts(_blockSize, _setLayout);
+		std::vector<uint32_t> variableDescriptorCounts(_blockSize, _variableDescriptorCount);
+		VkDescriptorSetAllocateInfo allocInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.descriptorPool = block->pool,
+			.descriptorSetCount = _blockSize,
+			.pSetLayouts = setLayouts.data()
+		};
+		VkDescriptorSetVariableDescriptorCountAllocateInfo bindlessAllocInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+			.descriptorSetCount = _blockSize,
+			.pDescriptorCounts = variableDescriptorCounts.data()
+		};
+		if (_variableDescriptorCount > 0)	allocInfo.pNext = &bindlessAllocInfo;
+		block->sets.resize(_blockSize);
+		vkResult = vkAllocateDescriptorSets(_device.getDevice(), &allocInfo, block->sets.data());
+		if (vkResult != VK_SUCCESS)
+		{
+			vkDestroyDescriptorPool(_device.getDevice(), block->pool, nullptr);
+			spdlog::error("failed to allocate descriptor set");
+			return VKFreeIndexList::Empty;
+		}
+		block->next = std::make_unique<std::atomic<uint32_t>[]>(_blockSize);
+		block->freedFrames = std::make_unique<std::atomic<uint64_t>[]>(_blockSize);
+
+		_blocks[blockIndex] = std::move(block);
+		_blockCount.store(blockIndex + 1, std::memory_order_release);
+
+		// 第一个槽位直接返回，低位的槽位先被取出
+		const uint32_t firstSlot = blockIndex * _blockSize;
+		for (uint32_t i = _blockSize - 1; i > 0; --i)
+			_freeList.push(firstSlot + i, [this](uint32_t slot) -> std::atomic<uint32_t>& { return _getNext(slot); });
+		return firstSlot;
+	}
+
+	VKBindlessHeap::VKBindlessHeap(VKDevice& device, uint32_t frameLatency) :
+		_device(device),
+		_frameLatency(frameLatency)
+	{
+		const bool updateAfterBind = _device.isDescriptorUpdateAfterBindSupported();
+
+		// 期望的容量，受设备限制
+		VkPhysicalDeviceVulkan12Properties vulkan12Properties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+		VkPhysicalDeviceProperties2 properties2 = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &vulkan12Properties };
+		vkGetPhysicalDeviceProperties2(_device.getAdapter().getPhysicalDevice(), &properties2);
+		const VkPhysicalDeviceLimits& limits = properties2.properties.limits;
+		const std::array<std::tuple<BindEntryType, uint32_t, uint32_t>, 4> rangeInfos =
+		{ {
+			{ BindEntryType::SampledTexture, 16384, updateAfterBind ?
+				std::min(vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages, vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages) :
+				std::min(limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSampledImages) },
+			{ BindEntryType::StorageTexture, 4096, updateAfterBind ?
+				std::min(vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageImages, vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageImages) :
+				std::min(limits.maxPerStageDescriptorStorageImages, limits.maxDescriptorSetStorageImages) },
+			{ BindEntryType::StorageBuffer, 16384, updateAfterBind ?
+				std::min(vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers) :
+				std::min(limits.maxPerStageDescriptorStorageBuffers, limits.maxDescriptorSetStorageBuffers) },
+			{ BindEntryType::Sampler, 1024, updateAfterBind ?
+				std::min(vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers, vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers) :
+				std::min(limits.maxPerStageDescriptorSamplers, limits.maxDescriptorSetSamplers) },
+		} };
+
+		std::vector<BindEntryLayout> entryLayouts;
+		for (uint32_t i = 0; i < _ranges.size(); ++i)
+		{
+			auto& [type, desiredCapacity, maxCapacity] = rangeInfos[i];
+			Range& range = _ranges[i];
+			range.type = type;
+			range.capacity = std::min(desiredCapacity, maxCapacity);
+			range.next = std::make_unique<std::atomic<uint32_t>[]>(range.capacity);
+			range.resources = std::make_unique<std::shared_ptr<void>[]>(range.capacity);
+			entryLayouts.push_back({ .binding = i, .type = type, .count = range.capacity });
+		}
+
+		// 没有注册的索引不写描述符，需要部分绑定
+		auto layout = std::make_shared<VKBindSetLayout>(_device, entryLayouts, updateAfterBind, true);
+		auto bindSet = std::make_shared<VKBindSet>(_device, layout);
+		_descriptorSet = bindSet->getDescriptorSet();
+		_layout = layout;
+		_bindSet = bindSet;
+
+		spdlog::info("vulkan bindless heap textures {} storage textures {} buffers {} samplers {}{}",
+			_ranges[0].capacity, _ranges[1].capacity, _ranges[2].capacity, _ranges[3].capacity,
+			updateAfterBind ? "" : ", update after bind not supported");
+	}
+
+	VKBindlessHeap::~VKBindlessHeap()
+	{
+		_bindSet.reset();
+		_layout.reset();
+	}
+
+	BindlessIndex VKBindlessHeap::registerTexture(const std::shared_ptr<TextureView>& textureView, BindEntryType type)
+	{
+		if (type != BindEntryType::SampledTexture && type != BindEntryType::StorageTexture)
+		{
+			spdlog::error("vulkan bindless heap register texture with invalid type");
+			return InvalidBindlessIndex;
+		}
+
+		Range* range = _getRange(type);
+		std::lock_guard<std::mutex> lock(_updateMutex);
+		bool isNew = false;
+		BindlessIndex index = _allocate(*range, textureView, isNew);
+		if (!isNew) return index;
+		auto vkTextureView = std::dynamic_pointer_cast<VKTextureView>(textureView);
+		VkDescriptorImageInfo imageInfo =
+		{
+			.imageView = vkTextureView->getImageView(),
+			.imageLayout = type == BindEntryType::StorageTexture ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+		_write(*range, index, &imageInfo, nullptr);
+		return index;
+	}
+
+	BindlessIndex VKBindlessHeap::registerBuffer(const std::shared_ptr<Buffer>& buffer)
+	{
+		Range& range = *_getRange(BindEntryType::StorageBuffer);
+		std::lock_guard<std::mutex> lock(_updateMutex);
+		bool isNew = false;
+		BindlessIndex index = _allocate(range, buffer, isNew);
+		if (!isNew) return index;
+		VkDescriptorBufferInfo bufferInfo =
+		{
+			.buffer = std::dynamic_pointer_cast<VKBuffer>(buffer)->getBuffer(),
+			.range = VK_WHOLE_SIZE
+		};
+		_write(range, index, nullptr, &bufferInfo);
+		return index;
+	}
+
+	BindlessIndex VKBindlessHeap::registerSampler(const std::shared_ptr<Sampler>& sampler)
+	{
+		Range& range = *_getRange(BindEntryType::Sampler);
+		std::lock_guard<std::mutex> lock(_updateMutex);
+		bool isNew = false;
+		BindlessIndex index = _allocate(range, sampler, isNew);
+		if (!isNew) return index;
+		VkDescriptorImageInfo imageInfo =
+		{
+			.sampler = std::dynamic_pointer_cast<VKSampler>(sampler)->getSampler()
+		};
+		_write(range, index, &imageInfo, nullptr);
+		return index;
+	}
+
+	void VKBindlessHeap::releaseTexture(BindlessIndex index, BindEntryType type)
+	{
+		if (Range* range = _getRange(type))
+			_release(*range, index);
+	}
+
+	void VKBindlessHeap::releaseBuffer(BindlessIndex index)
+	{
+		_release(*_getRange(BindEntryType::StorageBuffer), index);
+	}
+
+	void VKBindlessHeap::releaseSampler(BindlessIndex index)
+	{
+		_release(*_getRange(BindEntryType::Sampler), index);
+	}
+
+	uint32_t VKBindlessHeap::getCapacity(BindEntryType type) const
+	{
+		Range* range = const_cast<VKBindlessHeap*>(this)->_getRange(type);
+		return range ? range->capacity : 0;
+	}
+
+	VKBindlessHeap::Range* VKBindlessHeap::_getRange(BindEntryType type)
+	{
+		switch (type)
+		{
+		case BindEntryType::SampledTexture:
+			return &_ranges[0];
+		case BindEntryType::StorageTexture:
+			return &_ranges[1];
+		case BindEntryType::ReadedBuffer:
+		case BindEntryType::StorageBuffer:
+			return &_ranges[2];
+		case BindEntryType::Sampler:
+			return &_ranges[3];
+		default:
+			return nullptr;
+		}
+	}
+
+	BindlessIndex VKBindlessHeap::_allocate(Range& range, const std::shared_ptr<void>& resource, bool& isNew)
+	{
+		isNew = false;
+		auto it = range.registered.find(resource.get());
+		if (it != range.registered.end())
+		{
+			it->second.second++;
+			return it->second.first;
+		}
+
+		// 优先复用回收的索引，否则取没用过的
+		_recycleRetired(range);
+		BindlessIndex index = range.freeList.pop([&range](uint32_t index) -> std::atomic<uint32_t>& { return range.next[index]; });
+		if (index == VKFreeIndexList::Empty)
+		{
+			uint32_t count = range.count.load(std::memory_order_relaxed);
+			do
+			{
+				if (count >= range.capacity)
+				{
+					spdlog::error("vulkan bindless heap is full, capacity {}", range.capacity);
+					return InvalidBindlessIndex;
+				}
+			} while (!range.count.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+			index = count;
+		}
+		range.resources[index] = resource;
+		range.registered[resource.get()] = { index, 1 };
+		isNew = true;
+		return index;
+	}
+
+	void VKBindlessHeap::_release(Range& range, BindlessIndex index)
+	{
+		if (index >= range.capacity) return;
+		std::lock_guard<std::mutex> lock(_updateMutex);
+		auto it = range.registered.find(range.resources[index].get());
+		if (it == range.registered.end() || it->second.first != index) return;
+		if (--it->second.second > 0) return;
+		range.registered.erase(it);
+		// GPU可能还在用，等frameLatency帧后再回收
+		range.retired.emplace_back(index, _device.getFrame());
+		_recycleRetired(range);
+	}
+
+	void VKBindlessHeap::_recycleRetired(Range& range)
+	{
+		const uint64_t frame = _device.getFrame();
+		while (!range.retired.empty() && range.retired.front().second + _frameLatency <= frame)
+		{
+			const BindlessIndex index = range.retired.front().first;
+			range.retired.pop_front();
+			range.resources[index].reset();
+			range.freeList.push(index, [&range](uint32_t index) -> std::atomic<uint32_t>& { return range.next[index]; });
+		}
+	}
+
+	void VKBindlessHeap::_write(const Range& range, BindlessIndex index, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+	{
+		VkWriteDescriptorSet writeDescSet =
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = _descriptorSet,
+			.dstBinding = (uint32_t)(&range - _ranges.data()),
+			.dstArrayElement = index,
+			.descriptorCount = 1,
+			.descriptorType = _device.toVkDescriptorType(range.type),
+			.pImageInfo = imageInfo,
+			.pBufferInfo = bufferInfo
+		};
+		vkUpdateDescriptorSets(_device.getDevice(), 1, &writeDescSet, 0, nullptr);
+	}
+}
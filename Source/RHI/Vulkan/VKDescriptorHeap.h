@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "../BindlessHeap.h"
+
+namespace kdGfx
+{
+    class VKDevice;
+
+    // 无锁的空闲索引栈，每个索引的后继由调用者保存，头部带版本号避免ABA
+    class VKFreeIndexList
+    {
+    public:
+        static constexpr uint32_t Empty = UINT32_MAX;
+
+        template<typename NextFn>
+        inline void push(uint32_t index, NextFn&& getNext)
+        {
+            uint64_t head = _head.load(std::memory_order_relaxed);
+            do
+            {
+                getNext(index).store((uint32_t)head, std::memory_order_relaxed);
+            } while (!_head.compare_exchange_weak(head, _pack(head, index), std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        // 为空时返回Empty
+        template<typename NextFn>
+        inline uint32_t pop(NextFn&& getNext)
+        {
+            uint64_t head = _head.load(std::memory_order_acquire);
+            while ((uint32_t)head != Empty)
+            {
+                // 索引可能同时被其他线程取走，读到的后继无效时版本号不同，交换失败
+                const uint32_t next = getNext((uint32_t)head).load(std::memory_order_relaxed);
+                if (_head.compare_exchange_weak(head, _pack(head, next), std::memory_order_acquire, std::memory_order_acquire))
+                    return (uint32_t)head;
+            }
+            return Empty;
+        }
+
+        // 取出整个链表，返回链表头
+        inline uint32_t popAll()
+        {
+            uint64_t head = _head.load(std::memory_order_relaxed);
+            while (!_head.compare_exchange_weak(head, _pack(head, Empty), std::memory_order_acq_rel, std::memory_order_relaxed));
+            return (uint32_t)head;
+        }
+
+    private:
+        static inline uint64_t _pack(uint64_t head, uint32_t index) { return (((head >> 32) + 1) << 32) | index; }
+
+        std::atomic<uint64_t> _head = Empty;
+    };
+
+    // 同一布局的绑定组共用描述符池，每块池一次分配多个绑定组，bindless布局每块一个
+    // 绑定组销毁后GPU可能还在用，等frameLatency帧后才回收到空闲列表复用
+    class VKDescriptorSetPool
+    {
+    public:
+        struct Allocation
+        {
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            uint32_t slot = VKFreeIndexList::Empty;
+        };
+
+        // variableDescriptorCount大于0时是bindless布局
+        VKDescriptorSetPool(VKDevice& device, VkDescriptorSetLayout setLayout, const std::vector<VkDescriptorPoolSize>& poolSizes,
+            uint32_t variableDescriptorCount, bool updateAfterBind, uint32_t frameLatency = MaxFrameLatency);
+        ~VKDescriptorSetPool();
+
+        Allocation allocate();
+        void free(uint32_t slot);
+
+    private:
+        struct Block
+        {
+            VkDescriptorPool pool = VK_NULL_HANDLE;
+            std::vector<VkDescriptorSet> sets;
+            std::unique_ptr<std::atomic<uint32_t>[]> next;
+            // 槽位释放时设备的帧号
+            std::unique_ptr<std::atomic<uint64_t>[]> freedFrames;
+        };
+
+        VKDevice& _device;
+        VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPoolSize> _poolSizes;
+        uint32_t _variableDescriptorCount = 0;
+        bool _updateAfterBind = false;
+        uint32_t _blockSize = 0;
+        uint32_t _frameLatency = 0;
+        // 块创建后地址不变，无锁读取
+        std::array<std::unique_ptr<Block>, 256> _blocks;
+        std::atomic<uint32_t> _blockCount = 0;
+        std::mutex _growMutex;
+        VKFreeIndexList _freeList;
+        // 还没过frameLatency帧的槽位，空闲列表用完时在锁内检查
+        VKFreeIndexList _retiredList;
+
+    private:
+        inline std::atomic<uint32_t>& _getNext(uint32_t slot) { return _blocks[slot / _blockSize]->next[slot % _blockSize]; }
+        // 把已经过了frameLatency帧的槽位移到空闲列表
+        void _recycleRetired();
+        // 返回新块的第一个槽位，其余放进空闲列表
+        uint32_t _addBlock();
+        static constexpr uint32_t _defaultBlockSize = 64;
+    };
+
+    class VKBindlessHeap : public BindlessHeap
+    {
+    public:
+        VKBindlessHeap(VKDevice& device, uint32_t frameLatency = MaxFrameLatency);
+        virtual ~VKBindlessHeap();
+
+        BindlessIndex registerTexture(const std::shared_ptr<TextureView>& textureView, BindEntryType type) override;
+        BindlessIndex registerBuffer(const std::shared_ptr<Buffer>& buffer) override;
+        BindlessIndex registerSampler(const std::shared_ptr<Sampler>& sampler) override;
+        void releaseTexture(BindlessIndex index, BindEntryType type) override;
+        void releaseBuffer(BindlessIndex index) override;
+        void releaseSampler(BindlessIndex index) override;
+
+        uint32_t getCapacity(BindEntryType type) const override;
+
+    private:
+        // 每种描述符一段索引空间
+        struct Range
+        {
+            BindEntryType type = BindEntryType::SampledTexture;
+            uint32_t capacity = 0;
+            // 没有用过的索引从这里递增分配
+            std::atomic<uint32_t> count = 0;
+            std::unique_ptr<std::atomic<uint32_t>[]> next;
+            // 注册期间持有资源，索引回收时释放
+            std::unique_ptr<std::shared_ptr<void>[]> resources;
+            VKFreeIndexList freeList;
+            // 释放的索引和释放时设备的帧号，按帧号递增，等待frameLatency帧后回收
+            std::deque<std::pair<BindlessIndex, uint64_t>> retired;
+            // 同一资源重复注册返回同一索引和引用计数，计数归零才回收
+            std::unordered_map<const void*, std::pair<BindlessIndex, uint32_t>> registered;
+        };
+
+        VKDevice& _device;
+        VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+        uint32_t _frameLatency = 0;
+        std::array<Range, 4> _ranges;
+        // vkUpdateDescriptorSets写同一个绑定组需要外部同步，同时保护注册表
+        std::mutex _updateMutex;
+
+    private:
+        Range* _getRange(BindEntryType type);
+        // 已经注册过时返回原来的索引，isNew为false时不需要写描述符
+        BindlessIndex _allocate(Range& range, const std::shared_ptr<void>& resource, bool& isNew);
+        void _release(Range& range, BindlessIndex index);
+        // 把已经过了frameLatency帧的索引放回空闲列表，释放持有的资源。调用时持有_updateMutex
+        void _recycleRetired(Range& range);
+        // 调用时持有_updateMutex
+        void _write(const Range& range, BindlessIndex index, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+    };
+}
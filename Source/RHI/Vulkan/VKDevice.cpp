@@ -9,6 +9,7 @@
 #include "VKPipeline.h"
 #include "VKBindSetLayout.h"
 #include "VKBindSet.h"
+#include "VKQueryPool.h"
 
 extern PFN_vkGetDeviceProcAddr vkGetDeviceProcAddrKD;
 PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameKD = NULL;
@@ -83,6 +84,17 @@ namespace kdGfx
 			queueCreateInfo.pQueuePriorities = &queuePriority;
 		}
 		
+		// bindless堆和合并提交需要的可选特性
+		VkPhysicalDeviceVulkan13Features supportedVulkan13Features = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
+		VkPhysicalDeviceVulkan12Features supportedVulkan12Features = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .pNext = &supportedVulkan13Features };
+		VkPhysicalDeviceFeatures2 supportedFeatures2 = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supportedVulkan12Features };
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+		_descriptorUpdateAfterBindSupported = supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+			supportedVulkan12Features.descriptorBindingStorageImageUpdateAfterBind &&
+			supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind &&
+			supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending;
+		_synchronization2Supported = supportedVulkan13Features.synchronization2;
+
 		// 硬件特性
 		VkPhysicalDeviceVulkan11Features vulkan11Features =
 		{
@@ -93,6 +105,10 @@ namespace kdGfx
 		{
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
 			.pNext = &vulkan11Features,
+			.descriptorBindingSampledImageUpdateAfterBind = _descriptorUpdateAfterBindSupported,
+			.descriptorBindingStorageImageUpdateAfterBind = _descriptorUpdateAfterBindSupported,
+			.descriptorBindingStorageBufferUpdateAfterBind = _descriptorUpdateAfterBindSupported,
+			.descriptorBindingUpdateUnusedWhilePending = _descriptorUpdateAfterBindSupported,
 			.descriptorBindingPartiallyBound = true,
 			.descriptorBindingVariableDescriptorCount = true,
 			.runtimeDescriptorArray = true,
@@ -103,6 +119,7 @@ namespace kdGfx
 		{
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
 			.pNext = &vulkan12Features,
+			.synchronization2 = _synchronization2Supported,
 			.dynamicRendering = true
 		};
 
@@ -125,11 +142,17 @@ namespace kdGfx
 			}
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures = {};
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		_pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery;
+		_bufferImageGranularity = _adapter.getProperties().limits.bufferImageGranularity;
+
 		VkPhysicalDeviceFeatures deviceFeatures = 
 		{
 			.multiDrawIndirect = true,
 			.fillModeNonSolid = true,
 			.samplerAnisotropy = true,
+			.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery,
 			.vertexPipelineStoresAndAtomics = true,
 			.fragmentStoresAndAtomics = true
 		};
@@ -150,14 +173,23 @@ namespace kdGfx
 		}
 		LoadFunctions(_device);
 
+		_pipelineCache = std::make_unique<VKPipelineCache>(*this);
+		_memoryAllocator = std::make_unique<VKMemoryAllocator>(*this);
+
 		for (auto& queueInfo : _queuesInfo)
 		{
-			queueInfo.second.commandQueue = std::make_shared<VKCommandQueue>(*this, queueInfo.second.queueFamilyIndex);
+			queueInfo.second.commandQueue = std::make_shared<VKCommandQueue>(*this, queueInfo.first, queueInfo.second.queueFamilyIndex);
 		}
 	}
 
 	VKDevice::~VKDevice()
 	{
+		waitPipelineCompiles();
+		_bindlessHeap.reset();
+		_pipelineCache.reset();
+		// 队列销毁时回收的命令池一起销毁
+		_queuesInfo.clear();
+		_memoryAllocator.reset();
 		vkDestroyDevice(_device, nullptr);
 	}
 
@@ -166,18 +198,47 @@ namespace kdGfx
 		return _queuesInfo[getAvailableCommandListType(type)].commandQueue;
 	}
 
-	size_t VKDevice::getTextureAllocateSize(const TextureDesc& desc)
+	AllocateInfo VKDevice::getTextureAllocateInfo(const TextureDesc& desc)
 	{
+		const TextureAllocateKey key = { desc.type, desc.usage, desc.format, desc.width, desc.height, desc.depth, desc.mipLevels, desc.arrayLayers, desc.sampleCount };
+		std::lock_guard<std::mutex> lock(_textureAllocateInfosMutex);
+		if (auto it = _textureAllocateInfos.find(key); it != _textureAllocateInfos.end())
+			return it->second;
+
 		VkImageCreateInfo imageCreateInfo = std::move(VKTexture::getCreateInfo(*this, desc));
 		VkImage _image = VK_NULL_HANDLE;
-		vkCreateImage(_device, &imageCreateInfo, nullptr, &_image);
+		if (vkCreateImage(_device, &imageCreateInfo, nullptr, &_image) != VK_SUCCESS)
+		{
+			spdlog::error("failed to create vulkan image for allocate info: {}", desc.name);
+			return {};
+		}
 
 		VkMemoryRequirements memRequirements = {};
 		vkGetImageMemoryRequirements(_device, _image, &memRequirements);
 
 		vkDestroyImage(_device, _image, nullptr);
 
-		return memRequirements.size;
+		AllocateInfo allocateInfo = { memRequirements.size, memRequirements.alignment, memRequirements.memoryTypeBits };
+		_textureAllocateInfos.emplace(key, allocateInfo);
+		return allocateInfo;
+	}
+
+	AllocateInfo VKDevice::getBufferAllocateInfo(const BufferDesc& desc)
+	{
+		VkBufferCreateInfo bufferCreateInfo = VKBuffer::getCreateInfo(desc);
+		VkBuffer buffer = VK_NULL_HANDLE;
+		if (vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+		{
+			spdlog::error("failed to create vulkan buffer for allocate info: {}", desc.name);
+			return {};
+		}
+
+		VkMemoryRequirements memRequirements = {};
+		vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
+
+		vkDestroyBuffer(_device, buffer, nullptr);
+
+		return { memRequirements.size, memRequirements.alignment, memRequirements.memoryTypeBits, true };
 	}
 
 	std::shared_ptr<CommandList> VKDevice::createCommandList(CommandListType type)
@@ -247,6 +308,37 @@ namespace kdGfx
 		return std::make_shared<VKRasterPipeline>(*this, desc);
 	}
 
+	std::shared_ptr<QueryPool> VKDevice::createQueryPool(const QueryPoolDesc& desc)
+	{
+		return std::make_shared<VKQueryPool>(*this, desc);
+	}
+
+	std::shared_ptr<BindlessHeap> VKDevice::getBindlessHeap()
+	{
+		std::call_once(_bindlessHeapOnce, [this]() { _bindlessHeap = std::make_shared<VKBindlessHeap>(*this); });
+		return _bindlessHeap;
+	}
+
+	bool VKDevice::loadPipelineCache(const std::string& filename)
+	{
+		return _pipelineCache->load(filename);
+	}
+
+	bool VKDevice::savePipelineCache(const std::string& filename)
+	{
+		return _pipelineCache->save(filename);
+	}
+
+	PipelineCacheStats VKDevice::getPipelineCacheStats()
+	{
+		return _pipelineCache->getStats();
+	}
+
+	MemoryStats VKDevice::getMemoryStats()
+	{
+		return _memoryAllocator->getStats();
+	}
+
 	uint32_t VKDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 	{
 		VkPhysicalDeviceMemoryProperties memProperties;
@@ -377,8 +469,8 @@ namespace kdGfx
 			{ TextureState::CopyDst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
 			{ TextureState::CopySrc, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
 			{ TextureState::ColorAttachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
-			{ TextureState::DepthStencilRead, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL },
-			{ TextureState::DepthStencilWrite, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL },
+			{ TextureState::DepthStencilRead, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL },
+			{ TextureState::DepthStencilWrite, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL },
 			{ TextureState::ShaderRead, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 			{ TextureState::ResolveDst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
 			{ TextureState::ResolveSrc, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
@@ -449,21 +541,78 @@ namespace kdGfx
 		switch (layout)
 		{
 		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-			return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
-			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+			return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
 		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-			return VK_ACCESS_TRANSFER_READ_BIT;
-		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
 			return VK_ACCESS_TRANSFER_WRITE_BIT;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			return VK_ACCESS_TRANSFER_READ_BIT;
 		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
 			return VK_ACCESS_SHADER_READ_BIT;
 		case VK_IMAGE_LAYOUT_GENERAL:
-			return VK_ACCESS_SHADER_WRITE_BIT;
+			return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		default:
+			return VK_ACCESS_NONE;
+		}
+	}
+
+	VkAccessFlags VKDevice::getAccessFlagsFromBufferState(BufferState state) const
+	{
+		switch (state)
+		{
+		case BufferState::CopyDst:
+			return VK_ACCESS_TRANSFER_WRITE_BIT;
+		case BufferState::CopySrc:
+			return VK_ACCESS_TRANSFER_READ_BIT;
+		case BufferState::VertexIndex:
+			return VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		case BufferState::Indirect:
+			return VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		case BufferState::Constant:
+			return VK_ACCESS_UNIFORM_READ_BIT;
+		case BufferState::ShaderRead:
+			return VK_ACCESS_SHADER_READ_BIT;
+		case BufferState::ShaderWrite:
+			return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 		default:
 			return VK_ACCESS_NONE;
 		}
 	}
+
+	VkPipelineStageFlags VKDevice::toVkPipelineStageFlags(PipelineStage stage, CommandListType type) const
+	{
+		if (HasAnyBits(stage, PipelineStage::AllCommands))
+			return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		static const std::pair<PipelineStage, VkPipelineStageFlags> mapping[] =
+		{
+			{ PipelineStage::DrawIndirect, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT },
+			{ PipelineStage::VertexInput, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT },
+			{ PipelineStage::VertexShader, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT },
+			{ PipelineStage::PixelShader, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT },
+			{ PipelineStage::DepthStencil, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT },
+			{ PipelineStage::ColorAttachment, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT },
+			{ PipelineStage::ComputeShader, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT },
+			{ PipelineStage::Copy, VK_PIPELINE_STAGE_TRANSFER_BIT },
+			{ PipelineStage::Resolve, VK_PIPELINE_STAGE_TRANSFER_BIT }
+		};
+		VkPipelineStageFlags flags = 0;
+		for (const auto& [bit, vkFlags] : mapping)
+		{
+			if (HasAnyBits(stage, bit))
+				flags |= vkFlags;
+		}
+
+		VkPipelineStageFlags supported = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		if (type == CommandListType::General)
+			supported = ~0u;
+		else if (type == CommandListType::Compute)
+			supported |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		if (flags & ~supported)
+			return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		return flags;
+	}
 }
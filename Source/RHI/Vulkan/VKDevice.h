@@ -1,10 +1,15 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <mutex>
+#include <map>
 
 #include "../Device.h"
 #include "VKAdapter.h"
 #include "VKCommandQueue.h"
+#include "VKDescriptorHeap.h"
+#include "VKPipelineCache.h"
+#include "VKMemoryAllocator.h"
 
 namespace kdGfx
 {
@@ -15,7 +20,8 @@ namespace kdGfx
         virtual ~VKDevice();
 
         std::shared_ptr<CommandQueue> getCommandQueue(CommandListType type) override;
-        size_t getTextureAllocateSize(const TextureDesc& desc) override;
+        AllocateInfo getTextureAllocateInfo(const TextureDesc& desc) override;
+        AllocateInfo getBufferAllocateInfo(const BufferDesc& desc) override;
         std::shared_ptr<CommandList> createCommandList(CommandListType type) override;
         std::shared_ptr<Fence> createFence(uint64_t initialValue) override;
         std::shared_ptr<Memory> createMemory(const MemoryDesc& desc) override;
@@ -29,6 +35,12 @@ namespace kdGfx
         std::shared_ptr<BindSet> createBindSet(const std::shared_ptr<BindSetLayout>& layout) override;
         std::shared_ptr<Pipeline> createComputePipeline(const ComputePipelineDesc& desc) override;
         std::shared_ptr<Pipeline> createRasterPipeline(const RasterPipelineDesc& desc) override;
+        std::shared_ptr<QueryPool> createQueryPool(const QueryPoolDesc& desc) override;
+        std::shared_ptr<BindlessHeap> getBindlessHeap() override;
+        bool loadPipelineCache(const std::string& filename) override;
+        bool savePipelineCache(const std::string& filename) override;
+        PipelineCacheStats getPipelineCacheStats() override;
+        MemoryStats getMemoryStats() override;
 
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         uint32_t getMaxDescriptorCount(BindEntryType type);
@@ -40,9 +52,17 @@ namespace kdGfx
         VkShaderStageFlags toVkShaderStageFlags(ShaderType type) const;
         VkImageAspectFlags getAspectFlagsFromFormat(VkFormat format) const;
         VkAccessFlags getAccessFlagsFromImageLayout(VkImageLayout layout) const;
+        VkAccessFlags getAccessFlagsFromBufferState(BufferState state) const;
+        // 队列不支持的阶段替换成ALL_COMMANDS
+        VkPipelineStageFlags toVkPipelineStageFlags(PipelineStage stage, CommandListType type) const;
         
         inline const VKAdapter& getAdapter() const { return _adapter; }
         inline VkDevice getDevice() const { return _device; }
+        // bindless堆可以在绑定后更新没有使用的描述符
+        inline bool isDescriptorUpdateAfterBindSupported() const { return _descriptorUpdateAfterBindSupported; }
+        inline bool isSynchronization2Supported() const { return _synchronization2Supported; }
+        inline VKPipelineCache& getPipelineCache() { return *_pipelineCache; }
+        inline VKMemoryAllocator& getMemoryAllocator() { return *_memoryAllocator; }
         inline uint32_t getQueueFamilyIndex(CommandListType type) const
         {
             if (_queuesInfo.count(type))
@@ -66,5 +86,15 @@ namespace kdGfx
             std::shared_ptr<VKCommandQueue> commandQueue;
         };
         std::unordered_map<CommandListType, QueueInfo> _queuesInfo;
+        bool _descriptorUpdateAfterBindSupported = false;
+        bool _synchronization2Supported = false;
+        std::once_flag _bindlessHeapOnce;
+        std::shared_ptr<VKBindlessHeap> _bindlessHeap;
+        std::unique_ptr<VKPipelineCache> _pipelineCache;
+        std::unique_ptr<VKMemoryAllocator> _memoryAllocator;
+        // 同样描述的贴图内存需求相同，只在第一次查询时创建临时image
+        using TextureAllocateKey = std::tuple<TextureType, TextureUsage, Format, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t>;
+        std::mutex _textureAllocateInfosMutex;
+        std::map<TextureAllocateKey, AllocateInfo> _textureAllocateInfos;
     };
 }
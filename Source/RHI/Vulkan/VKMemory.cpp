@@ -6,6 +6,8 @@ namespace kdGfx
 	VKMemory::VKMemory(VKDevice& device, const MemoryDesc& desc) :
 		_device(device)
 	{
+		_desc = desc;
+
 		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		switch (desc.type)
 		{
@@ -17,23 +19,12 @@ namespace kdGfx
 			break;
 		}
 
-		uint32_t memoryTypeIndex = 0;
-		VkPhysicalDevice physicalDevice = _device.getAdapter().getPhysicalDevice();
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-		{
-			if ((memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-			{
-				memoryTypeIndex |= (1 << i);
-				break;
-			}
-		}
-
+		// 放置的资源还没创建，按调用者给出的资源内存类型选择
+		_memoryTypeIndex = _device.findMemoryType(desc.memoryTypeBits, properties);
 		VkMemoryAllocateInfo allocInfo = {};
 		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		allocInfo.allocationSize = desc.size;
-		allocInfo.memoryTypeIndex = memoryTypeIndex;
+		allocInfo.memoryTypeIndex = _memoryTypeIndex;
 		if (vkAllocateMemory(_device.getDevice(), &allocInfo, nullptr, &_memory) != VK_SUCCESS)
 		{
 			RuntimeError("failed to allocate vulkan memory");
@@ -12,9 +12,11 @@ namespace kdGfx
         virtual ~VKMemory();
 
         inline VkDeviceMemory getMemory() const { return _memory; }
+        inline uint32_t getMemoryTypeIndex() const { return _memoryTypeIndex; }
 
     private:
         VKDevice& _device;
         VkDeviceMemory _memory = VK_NULL_HANDLE;
+        uint32_t _memoryTypeIndex = 0;
     };
 }
@@ -0,0 +1,340 @@
+#include "VKMemoryAllocator.h"
+#include "VKDevice.h"
+#include "VKAPI.h"
+
+namespace kdGfx
+{
+	static uint32_t Log2(VkDeviceSize value)
+	{
+		uint32_t result = 0;
+		while (value >>= 1)
+			result++;
+		return result;
+	}
+
+	static VkDeviceSize NextPowerOfTwo(VkDeviceSize value)
+	{
+		VkDeviceSize result = 1;
+		while (result < value)
+			result <<= 1;
+		return result;
+	}
+
+	VKMemoryAllocator::VKMemoryAllocator(VKDevice& device) :
+		_device(device)
+	{
+		vkGetPhysicalDeviceMemoryProperties(_device.getAdapter().getPhysicalDevice(), &_memoryProperties);
+
+		_pools.resize(_memoryProperties.memoryTypeCount * 2);
+		for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+		{
+			// 小的堆（比如可见显存）用小块，避免一块占掉太多
+			const VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize blockSize = _defaultBlockSize;
+			while (blockSize > (1ull << 20) && blockSize > heapSize / 8)
+				blockSize >>= 1;
+
+			for (uint32_t j = 0; j < 2; j++)
+			{
+				Pool& pool = _pools[i * 2 + j];
+				pool.memoryTypeIndex = i;
+				pool.blockSize = blockSize;
+				pool.maxOrder = Log2(blockSize / _minAllocationSize);
+			}
+		}
+	}
+
+	VKMemoryAllocator::~VKMemoryAllocator()
+	{
+		for (auto& pool : _pools)
+		{
+			for (auto& block : pool.blocks)
+			{
+				if (!block->allocations.empty())
+					spdlog::warn("vulkan memory block destroyed with {} allocations alive", block->allocations.size());
+				_freeMemory(block->memory, block->mappedPtr != nullptr);
+			}
+		}
+		if (_dedicatedCount > 0)
+			spdlog::warn("{} dedicated vulkan allocations leaked", _dedicatedCount);
+	}
+
+	VKAllocation VKMemoryAllocator::allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties)
+	{
+		VkBufferMemoryRequirementsInfo2 requirementsInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2,
+			.buffer = buffer
+		};
+		VkMemoryDedicatedRequirements dedicatedRequirements = { .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+		VkMemoryRequirements2 requirements =
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+			.pNext = &dedicatedRequirements
+		};
+		vkGetBufferMemoryRequirements2(_device.getDevice(), &requirementsInfo, &requirements);
+
+		VkMemoryDedicatedAllocateInfo dedicatedInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+			.buffer = buffer
+		};
+		VKAllocation allocation = _allocate(requirements.memoryRequirements, properties, true,
+			dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation, dedicatedInfo);
+		vkBindBufferMemory(_device.getDevice(), buffer, allocation.memory, allocation.offset);
+		return allocation;
+	}
+
+	VKAllocation VKMemoryAllocator::allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties)
+	{
+		VkImageMemoryRequirementsInfo2 requirementsInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+			.image = image
+		};
+		VkMemoryDedicatedRequirements dedicatedRequirements = { .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+		VkMemoryRequirements2 requirements =
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+			.pNext = &dedicatedRequirements
+		};
+		vkGetImageMemoryRequirements2(_device.getDevice(), &requirementsInfo, &requirements);
+
+		VkMemoryDedicatedAllocateInfo dedicatedInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+			.image = image
+		};
+		VKAllocation allocation = _allocate(requirements.memoryRequirements, properties, false,
+			dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation, dedicatedInfo);
+		vkBindImageMemory(_device.getDevice(), image, allocation.memory, allocation.offset);
+		return allocation;
+	}
+
+	void VKMemoryAllocator::free(VKAllocation& allocation)
+	{
+		if (!allocation.memory)
+			return;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!allocation.block)
+		{
+			_freeMemory(allocation.memory, allocation.mappedPtr != nullptr);
+			_dedicatedCount--;
+			_dedicatedSize -= allocation.size;
+		}
+		else
+		{
+			Pool& pool = _pools[allocation.poolIndex];
+			Block* block = static_cast<Block*>(allocation.block);
+			_freeNode(*block, allocation.offset, pool.maxOrder);
+
+			// 每个池最多保留一个空块，避免反复向驱动申请
+			if (block->allocations.empty())
+			{
+				const bool hasOtherEmpty = std::any_of(pool.blocks.begin(), pool.blocks.end(), [block](const std::unique_ptr<Block>& other)
+					{
+						return other.get() != block && other->allocations.empty();
+					});
+				if (hasOtherEmpty)
+				{
+					_freeMemory(block->memory, block->mappedPtr != nullptr);
+					std::erase_if(pool.blocks, [block](const std::unique_ptr<Block>& other) { return other.get() == block; });
+				}
+			}
+		}
+		allocation = {};
+	}
+
+	MemoryStats VKMemoryAllocator::getStats()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		MemoryStats stats =
+		{
+			.dedicatedCount = _dedicatedCount,
+			.allocationCount = _dedicatedCount,
+			.reservedSize = _dedicatedSize,
+			.usedSize = _dedicatedSize
+		};
+		uint64_t freeSize = 0;
+		for (const auto& pool : _pools)
+		{
+			for (const auto& block : pool.blocks)
+			{
+				stats.blockCount++;
+				stats.allocationCount += (uint32_t)block->allocations.size();
+				stats.reservedSize += pool.blockSize;
+				stats.usedSize += block->usedSize;
+				freeSize += pool.blockSize - block->usedSize;
+				for (uint32_t order = pool.maxOrder + 1; order-- > 0;)
+				{
+					if (!block->freeLists[order].empty())
+					{
+						stats.largestFreeSize = std::max<uint64_t>(stats.largestFreeSize, _minAllocationSize << order);
+						break;
+					}
+				}
+			}
+		}
+		if (freeSize > 0)
+			stats.fragmentation = 1.0f - (float)((double)stats.largestFreeSize / (double)freeSize);
+		return stats;
+	}
+
+	VKAllocation VKMemoryAllocator::_allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+		bool linear, bool dedicated, const VkMemoryDedicatedAllocateInfo& dedicatedInfo)
+	{
+		const uint32_t memoryTypeIndex = _findMemoryType(requirements.memoryTypeBits, properties);
+		const uint32_t poolIndex = memoryTypeIndex * 2 + (linear ? 0 : 1);
+		Pool& pool = _pools[poolIndex];
+
+		// 伙伴节点按自身大小对齐，节点不小于对齐要求即可
+		const VkDeviceSize nodeSize = NextPowerOfTwo(std::max({ requirements.size, requirements.alignment, _minAllocationSize }));
+		const uint32_t order = Log2(nodeSize / _minAllocationSize);
+		dedicated = dedicated || order >= pool.maxOrder;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!dedicated)
+		{
+			VKAllocation allocation = { .size = requirements.size, .poolIndex = poolIndex };
+			Block* target = nullptr;
+			for (auto& block : pool.blocks)
+			{
+				if (_allocateNode(*block, order, pool.maxOrder, allocation.offset))
+				{
+					target = block.get();
+					break;
+				}
+			}
+			if (!target)
+			{
+				void* mappedPtr = nullptr;
+				VkDeviceMemory memory = _allocateMemory(memoryTypeIndex, pool.blockSize, nullptr, &mappedPtr);
+				if (memory)
+				{
+					auto& block = pool.blocks.emplace_back(std::make_unique<Block>());
+					block->memory = memory;
+					block->mappedPtr = mappedPtr;
+					block->freeLists.resize(pool.maxOrder + 1);
+					block->freeLists[pool.maxOrder].insert(0);
+					_allocateNode(*block, order, pool.maxOrder, allocation.offset);
+					target = block.get();
+				}
+			}
+			// 新块申请失败时退回到按资源大小单独分配
+			if (target)
+			{
+				allocation.memory = target->memory;
+				allocation.block = target;
+				if (target->mappedPtr)
+					allocation.mappedPtr = static_cast<uint8_t*>(target->mappedPtr) + allocation.offset;
+				return allocation;
+			}
+		}
+
+		VKAllocation allocation = { .size = requirements.size, .poolIndex = poolIndex };
+		allocation.memory = _allocateMemory(memoryTypeIndex, requirements.size, &dedicatedInfo, &allocation.mappedPtr);
+		if (!allocation.memory)
+		{
+			RuntimeError("failed to allocate vulkan memory");
+		}
+		_dedicatedCount++;
+		_dedicatedSize += requirements.size;
+		return allocation;
+	}
+
+	uint32_t VKMemoryAllocator::_findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				return i;
+			}
+		}
+		// 没有带缓存的host可见内存时退回到不带缓存的
+		if (properties & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+		{
+			return _findMemoryType(typeFilter, properties & ~VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+		}
+
+		spdlog::error("failed to find vulkan memory type");
+		return 0;
+	}
+
+	VkDeviceMemory VKMemoryAllocator::_allocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, const void* pNext, void** mappedPtr)
+	{
+		VkMemoryAllocateInfo allocInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.pNext = pNext,
+			.allocationSize = size,
+			.memoryTypeIndex = memoryTypeIndex
+		};
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		if (vkAllocateMemory(_device.getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS)
+		{
+			return VK_NULL_HANDLE;
+		}
+
+		*mappedPtr = nullptr;
+		if (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			vkMapMemory(_device.getDevice(), memory, 0, VK_WHOLE_SIZE, 0, mappedPtr);
+		}
+		return memory;
+	}
+
+	void VKMemoryAllocator::_freeMemory(VkDeviceMemory memory, bool mapped)
+	{
+		if (mapped)
+			vkUnmapMemory(_device.getDevice(), memory);
+		vkFreeMemory(_device.getDevice(), memory, nullptr);
+	}
+
+	bool VKMemoryAllocator::_allocateNode(Block& block, uint32_t order, uint32_t maxOrder, VkDeviceSize& offset)
+	{
+		uint32_t current = order;
+		while (current <= maxOrder && block.freeLists[current].empty())
+			current++;
+		if (current > maxOrder)
+			return false;
+
+		// 取地址最低的节点，逐级拆分，多出的一半放回空闲列表
+		auto it = block.freeLists[current].begin();
+		offset = *it;
+		block.freeLists[current].erase(it);
+		while (current > order)
+		{
+			current--;
+			block.freeLists[current].insert(offset + (_minAllocationSize << current));
+		}
+		block.allocations[offset] = order;
+		block.usedSize += _minAllocationSize << order;
+		return true;
+	}
+
+	void VKMemoryAllocator::_freeNode(Block& block, VkDeviceSize offset, uint32_t maxOrder)
+	{
+		auto it = block.allocations.find(offset);
+		if (it == block.allocations.end())
+		{
+			spdlog::error("invalid vulkan memory allocation offset: {}", offset);
+			return;
+		}
+		uint32_t order = it->second;
+		block.allocations.erase(it);
+		block.usedSize -= _minAllocationSize << order;
+
+		// 伙伴也空闲时合并成上一级
+		while (order < maxOrder)
+		{
+			const VkDeviceSize buddy = offset ^ (_minAllocationSize << order);
+			if (!block.freeLists[order].erase(buddy))
+				break;
+			offset = std::min(offset, buddy);
+			order++;
+		}
+		block.freeLists[order].insert(offset);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <mutex>
+#include <set>
+
+#include "../BaseTypes.h"
+
+namespace kdGfx
+{
+    class VKDevice;
+
+    struct VKAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // host可见的内存整块持久映射，已经加上offset
+        void* mappedPtr = nullptr;
+        // 独占分配时为空
+        void* block = nullptr;
+        uint32_t poolIndex = 0;
+    };
+
+    // 按内存类型分堆的块分配器，每块内部用伙伴算法分配，大小按2的幂分级
+    // buffer和贴图放在不同的块里，不会在bufferImageGranularity内相邻。超过半块或驱动要求独占的资源单独分配
+    class VKMemoryAllocator
+    {
+    public:
+        VKMemoryAllocator(VKDevice& device);
+        ~VKMemoryAllocator();
+
+        // 查询内存需求、分配并绑定，失败时抛出异常
+        VKAllocation allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties);
+        VKAllocation allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties);
+        void free(VKAllocation& allocation);
+
+        MemoryStats getStats();
+
+    private:
+        struct Block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            void* mappedPtr = nullptr;
+            // 每级的空闲节点偏移，0级是最小分配
+            std::vector<std::set<VkDeviceSize>> freeLists;
+            // 已分配节点的偏移和级别
+            std::unordered_map<VkDeviceSize, uint32_t> allocations;
+            VkDeviceSize usedSize = 0;
+        };
+        // 每种内存类型线性和非线性资源各一个
+        struct Pool
+        {
+            uint32_t memoryTypeIndex = 0;
+            VkDeviceSize blockSize = 0;
+            uint32_t maxOrder = 0;
+            std::vector<std::unique_ptr<Block>> blocks;
+        };
+
+        VKAllocation _allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+            bool linear, bool dedicated, const VkMemoryDedicatedAllocateInfo& dedicatedInfo);
+        uint32_t _findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        VkDeviceMemory _allocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, const void* pNext, void** mappedPtr);
+        void _freeMemory(VkDeviceMemory memory, bool mapped);
+        static bool _allocateNode(Block& block, uint32_t order, uint32_t maxOrder, VkDeviceSize& offset);
+        static void _freeNode(Block& block, VkDeviceSize offset, uint32_t maxOrder);
+
+        VKDevice& _device;
+        VkPhysicalDeviceMemoryProperties _memoryProperties = {};
+        std::vector<Pool> _pools;
+        std::mutex _mutex;
+        uint32_t _dedicatedCount = 0;
+        VkDeviceSize _dedicatedSize = 0;
+
+        static constexpr VkDeviceSize _minAllocationSize = 256;
+        static constexpr VkDeviceSize _defaultBlockSize = 64ull << 20;
+    };
+}
@@ -1,6 +1,7 @@
 #include "VKPipeline.h"
 #include "VKDevice.h"
 #include "VKBindSetLayout.h"
+#include "VKPipelineCache.h"
 
 namespace kdGfx
 {
@@ -57,8 +58,8 @@ namespace kdGfx
 
 	VKPipeline::~VKPipeline()
 	{
+		// 管线布局归管线缓存所有
 		if(_pipeline)	vkDestroyPipeline(_device.getDevice(), _pipeline, nullptr);
-		if (_pipelineLayout)	vkDestroyPipelineLayout(_device.getDevice(), _pipelineLayout, nullptr);
 	}
 
 	VKComputePipeline::VKComputePipeline(VKDevice& device, const ComputePipelineDesc& desc) :
@@ -71,17 +72,10 @@ namespace kdGfx
 			return;
 		}
 
-		VkDevice vkDevice = _device.getDevice();
+		VKPipelineCache& pipelineCache = _device.getPipelineCache();
 
-		VkShaderModule shaderModule = VK_NULL_HANDLE;
-		VkShaderModuleCreateInfo shaderCreateInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-			.codeSize = desc.shader.codeSize,
-			.pCode = reinterpret_cast<const uint32_t*>(desc.shader.code)
-		};
-		VkResult vkResult = vkCreateShaderModule(vkDevice, &shaderCreateInfo, nullptr, &shaderModule);
-		if (vkResult != VK_SUCCESS)
+		VkShaderModule shaderModule = pipelineCache.getShaderModule(desc.shader);
+		if (!shaderModule)
 		{
 			spdlog::error("failed to create compute shader");
 			return;
@@ -94,28 +88,9 @@ namespace kdGfx
 			.pName = "main"
 		};
 
-		std::vector<VkDescriptorSetLayout> descSetLayouts(desc.bindSetLayouts.size());
-		for (uint32_t i = 0; i < descSetLayouts.size(); ++i)
-		{
-			auto vkBindSetLayout = std::dynamic_pointer_cast<VKBindSetLayout>(desc.bindSetLayouts[i]);
-			descSetLayouts[i] = vkBindSetLayout->getDescriptorSetLayout();
-		}
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo = 
-		{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-			.setLayoutCount = (uint32_t)descSetLayouts.size(),
-			.pSetLayouts = descSetLayouts.data()
-		};
-		VkPushConstantRange pushConstantRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, desc.pushConstantLayout.size };
-		if (desc.pushConstantLayout.size > 0)
-		{
-			pipelineLayoutInfo.pushConstantRangeCount = 1;
-			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-		}
-		vkResult = vkCreatePipelineLayout(vkDevice, &pipelineLayoutInfo, nullptr, &_pipelineLayout);
-		if (vkResult != VK_SUCCESS)
+		_pipelineLayout = pipelineCache.getPipelineLayout(desc.bindSetLayouts, VK_SHADER_STAGE_COMPUTE_BIT, desc.pushConstantLayout.size);
+		if (!_pipelineLayout)
 		{
-			vkDestroyShaderModule(vkDevice, shaderModule, nullptr);
 			spdlog::error("failed to create pipelineLayout");
 			return;
 		}
@@ -126,15 +101,13 @@ namespace kdGfx
 			.stage = shaderStageCreateInfo,
 			.layout = _pipelineLayout
 		};
-		vkResult = vkCreateComputePipelines(vkDevice, nullptr, 1, &pipelineCreateInfo, nullptr, &_pipeline);
+		VkResult vkResult = pipelineCache.createPipeline(pipelineCreateInfo, _pipeline);
 		if (vkResult != VK_SUCCESS)
 		{
-			vkDestroyShaderModule(vkDevice, shaderModule, nullptr);
-			vkDestroyPipelineLayout(vkDevice, _pipelineLayout, nullptr);
+			_pipeline = VK_NULL_HANDLE;
 			spdlog::error("failed to create pipeline");
 			return;
 		}
-		vkDestroyShaderModule(vkDevice, shaderModule, nullptr);
 	}
 
 	VKRasterPipeline::VKRasterPipeline(VKDevice& device, const RasterPipelineDesc& desc) :
@@ -147,18 +120,11 @@ namespace kdGfx
 			return;
 		}
 
-		VkDevice vkDevice = _device.getDevice();
+		VKPipelineCache& pipelineCache = _device.getPipelineCache();
 
 		// 顶点着色器
-		VkShaderModule vertShaderModule = VK_NULL_HANDLE;
-		VkShaderModuleCreateInfo vertShaderCreateInfo = 
-		{
-			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-			.codeSize = desc.vertex.codeSize,
-			.pCode = reinterpret_cast<const uint32_t*>(desc.vertex.code)
-		};
-		VkResult vkResult = vkCreateShaderModule(vkDevice, &vertShaderCreateInfo, nullptr, &vertShaderModule);
-		if (vkResult != VK_SUCCESS)
+		VkShaderModule vertShaderModule = pipelineCache.getShaderModule(desc.vertex);
+		if (!vertShaderModule)
 		{
 			spdlog::error("failed to create vertex shader");
 			return;
@@ -171,17 +137,9 @@ namespace kdGfx
 			.pName = "main"
 		};
 		// 片段着色器
-		VkShaderModule fragShaderModule = VK_NULL_HANDLE;
-		VkShaderModuleCreateInfo fragShaderCreateInfo = 
-		{
-			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-			.codeSize = desc.pixel.codeSize,
-			.pCode = reinterpret_cast<const uint32_t*>(desc.pixel.code)
-		};
-		vkResult = vkCreateShaderModule(vkDevice, &fragShaderCreateInfo, nullptr, &fragShaderModule);
-		if (vkResult != VK_SUCCESS)
+		VkShaderModule fragShaderModule = pipelineCache.getShaderModule(desc.pixel);
+		if (!fragShaderModule)
 		{
-			vkDestroyShaderModule(vkDevice, vertShaderModule, nullptr);
 			spdlog::error("failed to create fragment shader");
 			return;
 		}
@@ -434,29 +392,9 @@ namespace kdGfx
 		};
 		
 		// 管线资源访问布局
-		std::vector<VkDescriptorSetLayout> descSetLayouts(desc.bindSetLayouts.size());
-		for (uint32_t i = 0; i < descSetLayouts.size(); ++i)
-		{
-			auto vkBindSetLayout = std::dynamic_pointer_cast<VKBindSetLayout>(desc.bindSetLayouts[i]);
-			descSetLayouts[i] = vkBindSetLayout->getDescriptorSetLayout();
-		}
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo =
+		_pipelineLayout = pipelineCache.getPipelineLayout(desc.bindSetLayouts, VK_SHADER_STAGE_ALL_GRAPHICS, desc.pushConstantLayout.size);
+		if (!_pipelineLayout)
 		{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-			.setLayoutCount = (uint32_t)descSetLayouts.size(),
-			.pSetLayouts = descSetLayouts.data()
-		};
-		VkPushConstantRange pushConstantRange = { VK_SHADER_STAGE_ALL_GRAPHICS, 0, desc.pushConstantLayout.size };
-		if (desc.pushConstantLayout.size > 0)
-		{
-			pipelineLayoutInfo.pushConstantRangeCount = 1;
-			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-		}
-		vkResult = vkCreatePipelineLayout(vkDevice, &pipelineLayoutInfo, nullptr, &_pipelineLayout);
-		if (vkResult != VK_SUCCESS)
-		{
-			vkDestroyShaderModule(vkDevice, vertShaderModule, nullptr);
-			vkDestroyShaderModule(vkDevice, fragShaderModule, nullptr);
 			spdlog::error("failed to create pipelineLayout");
 			return;
 		}
@@ -493,18 +431,12 @@ namespace kdGfx
 		pipelineInfo.pColorBlendState = &colorBlendState;
 		pipelineInfo.pDynamicState = &dynamicState;
 		pipelineInfo.layout = _pipelineLayout;
-		vkResult = vkCreateGraphicsPipelines(vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_pipeline);
+		VkResult vkResult = pipelineCache.createPipeline(pipelineInfo, _pipeline);
 		if (vkResult != VK_SUCCESS)
 		{
-			vkDestroyShaderModule(vkDevice, vertShaderModule, nullptr);
-			vkDestroyShaderModule(vkDevice, fragShaderModule, nullptr);
-			vkDestroyPipelineLayout(vkDevice, _pipelineLayout, nullptr);
+			_pipeline = VK_NULL_HANDLE;
 			spdlog::error("failed to create pipeline");
 			return;
 		}
-
-		// 构建完毕管线shader可以删除
-		vkDestroyShaderModule(vkDevice, vertShaderModule, nullptr);
-		vkDestroyShaderModule(vkDevice, fragShaderModule, nullptr);
 	}
 }
@@ -0,0 +1,285 @@
+#include "VKPipelineCache.h"
+#include "VKDevice.h"
+#include "VKBindSetLayout.h"
+#include "Misc.h"
+#include <chrono>
+
+namespace kdGfx
+{
+	// 文件格式变化时递增
+	static constexpr uint32_t pipelineCacheMagic = 0x4B445043;
+	static constexpr uint32_t pipelineCacheVersion = 1;
+
+	// 驱动数据前的文件头，损坏的数据交给驱动可能导致崩溃
+	struct PipelineCacheFileHeader
+	{
+		uint32_t magic = pipelineCacheMagic;
+		uint32_t version = pipelineCacheVersion;
+		uint64_t dataSize = 0;
+		uint64_t dataHash = 0;
+	};
+
+	inline static uint64_t HashData(const char* data, size_t size)
+	{
+		return std::hash<std::string_view>{}(std::string_view(data, size));
+	}
+
+	VKPipelineCache::VKPipelineCache(VKDevice& device) :
+		_device(device)
+	{
+		VkPipelineCacheCreateInfo createInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+		if (vkCreatePipelineCache(_device.getDevice(), &createInfo, nullptr, &_pipelineCache) != VK_SUCCESS)
+			spdlog::error("failed to create pipeline cache");
+	}
+
+	VKPipelineCache::~VKPipelineCache()
+	{
+		VkDevice vkDevice = _device.getDevice();
+		for (auto& [key, entries] : _shaderModules)
+		{
+			for (auto& entry : entries)
+				vkDestroyShaderModule(vkDevice, entry.shaderModule, nullptr);
+		}
+		for (auto& [key, entries] : _pipelineLayouts)
+		{
+			for (auto& entry : entries)
+				vkDestroyPipelineLayout(vkDevice, entry.pipelineLayout, nullptr);
+		}
+		if (_pipelineCache)	vkDestroyPipelineCache(vkDevice, _pipelineCache, nullptr);
+	}
+
+	bool VKPipelineCache::load(const std::string& filename)
+	{
+		std::vector<char> data;
+		if (!LoadBinaryFile(filename, data)) return false;
+
+		PipelineCacheFileHeader fileHeader;
+		if (data.size() < sizeof(fileHeader))
+		{
+			spdlog::warn("vulkan pipeline cache {} is invalid", filename);
+			return false;
+		}
+		memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+		const char* cacheData = data.data() + sizeof(fileHeader);
+		const size_t cacheSize = data.size() - sizeof(fileHeader);
+		if (fileHeader.magic != pipelineCacheMagic || fileHeader.version != pipelineCacheVersion ||
+			fileHeader.dataSize != cacheSize || fileHeader.dataHash != HashData(cacheData, cacheSize))
+		{
+			spdlog::warn("vulkan pipeline cache {} is invalid", filename);
+			return false;
+		}
+
+		// 驱动升级或者换显卡后缓存失效
+		VkPipelineCacheHeaderVersionOne cacheHeader = {};
+		if (cacheSize < sizeof(cacheHeader))
+		{
+			spdlog::warn("vulkan pipeline cache {} is invalid", filename);
+			return false;
+		}
+		memcpy(&cacheHeader, cacheData, sizeof(cacheHeader));
+		const VkPhysicalDeviceProperties& properties = _device.getAdapter().getProperties();
+		if (cacheHeader.headerSize < sizeof(cacheHeader) || cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+			cacheHeader.vendorID != properties.vendorID || cacheHeader.deviceID != properties.deviceID ||
+			memcmp(cacheHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			spdlog::info("vulkan pipeline cache {} was saved on other device or driver", filename);
+			return false;
+		}
+
+		VkPipelineCacheCreateInfo createInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+			.initialDataSize = cacheSize,
+			.pInitialData = cacheData
+		};
+		VkPipelineCache loadedCache = VK_NULL_HANDLE;
+		if (vkCreatePipelineCache(_device.getDevice(), &createInfo, nullptr, &loadedCache) != VK_SUCCESS)
+		{
+			spdlog::warn("failed to create pipeline cache from {}", filename);
+			return false;
+		}
+		VkResult vkResult = vkMergePipelineCaches(_device.getDevice(), _pipelineCache, 1, &loadedCache);
+		vkDestroyPipelineCache(_device.getDevice(), loadedCache, nullptr);
+		if (vkResult != VK_SUCCESS)
+		{
+			spdlog::warn("failed to merge pipeline cache {}", filename);
+			return false;
+		}
+		spdlog::info("vulkan pipeline cache {} loaded, size {}", filename, cacheSize);
+		return true;
+	}
+
+	bool VKPipelineCache::save(const std::string& filename)
+	{
+		size_t cacheSize = 0;
+		if (vkGetPipelineCacheData(_device.getDevice(), _pipelineCache, &cacheSize, nullptr) != VK_SUCCESS)
+			return false;
+		std::vector<char> data(sizeof(PipelineCacheFileHeader) + cacheSize);
+		char* cacheData = data.data() + sizeof(PipelineCacheFileHeader);
+		// 两次调用之间可能有新管线，大小以第二次为准
+		if (vkGetPipelineCacheData(_device.getDevice(), _pipelineCache, &cacheSize, cacheData) != VK_SUCCESS)
+			return false;
+		data.resize(sizeof(PipelineCacheFileHeader) + cacheSize);
+
+		PipelineCacheFileHeader fileHeader =
+		{
+			.dataSize = cacheSize,
+			.dataHash = HashData(cacheData, cacheSize)
+		};
+		memcpy(data.data(), &fileHeader, sizeof(fileHeader));
+
+		std::ofstream ofile(filename, std::ios::binary);
+		if (!ofile.is_open())
+		{
+			spdlog::error("vulkan pipeline cache {} can not be written", filename);
+			return false;
+		}
+		ofile.write(data.data(), data.size());
+		return true;
+	}
+
+	VkShaderModule VKPipelineCache::getShaderModule(const Shader& shader)
+	{
+		const char* code = static_cast<const char*>(shader.code);
+		const auto key = std::make_tuple(HashData(code, shader.codeSize), shader.codeSize);
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.shaderModules++;
+		auto& entries = _shaderModules[key];
+		for (const auto& entry : entries)
+		{
+			if (memcmp(entry.code.data(), code, shader.codeSize) == 0)
+			{
+				_stats.shaderModuleHits++;
+				return entry.shaderModule;
+			}
+		}
+
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		VkShaderModuleCreateInfo shaderCreateInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+			.codeSize = shader.codeSize,
+			.pCode = reinterpret_cast<const uint32_t*>(shader.code)
+		};
+		if (vkCreateShaderModule(_device.getDevice(), &shaderCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
+			return VK_NULL_HANDLE;
+		entries.push_back({ std::vector<char>(code, code + shader.codeSize), shaderModule });
+		return shaderModule;
+	}
+
+	VkPipelineLayout VKPipelineCache::getPipelineLayout(const std::vector<std::shared_ptr<BindSetLayout>>& bindSetLayouts,
+		VkShaderStageFlags pushConstantStages, uint32_t pushConstantSize)
+	{
+		// 内容相同的绑定组布局兼容，按内容复用，布局销毁后仍然有效
+		std::vector<size_t> layoutHashes(bindSetLayouts.size());
+		std::vector<const VKBindSetLayout*> vkBindSetLayouts(bindSetLayouts.size());
+		std::vector<VkDescriptorSetLayout> descSetLayouts(bindSetLayouts.size());
+		for (uint32_t i = 0; i < descSetLayouts.size(); ++i)
+		{
+			vkBindSetLayouts[i] = std::dynamic_pointer_cast<VKBindSetLayout>(bindSetLayouts[i]).get();
+			layoutHashes[i] = vkBindSetLayouts[i]->getHash();
+			descSetLayouts[i] = vkBindSetLayouts[i]->getDescriptorSetLayout();
+		}
+		auto key = std::make_tuple(std::move(layoutHashes), pushConstantSize > 0 ? pushConstantStages : 0, pushConstantSize);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.pipelineLayouts++;
+		auto& entries = _pipelineLayouts[key];
+		for (const auto& entry : entries)
+		{
+			bool match = true;
+			for (uint32_t i = 0; i < vkBindSetLayouts.size() && match; ++i)
+			{
+				match = entry.setLayoutContents[i] == vkBindSetLayouts[i]->getContent();
+			}
+			if (match)
+			{
+				_stats.pipelineLayoutHits++;
+				return entry.pipelineLayout;
+			}
+		}
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = (uint32_t)descSetLayouts.size(),
+			.pSetLayouts = descSetLayouts.data()
+		};
+		VkPushConstantRange pushConstantRange = { pushConstantStages, 0, pushConstantSize };
+		if (pushConstantSize > 0)
+		{
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		}
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		if (vkCreatePipelineLayout(_device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+			return VK_NULL_HANDLE;
+		PipelineLayoutEntry& entry = entries.emplace_back();
+		for (const VKBindSetLayout* vkBindSetLayout : vkBindSetLayouts)
+		{
+			entry.setLayoutContents.push_back(vkBindSetLayout->getContent());
+		}
+		entry.pipelineLayout = pipelineLayout;
+		return pipelineLayout;
+	}
+
+	VkResult VKPipelineCache::createPipeline(VkComputePipelineCreateInfo& createInfo, VkPipeline& pipeline)
+	{
+		VkPipelineCreationFeedback feedback = {};
+		VkPipelineCreationFeedback stageFeedback = {};
+		VkPipelineCreationFeedbackCreateInfo feedbackInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+			.pNext = createInfo.pNext,
+			.pPipelineCreationFeedback = &feedback,
+			.pipelineStageCreationFeedbackCount = 1,
+			.pPipelineStageCreationFeedbacks = &stageFeedback
+		};
+		createInfo.pNext = &feedbackInfo;
+
+		auto startTime = std::chrono::steady_clock::now();
+		VkResult vkResult = vkCreateComputePipelines(_device.getDevice(), _pipelineCache, 1, &createInfo, nullptr, &pipeline);
+		auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+		createInfo.pNext = feedbackInfo.pNext;
+		if (vkResult == VK_SUCCESS)	_addFeedback(feedback, duration);
+		return vkResult;
+	}
+
+	VkResult VKPipelineCache::createPipeline(VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& pipeline)
+	{
+		VkPipelineCreationFeedback feedback = {};
+		std::vector<VkPipelineCreationFeedback> stageFeedbacks(createInfo.stageCount);
+		VkPipelineCreationFeedbackCreateInfo feedbackInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+			.pNext = createInfo.pNext,
+			.pPipelineCreationFeedback = &feedback,
+			.pipelineStageCreationFeedbackCount = createInfo.stageCount,
+			.pPipelineStageCreationFeedbacks = stageFeedbacks.data()
+		};
+		createInfo.pNext = &feedbackInfo;
+
+		auto startTime = std::chrono::steady_clock::now();
+		VkResult vkResult = vkCreateGraphicsPipelines(_device.getDevice(), _pipelineCache, 1, &createInfo, nullptr, &pipeline);
+		auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+		createInfo.pNext = feedbackInfo.pNext;
+		if (vkResult == VK_SUCCESS)	_addFeedback(feedback, duration);
+		return vkResult;
+	}
+
+	PipelineCacheStats VKPipelineCache::getStats()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _stats;
+	}
+
+	void VKPipelineCache::_addFeedback(const VkPipelineCreationFeedback& feedback, uint64_t duration)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stats.pipelines++;
+		// 驱动不支持反馈时只统计耗时
+		if (HasAllBits(feedback.flags, VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT | VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT))
+			_stats.pipelineHits++;
+		_stats.pipelineCreationTime += duration;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <map>
+#include <mutex>
+
+#include "../BaseTypes.h"
+
+namespace kdGfx
+{
+    class VKDevice;
+
+    // 设备共用的管线缓存。驱动的VkPipelineCache可以保存到文件，shader模块和管线布局按内容复用
+    // 复用的shader模块和管线布局归缓存所有，设备销毁时一起销毁
+    class VKPipelineCache
+    {
+    public:
+        VKPipelineCache(VKDevice& device);
+        ~VKPipelineCache();
+
+        // 合并文件里的缓存，需要在创建管线之前调用。文件头和设备不匹配时忽略
+        bool load(const std::string& filename);
+        bool save(const std::string& filename);
+
+        VkShaderModule getShaderModule(const Shader& shader);
+        VkPipelineLayout getPipelineLayout(const std::vector<std::shared_ptr<BindSetLayout>>& bindSetLayouts,
+            VkShaderStageFlags pushConstantStages, uint32_t pushConstantSize);
+        // 使用驱动缓存创建管线，并统计命中和耗时
+        VkResult createPipeline(VkComputePipelineCreateInfo& createInfo, VkPipeline& pipeline);
+        VkResult createPipeline(VkGraphicsPipelineCreateInfo& createInfo, VkPipeline& pipeline);
+
+        PipelineCacheStats getStats();
+
+    private:
+        void _addFeedback(const VkPipelineCreationFeedback& feedback, uint64_t duration);
+
+        VKDevice& _device;
+        VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+        std::mutex _mutex;
+        struct ShaderModuleEntry
+        {
+            // 哈希相同时比较代码内容
+            std::vector<char> code;
+            VkShaderModule shaderModule = VK_NULL_HANDLE;
+        };
+        // key是代码的哈希和大小
+        std::map<std::tuple<size_t, size_t>, std::vector<ShaderModuleEntry>> _shaderModules;
+        struct PipelineLayoutEntry
+        {
+            // 哈希相同时比较每个绑定组布局的内容
+            std::vector<std::vector<uint32_t>> setLayoutContents;
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        };
+        // key是每个绑定组布局的内容哈希和push constant
+        std::map<std::tuple<std::vector<size_t>, VkShaderStageFlags, uint32_t>, std::vector<PipelineLayoutEntry>> _pipelineLayouts;
+        PipelineCacheStats _stats;
+    };
+}
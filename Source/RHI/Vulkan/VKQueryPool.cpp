@@ -0,0 +1,71 @@
+#include "VKQueryPool.h"
+#include "VKAPI.h"
+#include "VKDevice.h"
+
+namespace kdGfx
+{
+	// 结果按位从低到高排列，和PipelineStatistics字段顺序一致
+	static const VkQueryPipelineStatisticFlags statisticFlags =
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+	VKQueryPool::VKQueryPool(VKDevice& device, const QueryPoolDesc& desc) :
+		_device(device)
+	{
+		_desc = desc;
+
+		const bool isStatistics = _desc.type == QueryType::PipelineStatistics;
+		VkQueryPoolCreateInfo createInfo =
+		{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = isStatistics ? VK_QUERY_TYPE_PIPELINE_STATISTICS : VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = _desc.count,
+			.pipelineStatistics = isStatistics ? statisticFlags : 0
+		};
+		if (vkCreateQueryPool(_device.getDevice(), &createInfo, nullptr, &_queryPool) != VK_SUCCESS)
+		{
+			spdlog::error("failed to create vulkan query pool: {}", _desc.name);
+			return;
+		}
+
+		if (!_desc.name.empty())
+		{
+			VkDebugUtilsObjectNameInfoEXT debugNameInfo =
+			{
+				.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+				.objectType = VK_OBJECT_TYPE_QUERY_POOL,
+				.objectHandle = (uint64_t)_queryPool,
+				.pObjectName = _desc.name.c_str()
+			};
+			vkSetDebugUtilsObjectNameKD(_device.getDevice(), &debugNameInfo);
+		}
+	}
+
+	VKQueryPool::~VKQueryPool()
+	{
+		vkDestroyQueryPool(_device.getDevice(), _queryPool, nullptr);
+	}
+
+	bool VKQueryPool::getResults(uint32_t first, uint32_t count, uint64_t* timestamps)
+	{
+		if (_desc.type != QueryType::Timestamp || !_queryPool) return false;
+
+		VkResult result = vkGetQueryPoolResults(_device.getDevice(), _queryPool, first, count,
+			count * sizeof(uint64_t), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		return result == VK_SUCCESS;
+	}
+
+	bool VKQueryPool::getResults(uint32_t first, uint32_t count, PipelineStatistics* statistics)
+	{
+		if (_desc.type != QueryType::PipelineStatistics || !_queryPool) return false;
+
+		VkResult result = vkGetQueryPoolResults(_device.getDevice(), _queryPool, first, count,
+			count * sizeof(PipelineStatistics), statistics, sizeof(PipelineStatistics), VK_QUERY_RESULT_64_BIT);
+		return result == VK_SUCCESS;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "../QueryPool.h"
+
+namespace kdGfx
+{
+    class VKDevice;
+
+    class VKQueryPool : public QueryPool
+    {
+    public:
+        VKQueryPool(VKDevice& device, const QueryPoolDesc& desc);
+        virtual ~VKQueryPool();
+
+        bool getResults(uint32_t first, uint32_t count, uint64_t* timestamps) override;
+        bool getResults(uint32_t first, uint32_t count, PipelineStatistics* statistics) override;
+
+        inline VkQueryPool getQueryPool() const { return _queryPool; }
+
+    private:
+        VKDevice& _device;
+        VkQueryPool _queryPool = VK_NULL_HANDLE;
+    };
+}
@@ -16,19 +16,7 @@ namespace kdGfx
 			spdlog::error("failed to create vulkan image: {}", desc.name);
 		}
 
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(device.getDevice(), _image, &memRequirements);
-		VkMemoryAllocateInfo allocInfo =
-		{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = memRequirements.size,
-			.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
-		};
-		if (vkAllocateMemory(device.getDevice(), &allocInfo, nullptr, &_imageMemory) != VK_SUCCESS)
-		{
-			RuntimeError("failed to allocate vulkan image memory");
-		}
-		vkBindImageMemory(device.getDevice(), _image, _imageMemory, 0);
+		_allocation = device.getMemoryAllocator().allocateImageMemory(_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 		if (!_desc.name.empty())
 		{
@@ -55,6 +43,12 @@ namespace kdGfx
 			spdlog::error("failed to create vulkan image: {}", _desc.name);
 		}
 
+		VkMemoryRequirements memRequirements = {};
+		vkGetImageMemoryRequirements(device.getDevice(), _image, &memRequirements);
+		if (!(memRequirements.memoryTypeBits & (1u << memory->getMemoryTypeIndex())))
+		{
+			spdlog::error("vulkan memory type {} not supported by image: {}", memory->getMemoryTypeIndex(), _desc.name);
+		}
 		vkBindImageMemory(device.getDevice(), _image, memory->getMemory(), offset);
 
 		if (!_desc.name.empty())
@@ -96,10 +90,9 @@ namespace kdGfx
 
 	VKTexture::~VKTexture()
 	{
-		if (_imageMemory)
-			vkFreeMemory(_device.getDevice(), _imageMemory, nullptr);
 		if (!_outerImage)
 			vkDestroyImage(_device.getDevice(), _image, nullptr);
+		_device.getMemoryAllocator().free(_allocation);
 	}
 
 	std::shared_ptr<TextureView> VKTexture::createView(const TextureViewDesc& desc)
@@ -24,7 +24,7 @@ namespace kdGfx
 
     private:
         VKDevice& _device;
-        VkDeviceMemory _imageMemory = VK_NULL_HANDLE;
+        VKAllocation _allocation;
         VkImage _image = VK_NULL_HANDLE;
         VkFormat _vkFormat = VK_FORMAT_UNDEFINED;
 		bool _outerImage = false;
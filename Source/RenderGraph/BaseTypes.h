@@ -7,12 +7,41 @@ namespace kdGfx
     // DAG（有向无环图）的虚拟资源索引
     using RenderGraphResource = uint32_t;
 
+    // 描述相同的资源可以互相替换，不比较名字
+    inline bool isSameTextureDesc(const TextureDesc& a, const TextureDesc& b)
+    {
+        return a.type == b.type && a.usage == b.usage && a.format == b.format &&
+            a.width == b.width && a.height == b.height && a.depth == b.depth &&
+            a.mipLevels == b.mipLevels && a.arrayLayers == b.arrayLayers && a.sampleCount == b.sampleCount;
+    }
+
+    inline bool isSameBufferDesc(const BufferDesc& a, const BufferDesc& b)
+    {
+        return a.size == b.size && a.stride == b.stride && a.usage == b.usage && a.hostVisible == b.hostVisible;
+    }
+
+    // 读写贴图的全部mip和数组层
+    inline constexpr TextureViewDesc RenderGraphAllSubresources = { 0, UINT32_MAX, 0, UINT32_MAX };
+
+    inline bool isAllSubresources(const TextureViewDesc& range)
+    {
+        return range.baseMipLevel == 0 && range.levelCount == UINT32_MAX && range.baseArrayLayer == 0 && range.layerCount == UINT32_MAX;
+    }
+
+    inline bool isSameSubresourceRange(const TextureViewDesc& a, const TextureViewDesc& b)
+    {
+        return a.baseMipLevel == b.baseMipLevel && a.levelCount == b.levelCount &&
+            a.baseArrayLayer == b.baseArrayLayer && a.layerCount == b.layerCount;
+    }
+
     // 资源作为Pass的边，用于构建依赖
     struct RenderGraphPassNode;
     struct RenderGraphResourceEdge
     {
-        // 只有一个写入Pass或外部导入
+        // 第一个没有被剔除的写入Pass，没有时是外部导入
         RenderGraphPassNode* producer = nullptr;
+        // 按添加顺序的所有写入Pass，写入不同mip和数组层的Pass可以有多个
+        std::vector<RenderGraphPassNode*> producers;
         // 可多个Pass读取
         std::vector<RenderGraphPassNode*> consumers;
         // 内部管理资源生命周期
@@ -26,6 +55,8 @@ namespace kdGfx
         std::string name;
         bool isUAV = false;
         RenderGraphResource handle = 0;
+        // 历史资源指向当前帧的资源，自身没有写入Pass
+        RenderGraphResourceEdge* historySource = nullptr;
     };
 
     // Pass类型。带Frame表示和RenderGraph的大小同步（一般设定成后缓冲大小），会自动缩放大小
@@ -38,12 +69,27 @@ namespace kdGfx
         FrameCompute
     };
 
+    // 由渲染图开始RenderPass时的附件
+    struct RenderGraphAttachment
+    {
+        RenderGraphResource resource = 0;
+        LoadOp loadOp = LoadOp::Load;
+        std::array<float, 4> clearColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float clearDepth = 1.0f;
+        uint32_t clearStencil = 0;
+        // 编译时根据前后的读写推导
+        LoadOp inferredLoadOp = LoadOp::Load;
+        StoreOp inferredStoreOp = StoreOp::Store;
+    };
+
     class RenderGraphRegistry;
     class RenderGraphBuilder;
     // Pass执行函数
     using RenderGraphPassNodeEvaluation = std::function<void(RenderGraphRegistry&, CommandList&)>;
     // Pass构造函数
     using RenderGraphPassNodeConstruction = std::function<RenderGraphPassNodeEvaluation(RenderGraphBuilder&)>;
+    // Pass执行条件，每帧执行前判断
+    using RenderGraphPassCondition = std::function<bool()>;
    
     // 构成DAG的节点，构建依赖，执行图形命令
     struct RenderGraphPassNode
@@ -51,10 +97,74 @@ namespace kdGfx
         std::vector<RenderGraphPassNode*> dependencies;
         std::vector<RenderGraphResourceEdge*> inputs;
         std::vector<RenderGraphResourceEdge*> outputs;
+        // 和inputs、outputs一一对应的贴图访问范围
+        std::vector<TextureViewDesc> inputRanges;
+        std::vector<TextureViewDesc> outputRanges;
 
         std::string name;
+        // 添加到图中的顺序
+        uint32_t index = 0;
         RenderGraphPassType type = RenderGraphPassType::Raster;
         RenderGraphPassNodeEvaluation evaluation;
         bool isCullBase = false;
+        // 编译时被剔除，节点保留以便重新编译时恢复
+        bool isCulled = false;
+        // 没有条件时总是执行。编译按全部执行规划，跳过不影响调度和内存
+        RenderGraphPassCondition condition;
+        // 本帧是否执行，执行开始时由条件决定
+        bool isEnabled = true;
+        // 执行函数和外部共享的参数
+        std::shared_ptr<void> parameters;
+        const std::type_info* parametersType = nullptr;
+        // 多队列执行时所在队列
+        CommandListType queue = CommandListType::General;
+        // 声明了附件时由渲染图开始和结束RenderPass
+        std::vector<RenderGraphAttachment> colorAttachments;
+        RenderGraphAttachment depthAttachment;
+    };
+
+    // Pass执行顺序的调度策略，都只遵守每条边的真实依赖，不按层级同步
+    enum struct RenderGraphScheduleStrategy
+    {
+        // 关键路径长的Pass优先，让无关的分支尽早开始
+        MaximizeOverlap,
+        // 释放内存多、分配内存少的Pass优先，降低临时资源峰值
+        MinimizeMemory
+    };
+
+    // 多队列执行时的命令录制方式
+    enum struct RenderGraphRecordMode
+    {
+        // 每个提交批次一个命令列表，单线程录制
+        Serial,
+        // 每个Pass一个命令列表，多线程录制
+        ParallelPass,
+        // 批次内同一层级的Pass一个命令列表，多线程录制
+        ParallelLevel
+    };
+
+    // 跨队列读取贴图时的所有权转移
+    struct RenderGraphQueueTransfer
+    {
+        RenderGraphResourceEdge* resource = nullptr;
+        CommandListType srcQueue = CommandListType::General;
+        CommandListType dstQueue = CommandListType::General;
+        // 第一个读取的Pass，决定转移后的状态
+        RenderGraphPassNode* consumer = nullptr;
+    };
+
+    // 多队列执行时的一次提交，同一队列的批次按顺序执行
+    struct RenderGraphSubmitBatch
+    {
+        CommandListType queue = CommandListType::General;
+        std::vector<RenderGraphPassNode*> passes;
+        // 提交前等待的其他队列批次
+        std::vector<uint32_t> waits;
+        // 批次开头获取，批次末尾释放
+        std::vector<RenderGraphQueueTransfer> acquires;
+        std::vector<RenderGraphQueueTransfer> releases;
+        // 提交后发出信号，signalIndex是在所在队列的第几次信号
+        bool signal = false;
+        uint32_t signalIndex = 0;
     };
 }
@@ -3,9 +3,122 @@
 #include "../Misc.h"
 #include <imnodes/imnodes_internal.h>
 #include <set>
+#include <map>
 
 namespace kdGfx
 {
+	inline static bool isDepthFormat(Format format)
+	{
+		return format == Format::D16Unorm || format == Format::D24UnormS8Uint || format == Format::D32Sfloat;
+	}
+
+	// Pass读取贴图需要的状态
+	inline static TextureState getInputTextureState(RenderGraphPassType type, const std::shared_ptr<Texture>& texture)
+	{
+		if (type == RenderGraphPassType::Compute || type == RenderGraphPassType::FrameCompute)
+			return TextureState::General;
+		if (type == RenderGraphPassType::Copy)
+			return TextureState::CopySrc;
+		return isDepthFormat(texture->getFormat()) ? TextureState::DepthStencilRead : TextureState::ShaderRead;
+	}
+
+	// Pass写入贴图需要的状态
+	inline static TextureState getOutputTextureState(RenderGraphPassType type, const std::shared_ptr<Texture>& texture)
+	{
+		if (type == RenderGraphPassType::Compute || type == RenderGraphPassType::FrameCompute)
+			return TextureState::General;
+		if (type == RenderGraphPassType::Copy)
+			return TextureState::CopyDst;
+		return isDepthFormat(texture->getFormat()) ? TextureState::DepthStencilWrite : TextureState::ColorAttachment;
+	}
+
+	// Pass访问贴图的管线阶段
+	inline static PipelineStage getTextureStage(RenderGraphPassType type, TextureState state)
+	{
+		if (type == RenderGraphPassType::Compute || type == RenderGraphPassType::FrameCompute)
+			return PipelineStage::ComputeShader;
+		if (type == RenderGraphPassType::Copy)
+			return PipelineStage::Copy;
+		switch (state)
+		{
+		case TextureState::ColorAttachment:
+			return PipelineStage::ColorAttachment;
+		case TextureState::DepthStencilWrite:
+			return PipelineStage::DepthStencil;
+		case TextureState::DepthStencilRead:
+			return PipelineStage::DepthStencil | PipelineStage::PixelShader;
+		default:
+			return PipelineStage::VertexShader | PipelineStage::PixelShader;
+		}
+	}
+
+	// 两个mip和数组层范围是否有交集，数量为UINT32_MAX时一直到最后
+	inline static bool isRangeOverlap(const TextureViewDesc& a, const TextureViewDesc& b)
+	{
+		auto overlap = [](uint64_t baseA, uint64_t countA, uint64_t baseB, uint64_t countB)
+			{
+				return baseA < baseB + countB && baseB < baseA + countA;
+			};
+		return overlap(a.baseMipLevel, a.levelCount, b.baseMipLevel, b.levelCount) &&
+			overlap(a.baseArrayLayer, a.layerCount, b.baseArrayLayer, b.layerCount);
+	}
+
+	// Pass的输入或输出是否访问了资源的这个范围
+	inline static bool isAccessOverlap(const std::vector<RenderGraphResourceEdge*>& resEdges, const std::vector<TextureViewDesc>& ranges,
+		const RenderGraphResourceEdge* resEdge, const TextureViewDesc& range)
+	{
+		for (size_t i = 0; i < resEdges.size(); ++i)
+		{
+			if (resEdges[i] == resEdge && isRangeOverlap(ranges[i], range))
+				return true;
+		}
+		return false;
+	}
+
+	// 主机可见和常量buffer需要映射，单独创建，其他buffer放在渲染图的内存上
+	inline static bool canPlaceBuffer(const BufferDesc& desc)
+	{
+		return desc.hostVisible == HostVisible::Invisible && !HasAnyBits(desc.usage, BufferUsage::Constant);
+	}
+
+	// Pass读取buffer需要的状态，光栅Pass按用途区分
+	inline static BufferState getInputBufferState(RenderGraphPassType type, const std::shared_ptr<Buffer>& buffer)
+	{
+		if (type == RenderGraphPassType::Copy)
+			return BufferState::CopySrc;
+		BufferUsage usage = buffer->getDesc().usage;
+		if (type == RenderGraphPassType::Raster || type == RenderGraphPassType::FrameRaster)
+		{
+			if (HasAnyBits(usage, BufferUsage::Indirect))
+				return BufferState::Indirect;
+			if (HasAnyBits(usage, BufferUsage::Vertex | BufferUsage::Index))
+				return BufferState::VertexIndex;
+		}
+		if (HasAnyBits(usage, BufferUsage::Constant))
+			return BufferState::Constant;
+		return BufferState::ShaderRead;
+	}
+
+	// Pass写入buffer需要的状态
+	inline static BufferState getOutputBufferState(RenderGraphPassType type)
+	{
+		return type == RenderGraphPassType::Copy ? BufferState::CopyDst : BufferState::ShaderWrite;
+	}
+
+	// Pass访问buffer的管线阶段
+	inline static PipelineStage getBufferStage(RenderGraphPassType type, BufferState state)
+	{
+		if (type == RenderGraphPassType::Compute || type == RenderGraphPassType::FrameCompute)
+			return PipelineStage::ComputeShader;
+		if (type == RenderGraphPassType::Copy)
+			return PipelineStage::Copy;
+		if (state == BufferState::Indirect)
+			return PipelineStage::DrawIndirect;
+		if (state == BufferState::VertexIndex)
+			return PipelineStage::VertexInput;
+		return PipelineStage::VertexShader | PipelineStage::PixelShader;
+	}
+
 	RenderGraph::RenderGraph(const std::shared_ptr<Device>& device) :
 		_device(device),
 		_registry(*this)
@@ -14,6 +127,10 @@ namespace kdGfx
 
 	RenderGraph::~RenderGraph()
 	{
+		_waitSubmitBatches();
+		_releaseResources();
+		_recordUnits.clear();
+		_queueFences.clear();
 		for (auto node : _passes)
 			delete node;
 		_passes.clear();
@@ -31,6 +148,7 @@ namespace kdGfx
 	{
 		auto passNode = new RenderGraphPassNode();
 		passNode->name = name;
+		passNode->index = (uint32_t)_passes.size();
 		passNode->type = type;
 		RenderGraphBuilder builder(*this, passNode);
 		// 执行pass构造。生成DAG连接关系
@@ -43,62 +161,153 @@ namespace kdGfx
 	{
 		if (!_dirty) return;
 
-		// 确定Pass之间的依赖
+		// 确定Pass之间的依赖，同一资源按mip和数组层范围判断读写是否重叠
 		for (auto& pass : _passes)
 		{
 			pass->dependencies.clear();
-			for (auto& resEdge : pass->inputs)
+			auto addDependency = [pass](RenderGraphPassNode* dependency)
+				{
+					if (dependency != pass && std::find(pass->dependencies.begin(), pass->dependencies.end(), dependency) == pass->dependencies.end())
+						pass->dependencies.emplace_back(dependency);
+				};
+			auto isWriteBefore = [](RenderGraphPassNode* producer, RenderGraphPassNode* pass, RenderGraphResourceEdge* resEdge, const TextureViewDesc& range)
+				{
+					return producer->index < pass->index && isAccessOverlap(producer->outputs, producer->outputRanges, resEdge, range);
+				};
+
+			// 读取前面添加的Pass写入的内容，前面没有写入时依赖所有写入
+			for (size_t i = 0; i < pass->inputs.size(); ++i)
 			{
-				if (resEdge->producer != nullptr)
+				auto resEdge = pass->inputs[i];
+				const auto& range = pass->inputRanges[i];
+				const bool hasWriteBefore = std::any_of(resEdge->producers.begin(), resEdge->producers.end(),
+					[&](RenderGraphPassNode* producer) { return isWriteBefore(producer, pass, resEdge, range); });
+				for (auto producer : resEdge->producers)
 				{
-					pass->dependencies.emplace_back(resEdge->producer);
+					if (hasWriteBefore ? isWriteBefore(producer, pass, resEdge, range) :
+						isAccessOverlap(producer->outputs, producer->outputRanges, resEdge, range))
+						addDependency(producer);
 				}
 			}
-		}
-
-		// 剔除掉对设定节点的无关联节点
-		_cullPasses();
-
-		// 生成并行pass执行列表
-		_genParallelTasks();
-
-		// 自动推导贴图Usage
-		_autoSetTextureUsage();
-
-		// 确定资源生命周期
-		for (uint32_t i = 0; i < _passesTasks.size(); ++i)
-		{
-			for (auto pass : _passesTasks[i])
+			// 覆盖前面写入的范围，读取前面写入内容的Pass要先执行完
+			for (size_t i = 0; i < pass->outputs.size(); ++i)
 			{
-				for (auto resEdge : pass->outputs)
+				auto resEdge = pass->outputs[i];
+				const auto& range = pass->outputRanges[i];
+				for (auto producer : resEdge->producers)
 				{
-					resEdge->lifecycle.firstUseTask = i;
+					if (isWriteBefore(producer, pass, resEdge, range))
+						addDependency(producer);
 				}
-				for (auto resEdge : pass->inputs)
+				for (auto consumer : resEdge->consumers)
 				{
-					resEdge->lifecycle.lastUseTask = i;
+					if (consumer->index >= pass->index || !isAccessOverlap(consumer->inputs, consumer->inputRanges, resEdge, range)) continue;
+					if (std::any_of(resEdge->producers.begin(), resEdge->producers.end(),
+						[&](RenderGraphPassNode* producer) { return isWriteBefore(producer, consumer, resEdge, range); }))
+						addDependency(consumer);
 				}
 			}
 		}
 
-		// 设置帧图大小
-		for (auto& texturePair : _registry._texturesMap)
+		// 图结构和缓存一致时沿用缓存的剔除、分层和队列
+		const size_t topologyKey = _hashTopology();
+		_compileCacheHit = _compileCache.isLoaded() && _compileCache._key == topologyKey &&
+			_compileCache._passes.size() == _passes.size();
+		if (_compileCacheHit)
 		{
-			auto resEdge = _getResourceEdge(texturePair.first);
-			auto& [textureDesc, size, texture, textureView] = texturePair.second;
-			if (resEdge->producer->type == RenderGraphPassType::FrameRaster || 
-				resEdge->producer->type == RenderGraphPassType::FrameCompute)
+			for (auto pass : _passes)
 			{
-				textureDesc.width = _width;
-				textureDesc.height = _height;
+				pass->isCulled = _compileCache._passes[pass->index].isCulled;
+				pass->queue = _compileCache._passes[pass->index].queue;
+			}
+			_updateProducers();
+			_passesTasks.clear();
+			for (const auto& task : _compileCache._tasks)
+			{
+				auto& passesTask = _passesTasks.emplace_back();
+				for (auto index : task)
+					passesTask.push_back(_passes[index]);
+			}
+			_passOrder.clear();
+			for (auto index : _compileCache._order)
+				_passOrder.push_back(_passes[index]);
+			spdlog::info("render graph {} use compile cache", name);
+		}
+		else
+		{
+			// 剔除掉对设定节点的无关联节点
+			_cullPasses();
+			_updateProducers();
+
+			// 生成并行pass执行列表
+			_genParallelTasks();
+
+			// 确定执行顺序
+			_schedulePasses();
+
+			// 分配队列
+			_assignQueues();
+
+			_compileCache._key = topologyKey;
+			_compileCache._passes.clear();
+			for (auto pass : _passes)
+				_compileCache._passes.push_back({ pass->isCulled, pass->queue });
+			_compileCache._tasks.clear();
+			for (const auto& passesTask : _passesTasks)
+			{
+				auto& task = _compileCache._tasks.emplace_back();
+				for (auto pass : passesTask)
+					task.push_back(pass->index);
 			}
+			_compileCache._order.clear();
+			for (auto pass : _passOrder)
+				_compileCache._order.push_back(pass->index);
+			_compileCache._usages.clear();
+			_compileCache._placements.clear();
+			_compileCache._loaded = true;
+		}
+
+		// 生成多队列提交批次
+		_genSubmitBatches();
+
+		// 资源生命周期是跨队列依赖图上的层级区间，从所有使用者最早可能开始的层级到最晚可能结束的层级
+		for (auto& pair : _resourceEdgesMap)
+		{
+			pair.second->lifecycle = {};
+		}
+		std::unordered_set<RenderGraphResourceEdge*> usedEdges;
+		for (auto pass : _passOrder)
+		{
+			const auto [earliestLevel, latestLevel] = _passDependencyLevels.at(pass);
+			auto addUse = [&](RenderGraphResourceEdge* resEdge)
+				{
+					auto& lifecycle = resEdge->lifecycle;
+					if (usedEdges.insert(resEdge).second)
+					{
+						lifecycle.firstUseTask = earliestLevel;
+						lifecycle.lastUseTask = latestLevel;
+					}
+					else
+					{
+						lifecycle.firstUseTask = std::min(lifecycle.firstUseTask, earliestLevel);
+						lifecycle.lastUseTask = std::max(lifecycle.lastUseTask, latestLevel);
+					}
+				};
+			for (auto resEdge : pass->outputs)
+				addUse(resEdge);
+			for (auto resEdge : pass->inputs)
+				addUse(resEdge);
 		}
 
-		// buffer直接创建
+		_inferAttachmentOps();
+
+		// 需要映射的buffer直接创建
 		_allocResources();
-		// texture支持内存别名
+		// 贴图和其他buffer支持内存别名，未变化的资源沿用原来的位置
 		_allocMemory();
 		_createResources();
+		_allocHistoryTextures();
+		_createRangeViews();
 		
 		_compiled = true;
 		_dirty = false;
@@ -106,18 +315,209 @@ namespace kdGfx
 
 	void RenderGraph::execute()
 	{
+		if (_dirty) compile();
 		if (!_compiled || !_commandList) return;
 
-		for (uint32_t i = 0; i < _passesTasks.size(); ++i)
+		if (_profiler)
+			_profiler->beginFrame((uint32_t)_passes.size());
+		_updatePassConditions();
+		// 先推导所有屏障，合并RenderPass时后面Pass的屏障要提前
+		std::vector<RenderGraphBarrierBatch> passBarriers(_passOrder.size());
+		for (uint32_t i = 0; i < _passOrder.size(); ++i)
+		{
+			if (_passOrder[i]->isEnabled)
+				_genPassBarriers(_passOrder[i], passBarriers[i]);
+		}
+		std::vector<bool> mergedPasses;
+		_mergeRenderPasses(_passOrder, passBarriers, mergedPasses);
+		_recordPasses(_passOrder, passBarriers, mergedPasses, *_commandList.get(), CommandListType::General);
+		_barrierTracker.commit();
+		_registry._advanceHistory();
+	}
+
+	void RenderGraph::execute(std::shared_ptr<Fence> fence, uint64_t waitValue, uint64_t signalValue)
+	{
+		if (_dirty) compile();
+		if (!_compiled) return;
+
+		// 命令列表按帧轮换，只等待上次使用同一组命令列表的那一帧
+		const uint32_t frameSlot = _frameSlot;
+		_frameSlot = (_frameSlot + 1) % (uint32_t)_frameSlotFenceValues.size();
+		for (const auto& [queueType, fenceValue] : _frameSlotFenceValues[frameSlot])
+		{
+			_queueFences[queueType]->wait(fenceValue);
+		}
+		if (_profiler)
+			_profiler->beginFrame((uint32_t)_passes.size());
+		_updatePassConditions();
+
+		// 单线程按执行顺序推导所有屏障，录制时只使用推导结果，跳过的Pass不切换状态
+		std::unordered_map<RenderGraphResourceEdge*, TextureState> releasedStates;
+		for (uint32_t i = 0; i < _recordUnits.size(); ++i)
+		{
+			auto& unit = _recordUnits[i];
+			const auto& batch = _submitBatches[unit.batchIndex];
+			unit.beginBarriers.clear();
+			unit.endBarriers.clear();
+			unit.passBarriers.assign(unit.passes.size(), {});
+
+			if (i == 0 || _recordUnits[i - 1].batchIndex != unit.batchIndex)
+			{
+				for (const auto& transfer : batch.acquires)
+				{
+					const auto& [texture, textureView] = _registry.getTexture(transfer.resource->handle);
+					if (!texture) continue;
+					TextureState state = getInputTextureState(transfer.consumer->type, texture);
+					_barrierTracker.setTextureState(texture, releasedStates[transfer.resource]);
+					_barrierTracker.transitionTexture(unit.beginBarriers, texture, RenderGraphAllSubresources, state,
+						getTextureStage(transfer.consumer->type, state), false, transfer.srcQueue, transfer.dstQueue);
+					_textureOwners[transfer.resource->handle] = transfer.dstQueue;
+				}
+			}
+
+			for (uint32_t j = 0; j < unit.passes.size(); ++j)
+			{
+				auto pass = unit.passes[j];
+				if (!pass->isEnabled) continue;
+				for (auto outputResEdge : pass->outputs)
+				{
+					const auto& [texture, textureView] = _registry.getTexture(outputResEdge->handle);
+					if (!texture) continue;
+					// 其他队列上次写入的内容不需要保留，直接丢弃不转移所有权
+					if (_registry._texturesMap.contains(outputResEdge->handle))
+					{
+						if (_textureOwners[outputResEdge->handle] != batch.queue)
+							_barrierTracker.discardTexture(texture);
+						_textureOwners[outputResEdge->handle] = batch.queue;
+					}
+				}
+				_genPassBarriers(pass, unit.passBarriers[j]);
+			}
+			_mergeRenderPasses(unit.passes, unit.passBarriers, unit.mergedPasses);
+
+			if (i + 1 == _recordUnits.size() || _recordUnits[i + 1].batchIndex != unit.batchIndex)
+			{
+				for (const auto& transfer : batch.releases)
+				{
+					const auto& [texture, textureView] = _registry.getTexture(transfer.resource->handle);
+					if (!texture) continue;
+					TextureState state = getInputTextureState(transfer.consumer->type, texture);
+					releasedStates[transfer.resource] = _barrierTracker.transitionTexture(unit.endBarriers, texture, RenderGraphAllSubresources,
+						state, getTextureStage(transfer.consumer->type, state), false, transfer.srcQueue, transfer.dstQueue);
+				}
+			}
+		}
+
+		auto record = [this, frameSlot](uint32_t unitIndex)
+			{
+				auto& unit = _recordUnits[unitIndex];
+				auto& commandList = unit.commandLists[frameSlot];
+				commandList->reset();
+				commandList->begin();
+				auto applyBarriers = [&commandList](const RenderGraphBarrierBatch& barriers)
+					{
+						if (!barriers.empty())
+							commandList->resourceBarriers(barriers.textureBarriers, barriers.bufferBarriers);
+					};
+				applyBarriers(unit.beginBarriers);
+				_recordPasses(unit.passes, unit.passBarriers, unit.mergedPasses, *commandList.get(), _submitBatches[unit.batchIndex].queue);
+				applyBarriers(unit.endBarriers);
+				commandList->end();
+			};
+		if (_recordMode != RenderGraphRecordMode::Serial && _threadPool)
+		{
+			_threadPool->parallelFor((uint32_t)_recordUnits.size(), record);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < _recordUnits.size(); ++i)
+				record(i);
+		}
+		// 并行录制时状态写入顺序不确定，统一设置推导的最终状态
+		_barrierTracker.commit();
+		_registry._advanceHistory();
+
+		// 每个批次的等待、命令列表和信号按依赖顺序一次提交
+		auto baseValues = _queueFenceValues;
+		std::unordered_set<CommandListType> startedQueues;
+		uint32_t unitIndex = 0;
+		for (uint32_t i = 0; i < _submitBatches.size(); ++i)
+		{
+			const auto& batch = _submitBatches[i];
+			SubmitDesc submitDesc;
+			for (; unitIndex < _recordUnits.size() && _recordUnits[unitIndex].batchIndex == i; ++unitIndex)
+			{
+				submitDesc.commandLists.push_back(_recordUnits[unitIndex].commandLists[frameSlot]);
+			}
+
+			if (fence && startedQueues.insert(batch.queue).second)
+			{
+				submitDesc.waits.push_back({ fence, waitValue });
+			}
+			// 获取所有权的屏障接在等待之后，保持AllCommands
+			for (auto waitBatchIndex : batch.waits)
+			{
+				const auto& waitBatch = _submitBatches[waitBatchIndex];
+				submitDesc.waits.push_back({ _queueFences[waitBatch.queue], baseValues[waitBatch.queue] + waitBatch.signalIndex + 1 });
+			}
+			if (batch.signal)
+			{
+				_queueFenceValues[batch.queue] = baseValues[batch.queue] + batch.signalIndex + 1;
+				submitDesc.signals.push_back({ _queueFences[batch.queue], _queueFenceValues[batch.queue] });
+			}
+			_device->getCommandQueue(batch.queue)->submit(submitDesc);
+		}
+		_frameSlotFenceValues[frameSlot] = _queueFenceValues;
+
+		// 主队列汇合其他队列，之后提交到主队列的命令能看到所有结果
+		SubmitDesc joinDesc;
+		for (const auto& [queueType, queueFence] : _queueFences)
 		{
-			for (auto& pass : _passesTasks[i])
+			if (queueType != CommandListType::General && _queueFenceValues[queueType] > baseValues[queueType])
 			{
-				_commandList->beginLabel(fmt::format("Pass {}", pass->name));
-				_autoTransitionTextureState(pass, _commandList);
-				pass->evaluation(_registry, *_commandList.get());
-				_commandList->endLabel();
+				joinDesc.waits.push_back({ queueFence, _queueFenceValues[queueType] });
 			}
 		}
+		if (fence)
+		{
+			joinDesc.signals.push_back({ fence, signalValue });
+		}
+		if (!joinDesc.waits.empty() || !joinDesc.signals.empty())
+		{
+			_device->getCommandQueue(CommandListType::General)->submit(joinDesc);
+		}
+	}
+
+	std::vector<const RenderGraphSubmitBatch*> RenderGraph::getQueueTimeline(CommandListType queue) const
+	{
+		std::vector<const RenderGraphSubmitBatch*> timeline;
+		for (const auto& batch : _submitBatches)
+		{
+			if (batch.queue == queue)
+				timeline.push_back(&batch);
+		}
+		return timeline;
+	}
+
+	void RenderGraph::setResourcePool(const std::shared_ptr<RenderGraphResourcePool>& resourcePool)
+	{
+		if (_resourcePool == resourcePool) return;
+
+		// 已创建的资源可能还在GPU上使用，归还前等待
+		if (_memory || !_registry._buffersMap.empty())
+			_waitQueuesIdle();
+		_releaseResources();
+		_resourcePool = resourcePool;
+		markDirty();
+	}
+
+	void RenderGraph::setPassCondition(const std::string_view passName, RenderGraphPassCondition condition)
+	{
+		for (auto pass : _passes)
+		{
+			if (pass->name == passName)
+				pass->condition = condition;
+		}
 	}
 
 	void RenderGraph::resize(uint32_t width, uint32_t height)
@@ -126,35 +526,102 @@ namespace kdGfx
 		_height = height;
 		if (_compiled)
 		{
-			_registry.resize(width, height);
+			// 只有帧图需要重建，其他贴图尽量保留
+			_allocMemory();
+			_createResources();
+			_allocHistoryTextures();
+			_createRangeViews();
 			spdlog::debug("render graph resize to {}x{}", _width, _height);
 		}
 	}
 
-	void RenderGraph::_cullPasses()
+	size_t RenderGraph::_hashTopology() const
 	{
-		// 找到需要保留的资源和Pass
-		std::vector<RenderGraphPassNode*> cullBasePasses;
+		size_t seed = 0;
+		HashCombine(seed, _aliasingStrategy);
+		HashCombine(seed, _scheduleStrategy);
+		HashCombine(seed, _asyncQueues);
 		for (auto pass : _passes)
 		{
-			if (pass->isCullBase)
+			HashCombine(seed, pass->name);
+			HashCombine(seed, pass->type);
+			HashCombine(seed, pass->isCullBase);
+			auto hashRange = [&seed](const TextureViewDesc& range)
+				{
+					HashCombine(seed, range.baseMipLevel);
+					HashCombine(seed, range.levelCount);
+					HashCombine(seed, range.baseArrayLayer);
+					HashCombine(seed, range.layerCount);
+				};
+			HashCombine(seed, pass->inputs.size());
+			for (size_t i = 0; i < pass->inputs.size(); ++i)
+			{
+				HashCombine(seed, pass->inputs[i]->handle);
+				hashRange(pass->inputRanges[i]);
+			}
+			HashCombine(seed, pass->outputs.size());
+			for (size_t i = 0; i < pass->outputs.size(); ++i)
 			{
-				cullBasePasses.push_back(pass);
+				HashCombine(seed, pass->outputs[i]->handle);
+				HashCombine(seed, pass->outputs[i]->isUAV);
+				hashRange(pass->outputRanges[i]);
 			}
 		}
 
+		// 哈希表遍历顺序不固定，按句柄排序
+		std::map<RenderGraphResource, size_t> resourceHashes;
+		for (const auto& [handle, tuple] : _registry._texturesMap)
+		{
+			const auto& desc = std::get<0>(tuple);
+			size_t hash = 0;
+			HashCombine(hash, desc.type);
+			HashCombine(hash, desc.usage);
+			HashCombine(hash, desc.format);
+			HashCombine(hash, desc.width);
+			HashCombine(hash, desc.height);
+			HashCombine(hash, desc.depth);
+			HashCombine(hash, desc.mipLevels);
+			HashCombine(hash, desc.arrayLayers);
+			HashCombine(hash, desc.sampleCount);
+			resourceHashes[handle] = hash;
+		}
+		for (const auto& [handle, tuple] : _registry._buffersMap)
+		{
+			const auto& desc = std::get<0>(tuple);
+			size_t hash = 0;
+			HashCombine(hash, desc.size);
+			HashCombine(hash, desc.stride);
+			HashCombine(hash, desc.usage);
+			HashCombine(hash, desc.hostVisible);
+			resourceHashes[handle] = hash;
+		}
+		for (const auto& [handle, _] : _registry._importTexturesMap)
+			resourceHashes[handle] = 1;
+		for (const auto& [handle, _] : _registry._importBuffersMap)
+			resourceHashes[handle] = 2;
+		for (const auto& [handle, source] : _registry._historySourcesMap)
+			HashCombine(resourceHashes[handle], source);
+		for (const auto& [handle, hash] : resourceHashes)
+		{
+			HashCombine(seed, handle);
+			HashCombine(seed, hash);
+		}
+		return seed;
+	}
+
+	void RenderGraph::_cullPasses()
+	{
+		// 找到需要保留的Pass
 		std::unordered_set<RenderGraphPassNode*> keepPasses;
-		std::unordered_set<RenderGraphResourceEdge*> keepResources;
 		std::queue<RenderGraphPassNode*> queue;
 
-		for (auto pass : cullBasePasses)
+		for (auto pass : _passes)
 		{
-			keepPasses.insert(pass);
-			for (auto output : pass->outputs)
+			if (pass->isCullBase)
 			{
-				keepResources.insert(output);
+				keepPasses.insert(pass);
+				queue.push(pass);
 			}
-			queue.push(pass);
 		}
 
 		// 逆向遍历依赖
@@ -163,61 +630,51 @@ namespace kdGfx
 			auto currentPass = queue.front();
 			queue.pop();
 
+			// 依赖包括读取范围内的所有写入Pass
+			std::vector<RenderGraphPassNode*> keeps = currentPass->dependencies;
 			for (auto inputRes : currentPass->inputs)
 			{
-				keepResources.insert(inputRes);
-
-				auto producer = inputRes->producer;
-				if (producer && !keepPasses.count(producer))
-				{
-					keepPasses.insert(producer);
-					queue.push(producer);
-				}
-			}
-		}
-
-		// 裁剪
-		_passes.erase(std::remove_if(_passes.begin(), _passes.end(),
-			[&](RenderGraphPassNode* pass)
-			{
-				return !keepPasses.count(pass);
-			}),
-			_passes.end());
-
-		for (auto it = _resourceEdgesMap.begin(); it != _resourceEdgesMap.end();)
-		{
-			if (!keepResources.count(it->second))
-			{
-				delete it->second;
-				it = _resourceEdgesMap.erase(it);
+				// 读取历史时当前帧的写入也要保留，供下一帧读取
+				if (inputRes->historySource)
+					keeps.insert(keeps.end(), inputRes->historySource->producers.begin(), inputRes->historySource->producers.end());
 			}
-			else
+			for (auto pass : keeps)
 			{
-				++it;
+				if (keepPasses.insert(pass).second)
+					queue.push(pass);
 			}
 		}
 
-		// 清理被移除Pass的依赖关系
+		// 只做标记不删除节点，切换设定节点后可以恢复。没有设定节点时全部保留
 		for (auto pass : _passes)
 		{
-			auto& deps = pass->dependencies;
-			deps.erase(std::remove_if(deps.begin(), deps.end(),
-				[&](RenderGraphPassNode* dep)
-				{
-					return !keepPasses.count(dep);
-				}),
-			deps.end());
+			pass->isCulled = !keepPasses.empty() && !keepPasses.count(pass);
+		}
+	}
+
+	void RenderGraph::_updateProducers()
+	{
+		for (auto& [handle, resEdge] : _resourceEdgesMap)
+		{
+			auto& producers = resEdge->producers;
+			auto it = std::find_if(producers.begin(), producers.end(), [](RenderGraphPassNode* producer) { return !producer->isCulled; });
+			resEdge->producer = it != producers.end() ? *it : (producers.empty() ? nullptr : producers.front());
 		}
 	}
 
 	void RenderGraph::_genParallelTasks()
 	{
 		std::unordered_map<RenderGraphPassNode*, size_t> inDegree;
+		std::unordered_map<RenderGraphPassNode*, std::vector<RenderGraphPassNode*>> successors;
 		std::queue<RenderGraphPassNode*> queue;
+		_passesTasks.clear();
 
 		for (auto pass : _passes)
 		{
+			if (pass->isCulled) continue;
 			inDegree[pass] = pass->dependencies.size();
+			for (auto dependency : pass->dependencies)
+				successors[dependency].push_back(pass);
 			if (inDegree[pass] == 0)
 			{
 				queue.push(pass);
@@ -238,14 +695,11 @@ namespace kdGfx
 				currentLevel.emplace_back(currentPass);
 
 				// 更新后续节点的入度
-				for (auto outputRes : currentPass->outputs)
+				for (auto successor : successors[currentPass])
 				{
-					for (auto consumerPass : outputRes->consumers)
+					if (--inDegree[successor] == 0)
 					{
-						if (--inDegree[consumerPass] == 0)
-						{
-							queue.push(consumerPass);
-						}
+						queue.push(successor);
 					}
 				}
 			}
@@ -271,203 +725,1214 @@ namespace kdGfx
 		spdlog::info("]");
 	}
 
-	void RenderGraph::_allocResources()
+	void RenderGraph::_updatePassConditions()
 	{
-		for (auto& _passesTask : _passesTasks)
+		for (auto pass : _passes)
 		{
-			for (auto& pass : _passesTask)
-			{
-				for (auto resEdge : pass->outputs)
-				{
-					if (_registry._buffersMap.contains(resEdge->handle))
-					{
-						auto& [bufferDesc, buffer] = _registry._buffersMap[resEdge->handle];
-						if (buffer)	continue;
-
-						buffer = _device->createBuffer(bufferDesc);
-						spdlog::debug("render graph {} create buffer {}", name, resEdge->name);
-					}
-				}
-			}
+			pass->isEnabled = !pass->isCulled && (!pass->condition || pass->condition());
 		}
 	}
 
-	void RenderGraph::_allocMemory()
+	void RenderGraph::_schedulePasses()
 	{
-		size_t memOffset = 0;
-		for (uint32_t taskIndex = 0; taskIndex < _passesTasks.size(); ++taskIndex)
+		// 同一对Pass之间多条边只算一次依赖
+		std::unordered_map<RenderGraphPassNode*, std::unordered_set<RenderGraphPassNode*>> successors;
+		std::unordered_map<RenderGraphPassNode*, size_t> inDegree;
+		for (auto pass : _passes)
+		{
+			if (pass->isCulled) continue;
+			std::unordered_set<RenderGraphPassNode*> predecessors(pass->dependencies.begin(), pass->dependencies.end());
+			inDegree[pass] = predecessors.size();
+			for (auto dependency : predecessors)
+				successors[dependency].insert(pass);
+		}
+
+		// 有Profiler结果时按实测平均耗时计算关键路径，没有统计的Pass取平均值
+		std::unordered_map<std::string, float> measuredCosts;
+		float defaultCost = 1.0f;
+		if (_profiler)
 		{
-			std::list<std::pair<size_t, size_t>> retireMemBlocks; // offset, size
-			for (auto& pair : _registry._texturesMap)
+			float totalCost = 0.0f;
+			for (const auto& timing : _profiler->getPassTimings())
 			{
-				auto resEdge = _getResourceEdge(pair.first);
-				if (resEdge->lifecycle.lastUseTask < taskIndex)
-				{
-					auto& [textureDesc, size, _, __] = _registry._texturesMap[resEdge->handle];
-					retireMemBlocks.emplace_back(std::make_pair(memOffset, size));
-				}
+				if (timing.avgTime <= 0.0f) continue;
+				measuredCosts[timing.name] = timing.avgTime;
+				totalCost += timing.avgTime;
+			}
+			if (!measuredCosts.empty())
+				defaultCost = totalCost / measuredCosts.size();
+		}
+		// 从该Pass到图结束的最长路径，层级倒序就是逆拓扑序
+		std::unordered_map<RenderGraphPassNode*, float> criticalPaths;
+		for (auto it = _passesTasks.rbegin(); it != _passesTasks.rend(); ++it)
+		{
+			for (auto pass : *it)
+			{
+				float longest = 0.0f;
+				for (auto successor : successors[pass])
+					longest = std::max(longest, criticalPaths[successor]);
+				auto costIt = measuredCosts.find(pass->name);
+				criticalPaths[pass] = (costIt != measuredCosts.end() ? costIt->second : defaultCost) + longest;
 			}
+		}
 
-			for (auto& pass : _passesTasks[taskIndex])
+		// 临时资源的大小和还没执行的读取Pass数量，导入和历史资源不参与内存别名
+		std::unordered_map<RenderGraphResourceEdge*, size_t> resourceSizes;
+		std::unordered_map<RenderGraphResourceEdge*, size_t> pendingConsumers;
+		for (auto pass : _passes)
+		{
+			if (pass->isCulled) continue;
+			for (auto resEdge : pass->outputs)
 			{
-				for (auto resEdge : pass->outputs)
+				size_t size = 0;
+				if (auto it = _registry._buffersMap.find(resEdge->handle); it != _registry._buffersMap.end())
 				{
-					if (_registry._texturesMap.contains(resEdge->handle))
+					if (canPlaceBuffer(std::get<0>(it->second)))
+						size = std::get<0>(it->second).size;
+				}
+				else if (auto it = _registry._texturesMap.find(resEdge->handle);
+					it != _registry._texturesMap.end() && !_registry._historyTexturesMap.contains(resEdge->handle))
+				{
+					TextureDesc textureDesc = std::get<0>(it->second);
+					if (pass->type == RenderGraphPassType::FrameRaster || pass->type == RenderGraphPassType::FrameCompute)
 					{
-						auto& [textureDesc, size, _, __] = _registry._texturesMap[resEdge->handle];
-						auto it = std::find_if(retireMemBlocks.begin(), retireMemBlocks.end(), [&textureDesc](auto& retireMemBlock)
-							{
-								return retireMemBlock.second >= textureDesc.width * textureDesc.height;
-							});
-						if (it == retireMemBlocks.end())
-						{
-							size = _device->getTextureAllocateSize(textureDesc);
-							memOffset += size;
-						}
-						else
-						{
-							retireMemBlocks.erase(it);
-						}
+						textureDesc.width = _width;
+						textureDesc.height = _height;
 					}
+					_autoSetTextureUsage(resEdge, textureDesc);
+					size = _getTextureAllocateInfo(textureDesc).size;
 				}
-			}
-		}
+				resourceSizes[resEdge] = size;
 
-		_memory = _device->createMemory({ .size = memOffset });
-		spdlog::debug("render graph {} alloc memory size {}", name, memOffset);
-	}
-
-	void RenderGraph::_createResources()
-	{
-		size_t memOffset = 0;
-		for (uint32_t taskIndex = 0; taskIndex < _passesTasks.size(); ++taskIndex)
-		{
-			std::list<std::pair<size_t, size_t>> retireMemBlocks; // offset, size
-			for (auto& pair : _registry._texturesMap)
-			{
-				auto resEdge = _getResourceEdge(pair.first);
-				if (resEdge->lifecycle.lastUseTask < taskIndex)
+				std::unordered_set<RenderGraphPassNode*> consumers;
+				for (auto consumer : resEdge->consumers)
 				{
-					auto& [textureDesc, size, _, __] = _registry._texturesMap[resEdge->handle];
-					retireMemBlocks.emplace_back(std::make_pair(memOffset, size));
+					if (!consumer->isCulled)
+						consumers.insert(consumer);
 				}
+				pendingConsumers[resEdge] = consumers.size();
 			}
-			
-			for (auto& pass : _passesTasks[taskIndex])
+		}
+		auto getUniqueInputs = [](RenderGraphPassNode* pass)
+			{
+				std::unordered_set<RenderGraphResourceEdge*> inputs(pass->inputs.begin(), pass->inputs.end());
+				return inputs;
+			};
+		// 执行后临时内存的变化，没有读取者的资源写完就释放，不计入
+		auto getMemoryDelta = [&](RenderGraphPassNode* pass)
 			{
+				int64_t delta = 0;
 				for (auto resEdge : pass->outputs)
 				{
-					if (_registry._texturesMap.contains(resEdge->handle))
-					{
-						auto& [textureDesc, size, texture, textureView] = _registry._texturesMap[resEdge->handle];
-						assert(!texture);
-
-						size_t offset = 0;
-						std::string useMemoryAliasing;
-						auto it = std::find_if(retireMemBlocks.begin(), retireMemBlocks.end(), [&textureDesc](auto& retireMemBlock)
-							{
-								return retireMemBlock.second >= textureDesc.width * textureDesc.height;
-							});
-						if (it == retireMemBlocks.end())
-						{
-							offset = memOffset;
-							memOffset += size;
-						}
-						else
-						{
-							retireMemBlocks.erase(it);
-							useMemoryAliasing = ". use memory aliasing";
-						}
+					if (pendingConsumers[resEdge] > 0)
+						delta += resourceSizes[resEdge];
+				}
+				for (auto resEdge : getUniqueInputs(pass))
+				{
+					auto it = pendingConsumers.find(resEdge);
+					if (it != pendingConsumers.end() && it->second == 1)
+						delta -= resourceSizes[resEdge];
+				}
+				return delta;
+			};
 
-						texture = _device->createTexture(textureDesc, _memory, offset);
-						textureView = texture->createView({});
-						spdlog::debug("render graph {} create texture {}{}", name, resEdge->name, useMemoryAliasing);
+		std::vector<RenderGraphPassNode*> ready;
+		for (auto pass : _passes)
+		{
+			if (!pass->isCulled && inDegree[pass] == 0)
+				ready.push_back(pass);
+		}
+		_passOrder.clear();
+		while (!ready.empty())
+		{
+			std::unordered_map<RenderGraphPassNode*, int64_t> memoryDeltas;
+			for (auto pass : ready)
+				memoryDeltas[pass] = getMemoryDelta(pass);
+			auto better = [&](RenderGraphPassNode* a, RenderGraphPassNode* b)
+				{
+					const float pathA = criticalPaths[a];
+					const float pathB = criticalPaths[b];
+					const int64_t deltaA = memoryDeltas[a];
+					const int64_t deltaB = memoryDeltas[b];
+					if (_scheduleStrategy == RenderGraphScheduleStrategy::MinimizeMemory)
+					{
+						if (deltaA != deltaB) return deltaA < deltaB;
+						if (pathA != pathB) return pathA > pathB;
 					}
-				}
+					else
+					{
+						if (pathA != pathB) return pathA > pathB;
+						if (deltaA != deltaB) return deltaA < deltaB;
+					}
+					// 其他都相同时保持添加顺序
+					return a->index < b->index;
+				};
+			auto bestIt = std::min_element(ready.begin(), ready.end(), better);
+			auto pass = *bestIt;
+			ready.erase(bestIt);
+			_passOrder.push_back(pass);
+
+			for (auto resEdge : getUniqueInputs(pass))
+			{
+				auto it = pendingConsumers.find(resEdge);
+				if (it != pendingConsumers.end() && it->second > 0)
+					it->second--;
+			}
+			for (auto successor : successors[pass])
+			{
+				if (--inDegree[successor] == 0)
+					ready.push_back(successor);
 			}
 		}
-	}
 
-	inline static bool isDepthFormat(Format format)
-	{
-		return format == Format::D16Unorm || format == Format::D24UnormS8Uint || format == Format::D32Sfloat;
+		std::string str;
+		for (auto pass : _passOrder)
+		{
+			str.append(pass->name);
+			if (pass != _passOrder.back())
+				str.append(", ");
+		}
+		spdlog::info("render graph {} - pass order = [{}]", name, str);
 	}
 
-	void RenderGraph::_autoSetTextureUsage()
+	void RenderGraph::_assignQueues()
 	{
-		for (auto& texturePair : _registry._texturesMap)
+		for (auto pass : _passes)
 		{
-			auto resEdge = _getResourceEdge(texturePair.first);
-			auto& [textureDesc, _, texture, __] = texturePair.second;
-			if (texture)	continue;
+			pass->queue = CommandListType::General;
+		}
 
-			for (const auto& consumer : resEdge->consumers)
+		// 设备没有独立队列时会返回主队列
+		auto generalQueue = _device->getCommandQueue(CommandListType::General);
+		const bool hasComputeQueue = _asyncQueues && _device->getCommandQueue(CommandListType::Compute) != generalQueue;
+		const bool hasCopyQueue = _asyncQueues && _device->getCommandQueue(CommandListType::Copy) != generalQueue;
+		if (!hasComputeQueue && !hasCopyQueue) return;
+
+		// 祖先集合，没有祖先关系的两个Pass可以并行
+		std::unordered_map<RenderGraphPassNode*, std::unordered_set<RenderGraphPassNode*>> ancestors;
+		for (auto& passesTask : _passesTasks)
+		{
+			for (auto pass : passesTask)
 			{
-				if (consumer->type == RenderGraphPassType::Copy)
-					textureDesc.usage |= TextureUsage::CopySrc;
-				else if (resEdge->isUAV)
-					textureDesc.usage |= TextureUsage::Storage;
-				else
-					textureDesc.usage |= TextureUsage::Sampled;
+				auto& passAncestors = ancestors[pass];
+				for (auto dependency : pass->dependencies)
+				{
+					passAncestors.insert(dependency);
+					passAncestors.insert(ancestors[dependency].begin(), ancestors[dependency].end());
+				}
 			}
+		}
 
-			if (resEdge->producer->type == RenderGraphPassType::Raster ||
-				resEdge->producer->type == RenderGraphPassType::FrameRaster)
+		// 外部资源由调用者在主队列使用，历史贴图跨帧读取，也不转移所有权
+		auto isImported = [this](RenderGraphResourceEdge* resEdge)
 			{
-				if (isDepthFormat(textureDesc.format))
-					textureDesc.usage |= TextureUsage::DepthStencilAttachment;
-				else
-					textureDesc.usage |= TextureUsage::ColorAttachment;
+				return _registry._importTexturesMap.contains(resEdge->handle) || _registry._importBuffersMap.contains(resEdge->handle) ||
+					_registry._historyTexturesMap.contains(resEdge->handle) || _registry._historySourcesMap.contains(resEdge->handle);
+			};
+		for (auto& passesTask : _passesTasks)
+		{
+			for (auto pass : passesTask)
+			{
+				CommandListType queue = CommandListType::General;
+				if (hasComputeQueue && (pass->type == RenderGraphPassType::Compute || pass->type == RenderGraphPassType::FrameCompute))
+					queue = CommandListType::Compute;
+				else if (hasCopyQueue && pass->type == RenderGraphPassType::Copy)
+					queue = CommandListType::Copy;
+				if (queue == CommandListType::General) continue;
+
+				if (std::any_of(pass->inputs.begin(), pass->inputs.end(), isImported) ||
+					std::any_of(pass->outputs.begin(), pass->outputs.end(), isImported))
+					continue;
+
+				// 能和光栅Pass重叠执行才值得放到异步队列
+				for (const auto& [other, otherAncestors] : ancestors)
+				{
+					if ((other->type == RenderGraphPassType::Raster || other->type == RenderGraphPassType::FrameRaster) &&
+						!ancestors[pass].contains(other) && !otherAncestors.contains(pass))
+					{
+						pass->queue = queue;
+						break;
+					}
+				}
 			}
-			if (resEdge->producer->type == RenderGraphPassType::Copy)
+		}
+
+		// 缓冲没有屏障接口不跨队列使用。贴图所有权按整个贴图转移，多个Pass写入或按范围读写的贴图也不跨队列使用
+		auto isRangeAccessed = [](RenderGraphResourceEdge* resEdge)
 			{
-				textureDesc.usage |= TextureUsage::CopyDst;
+				auto isPartial = [resEdge](const std::vector<RenderGraphResourceEdge*>& resEdges, const std::vector<TextureViewDesc>& ranges)
+					{
+						for (size_t i = 0; i < resEdges.size(); ++i)
+						{
+							if (resEdges[i] == resEdge && !isAllSubresources(ranges[i]))
+								return true;
+						}
+						return false;
+					};
+				return std::any_of(resEdge->producers.begin(), resEdge->producers.end(),
+					[&](RenderGraphPassNode* producer) { return isPartial(producer->outputs, producer->outputRanges); }) ||
+					std::any_of(resEdge->consumers.begin(), resEdge->consumers.end(),
+					[&](RenderGraphPassNode* consumer) { return isPartial(consumer->inputs, consumer->inputRanges); });
+			};
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			for (const auto& [handle, resEdge] : _resourceEdgesMap)
+			{
+				auto producer = resEdge->producer;
+				if (!producer || producer->isCulled) continue;
+				if (!_registry._buffersMap.contains(handle) && resEdge->producers.size() < 2 && !isRangeAccessed(resEdge)) continue;
+
+				std::vector<RenderGraphPassNode*> users = resEdge->producers;
+				users.insert(users.end(), resEdge->consumers.begin(), resEdge->consumers.end());
+				for (auto user : users)
+				{
+					if (user->isCulled || user->queue == producer->queue) continue;
+					if (user->queue != CommandListType::General)
+						user->queue = CommandListType::General;
+					else
+						producer->queue = CommandListType::General;
+					changed = true;
+				}
 			}
 		}
 	}
 
-	void RenderGraph::_autoTransitionTextureState(RenderGraphPassNode* pass, std::shared_ptr<CommandList> commandList)
+	void RenderGraph::_genSubmitBatches()
 	{
-		for (auto inputResEdge : pass->inputs)
+		// 旧的命令列表可能还在使用
+		_waitSubmitBatches();
+		_submitBatches.clear();
+		_recordUnits.clear();
+
+		// 贴图按读取顺序在队列间转移所有权，转移的两侧需要额外等待
+		std::unordered_map<RenderGraphPassNode*, uint32_t> passOrders;
+		for (auto pass : _passOrder)
+			passOrders[pass] = (uint32_t)passOrders.size();
+		std::unordered_map<RenderGraphPassNode*, std::vector<RenderGraphPassNode*>> transferWaits;
+		std::unordered_map<RenderGraphPassNode*, std::vector<RenderGraphQueueTransfer>> passReleases;
+		std::unordered_map<RenderGraphPassNode*, std::vector<RenderGraphQueueTransfer>> passAcquires;
+		for (const auto& [handle, resEdge] : _resourceEdgesMap)
 		{
-			const auto& [texture, textureView] = _registry.getTexture(inputResEdge->handle);
-			if (texture)
+			if (!resEdge->producer || resEdge->producer->isCulled || !_registry._texturesMap.contains(handle)) continue;
+
+			std::vector<RenderGraphPassNode*> consumers;
+			for (auto consumer : resEdge->consumers)
+			{
+				if (!consumer->isCulled && std::find(consumers.begin(), consumers.end(), consumer) == consumers.end())
+					consumers.push_back(consumer);
+			}
+			std::sort(consumers.begin(), consumers.end(), [&](auto a, auto b) { return passOrders[a] < passOrders[b]; });
+
+			auto lastUser = resEdge->producer;
+			for (auto consumer : consumers)
 			{
-				TextureState newState = TextureState::ShaderRead;
-				if (isDepthFormat(texture->getFormat()))
+				if (consumer->queue != lastUser->queue)
 				{
-					newState = TextureState::DepthStencilRead;
+					RenderGraphQueueTransfer transfer = { resEdge, lastUser->queue, consumer->queue, consumer };
+					passReleases[lastUser].push_back(transfer);
+					passAcquires[consumer].push_back(transfer);
+					transferWaits[consumer].push_back(lastUser);
 				}
-				if (pass->type == RenderGraphPassType::Compute || pass->type == RenderGraphPassType::FrameCompute)
+				lastUser = consumer;
+			}
+		}
+
+		std::unordered_map<RenderGraphPassNode*, uint32_t> passBatches;
+		// 每个队列还能追加Pass的批次
+		std::unordered_map<CommandListType, uint32_t> openBatches;
+		// 队列已经等待过的其他队列批次，值为批次索引加一
+		std::map<std::pair<CommandListType, CommandListType>, uint32_t> waitedBatches;
+		for (auto pass : _passOrder)
+		{
+			const auto queue = pass->queue;
+
+			// 依赖其他队列的Pass新开批次，批次开头等待
+			std::vector<uint32_t> waits;
+			auto dependencies = pass->dependencies;
+			dependencies.insert(dependencies.end(), transferWaits[pass].begin(), transferWaits[pass].end());
+			for (auto dependency : dependencies)
+			{
+				if (dependency->queue == queue) continue;
+				uint32_t dependencyBatch = passBatches[dependency];
+				auto& waited = waitedBatches[{ queue, dependency->queue }];
+				if (waited > dependencyBatch) continue;
+				waited = dependencyBatch + 1;
+				waits.push_back(dependencyBatch);
+			}
+			if (!openBatches.contains(queue) || !waits.empty())
+			{
+				openBatches[queue] = (uint32_t)_submitBatches.size();
+				_submitBatches.push_back({ .queue = queue });
+			}
+			const uint32_t batchIndex = openBatches[queue];
+			for (auto wait : waits)
+			{
+				_submitBatches[wait].signal = true;
+			}
+			auto& batch = _submitBatches[batchIndex];
+			batch.waits.insert(batch.waits.end(), waits.begin(), waits.end());
+			batch.passes.push_back(pass);
+			passBatches[pass] = batchIndex;
+
+			batch.acquires.insert(batch.acquires.end(), passAcquires[pass].begin(), passAcquires[pass].end());
+			batch.releases.insert(batch.releases.end(), passReleases[pass].begin(), passReleases[pass].end());
+
+			// 输出被其他队列读取或释放所有权时结束批次，让其他队列尽早开始
+			bool crossQueue = !passReleases[pass].empty();
+			for (auto output : pass->outputs)
+			{
+				for (auto consumer : output->consumers)
 				{
-					newState = TextureState::General;
+					if (!consumer->isCulled && consumer->queue != queue)
+						crossQueue = true;
 				}
-				else if (pass->type == RenderGraphPassType::Copy)
+			}
+			if (crossQueue)
+			{
+				openBatches.erase(queue);
+			}
+		}
+
+		// 每个队列最后一个批次发出信号，用于汇合和复用命令列表
+		std::unordered_set<CommandListType> lastBatchQueues;
+		for (auto it = _submitBatches.rbegin(); it != _submitBatches.rend(); ++it)
+		{
+			if (lastBatchQueues.insert(it->queue).second)
+				it->signal = true;
+		}
+
+		std::unordered_map<CommandListType, uint32_t> signalCounts;
+		for (auto& batch : _submitBatches)
+		{
+			if (batch.signal)
+				batch.signalIndex = signalCounts[batch.queue]++;
+			if (!_queueFences.contains(batch.queue))
+			{
+				_queueFences[batch.queue] = _device->createFence(0);
+				_queueFenceValues[batch.queue] = 0;
+			}
+		}
+
+		// 资源生命周期按批次之间的先后判断，同一队列前面的批次和等待过的批次一定先完成
+		_passBatchIndices.clear();
+		_passOrderIndices.clear();
+		_batchPredecessors.assign(_submitBatches.size(), std::vector<bool>(_submitBatches.size(), false));
+		_batchesKey = 0;
+		std::unordered_map<CommandListType, uint32_t> lastQueueBatches;
+		// 批次按依赖顺序排列，最早开始的层级在直接前驱之后，每个Pass占一层
+		std::vector<std::vector<uint32_t>> directPredecessors(_submitBatches.size());
+		std::vector<uint32_t> earliestLevels(_submitBatches.size(), 0);
+		uint32_t levelCount = 0;
+		for (uint32_t i = 0; i < _submitBatches.size(); ++i)
+		{
+			const auto& batch = _submitBatches[i];
+			auto& predecessors = _batchPredecessors[i];
+			auto addPredecessor = [&](uint32_t predecessor)
 				{
-					newState = TextureState::CopySrc;
+					directPredecessors[i].push_back(predecessor);
+					earliestLevels[i] = std::max(earliestLevels[i], earliestLevels[predecessor] + (uint32_t)_submitBatches[predecessor].passes.size());
+					predecessors[predecessor] = true;
+					for (uint32_t j = 0; j < predecessor; ++j)
+					{
+						if (_batchPredecessors[predecessor][j])
+							predecessors[j] = true;
+					}
+				};
+			if (auto it = lastQueueBatches.find(batch.queue); it != lastQueueBatches.end())
+				addPredecessor(it->second);
+			for (auto wait : batch.waits)
+				addPredecessor(wait);
+			lastQueueBatches[batch.queue] = i;
+			levelCount = std::max(levelCount, earliestLevels[i] + (uint32_t)batch.passes.size());
+
+			HashCombine(_batchesKey, batch.queue);
+			for (auto pass : batch.passes)
+			{
+				_passBatchIndices[pass] = i;
+				HashCombine(_batchesKey, pass->index);
+			}
+			for (auto wait : batch.waits)
+				HashCombine(_batchesKey, wait);
+		}
+		for (auto pass : _passOrder)
+			_passOrderIndices[pass] = (uint32_t)_passOrderIndices.size();
+
+		// 最晚开始的层级在所有后继之前
+		std::vector<uint32_t> latestLevels(_submitBatches.size());
+		for (uint32_t i = 0; i < _submitBatches.size(); ++i)
+			latestLevels[i] = levelCount - (uint32_t)_submitBatches[i].passes.size();
+		for (uint32_t i = (uint32_t)_submitBatches.size(); i-- > 0;)
+		{
+			for (auto predecessor : directPredecessors[i])
+				latestLevels[predecessor] = std::min(latestLevels[predecessor], latestLevels[i] - (uint32_t)_submitBatches[predecessor].passes.size());
+		}
+		_passDependencyLevels.clear();
+		for (uint32_t i = 0; i < _submitBatches.size(); ++i)
+		{
+			const auto& passes = _submitBatches[i].passes;
+			for (uint32_t j = 0; j < passes.size(); ++j)
+				_passDependencyLevels[passes[j]] = { earliestLevels[i] + j, latestLevels[i] + j };
+		}
+
+		// 上次编译的命令列表已经执行完毕，重新开始轮换
+		_frameSlot = 0;
+		// 同时在GPU上的帧之外还有一组正在录制
+		_frameSlotFenceValues.assign(_registry._historyVersions, {});
+
+		// 按录制方式把批次拆成录制单元，每个单元一个命令列表
+		// 按层级录制时，执行顺序里相邻的同层Pass合并
+		std::unordered_map<RenderGraphPassNode*, uint32_t> passLevels;
+		for (uint32_t i = 0; i < _passesTasks.size(); ++i)
+		{
+			for (auto pass : _passesTasks[i])
+				passLevels[pass] = i;
+		}
+		for (uint32_t i = 0; i < _submitBatches.size(); ++i)
+		{
+			for (auto pass : _submitBatches[i].passes)
+			{
+				bool newUnit = _recordUnits.empty() || _recordUnits.back().batchIndex != i ||
+					_recordMode == RenderGraphRecordMode::ParallelPass ||
+					(_recordMode == RenderGraphRecordMode::ParallelLevel && passLevels[_recordUnits.back().passes.back()] != passLevels[pass]);
+				if (newUnit)
+				{
+					auto& unit = _recordUnits.emplace_back();
+					unit.batchIndex = i;
+					for (uint32_t j = 0; j < _registry._historyVersions; ++j)
+						unit.commandLists.push_back(_device->createCommandList(_submitBatches[i].queue));
 				}
-				commandList->resourceBarrier({ texture, texture->getState(), newState });
+				_recordUnits.back().passes.push_back(pass);
 			}
 		}
-		for (auto outputResEdge : pass->outputs)
+
+		spdlog::info("render graph {} - submit batches = [", name);
+		for (uint32_t i = 0; i < _submitBatches.size(); ++i)
 		{
-			const auto& [texture, textureView] = _registry.getTexture(outputResEdge->handle);
-			if (texture)
+			const auto& batch = _submitBatches[i];
+			std::string str = fmt::format("{}: queue {} (", i, (uint32_t)batch.queue);
+			for (auto& pass : batch.passes)
+			{
+				str.append(pass->name);
+				if (pass != batch.passes.back())
+					str.append(", ");
+			}
+			str.append(")");
+			for (auto wait : batch.waits)
+				str.append(fmt::format(" wait {}", wait));
+			if (batch.signal)
+				str.append(" signal");
+			spdlog::info("{}", str);
+		}
+		spdlog::info("]");
+	}
+
+	void RenderGraph::_waitSubmitBatches()
+	{
+		for (const auto& [queueType, queueFence] : _queueFences)
+		{
+			queueFence->wait(_queueFenceValues[queueType]);
+		}
+	}
+
+	void RenderGraph::_waitQueuesIdle()
+	{
+		_waitSubmitBatches();
+		for (auto type : { CommandListType::General, CommandListType::Compute, CommandListType::Copy })
+			_device->getCommandQueue(type)->waitIdle();
+	}
+
+	bool RenderGraph::_isPassBefore(const RenderGraphPassNode* a, const RenderGraphPassNode* b) const
+	{
+		// 单个命令列表执行时按执行顺序，多队列执行时还要求批次之间有先后
+		if (_passOrderIndices.at(a) >= _passOrderIndices.at(b))
+			return false;
+		const uint32_t batchA = _passBatchIndices.at(a);
+		const uint32_t batchB = _passBatchIndices.at(b);
+		return batchA == batchB || _batchPredecessors[batchB][batchA];
+	}
+
+	bool RenderGraph::_isResourceBefore(const RenderGraphResourceEdge* a, const RenderGraphResourceEdge* b) const
+	{
+		auto forEachUser = [](const RenderGraphResourceEdge* resEdge, auto&& func)
 			{
-				TextureState newState = TextureState::ColorAttachment;
-				if (isDepthFormat(texture->getFormat()))
+				for (auto pass : resEdge->producers)
 				{
-					newState = TextureState::DepthStencilWrite;
+					if (!pass->isCulled && !func(pass)) return false;
 				}
-				if (pass->type == RenderGraphPassType::Compute || pass->type == RenderGraphPassType::FrameCompute)
+				for (auto pass : resEdge->consumers)
 				{
-					newState = TextureState::General;
+					if (!pass->isCulled && !func(pass)) return false;
 				}
-				else if (pass->type == RenderGraphPassType::Copy)
+				return true;
+			};
+		return forEachUser(a, [&](const RenderGraphPassNode* userA)
+			{
+				return forEachUser(b, [&](const RenderGraphPassNode* userB) { return _isPassBefore(userA, userB); });
+			});
+	}
+
+	void RenderGraph::_allocResources()
+	{
+		for (auto& _passesTask : _passesTasks)
+		{
+			for (auto& pass : _passesTask)
+			{
+				for (auto resEdge : pass->outputs)
 				{
-					newState = TextureState::CopyDst;
+					if (_registry._buffersMap.contains(resEdge->handle))
+					{
+						auto& [bufferDesc, buffer] = _registry._buffersMap[resEdge->handle];
+						if (buffer || canPlaceBuffer(bufferDesc))	continue;
+
+						buffer = _resourcePool ? _resourcePool->acquireBuffer(bufferDesc) : _device->createBuffer(bufferDesc);
+						spdlog::debug("render graph {} create buffer {}", name, resEdge->name);
+					}
 				}
-				commandList->resourceBarrier({ texture, texture->getState(), newState });
+			}
+		}
+	}
+
+	void RenderGraph::_allocMemory()
+	{
+		// 与上次编译结果对比，描述和生命周期都没变的资源固定在原位置
+		std::vector<RenderGraphResource> releaseTextures;
+		std::vector<RenderGraphResource> releaseBuffers;
+		_memoryPlanner.clear();
+		// 不同队列的Pass会同时执行，task区间不重叠的资源也可能同时存活，按批次的先后判断
+		_memoryPlanner.setOverlapTest([this](const RenderGraphMemoryPlanner::Allocation& a, const RenderGraphMemoryPlanner::Allocation& b)
+			{
+				auto resEdgeA = _getResourceEdge(a.handle);
+				auto resEdgeB = _getResourceEdge(b.handle);
+				return !_isResourceBefore(resEdgeA, resEdgeB) && !_isResourceBefore(resEdgeB, resEdgeA);
+			});
+		const bool keepPlacements = _batchesKey == _compiledBatchesKey;
+		_compiledBatchesKey = _batchesKey;
+		// 从零开始布置内存时，可以直接使用缓存里同一分辨率的放置
+		const bool useCachedPlacements = _compileCacheHit && !_memory &&
+			_compileCache._width == _width && _compileCache._height == _height;
+		bool allCachedPlacements = useCachedPlacements;
+		auto addResource = [&](RenderGraphResource handle, const AllocateInfo& allocateInfo, uint32_t firstUseTask, uint32_t lastUseTask)
+			{
+				auto placement = useCachedPlacements ? _compileCache._findPlacement(handle) : nullptr;
+				if (placement && placement->size == allocateInfo.size)
+				{
+					_memoryPlanner.addPlacedResource(handle, allocateInfo, firstUseTask, lastUseTask, placement->offset);
+				}
+				else
+				{
+					allCachedPlacements = false;
+					_memoryPlanner.addResource(handle, allocateInfo, firstUseTask, lastUseTask);
+				}
+			};
+		for (auto& pair : _registry._texturesMap)
+		{
+			if (_registry._historyTexturesMap.contains(pair.first)) continue;
+
+			auto& [declaredDesc, size, texture, textureView] = pair.second;
+			auto resEdge = _getResourceEdge(pair.first);
+			if (!resEdge || !resEdge->producer || resEdge->producer->isCulled)
+			{
+				releaseTextures.push_back(pair.first);
+				_compiledTextures.erase(pair.first);
+				continue;
+			}
+
+			// 注册表保留声明时的描述，编译后的描述另外记录
+			TextureDesc textureDesc = declaredDesc;
+			if (resEdge->producer->type == RenderGraphPassType::FrameRaster ||
+				resEdge->producer->type == RenderGraphPassType::FrameCompute)
+			{
+				textureDesc.width = _width;
+				textureDesc.height = _height;
+			}
+			auto usageIt = _compileCache._usages.find(pair.first);
+			if (_compileCacheHit && usageIt != _compileCache._usages.end())
+			{
+				textureDesc.usage = usageIt->second;
+			}
+			else
+			{
+				_autoSetTextureUsage(resEdge, textureDesc);
+				_compileCache._usages[pair.first] = textureDesc.usage;
+			}
+
+			AllocateInfo allocateInfo = _getTextureAllocateInfo(textureDesc);
+			size = allocateInfo.size;
+			const auto& lifecycle = resEdge->lifecycle;
+			auto it = _compiledTextures.find(pair.first);
+			if (keepPlacements && texture && it != _compiledTextures.end() && isSameTextureDesc(it->second.desc, textureDesc) &&
+				it->second.firstUseTask == lifecycle.firstUseTask && it->second.lastUseTask == lifecycle.lastUseTask)
+			{
+				_memoryPlanner.addPlacedResource(pair.first, allocateInfo, lifecycle.firstUseTask, lifecycle.lastUseTask, it->second.offset);
+			}
+			else
+			{
+				releaseTextures.push_back(pair.first);
+				addResource(pair.first, allocateInfo, lifecycle.firstUseTask, lifecycle.lastUseTask);
+				_compiledTextures[pair.first] = { textureDesc, lifecycle.firstUseTask, lifecycle.lastUseTask };
+			}
+		}
+
+		// 临时buffer和贴图一起规划，只在几个Pass之间使用的大buffer不再占用整帧的内存
+		for (auto& [handle, tuple] : _registry._buffersMap)
+		{
+			auto& [bufferDesc, buffer] = tuple;
+			if (!canPlaceBuffer(bufferDesc)) continue;
+
+			auto resEdge = _getResourceEdge(handle);
+			if (!resEdge || !resEdge->producer || resEdge->producer->isCulled)
+			{
+				releaseBuffers.push_back(handle);
+				_compiledBuffers.erase(handle);
+				continue;
+			}
+
+			const auto& lifecycle = resEdge->lifecycle;
+			auto it = _compiledBuffers.find(handle);
+			if (it == _compiledBuffers.end())
+			{
+				it = _compiledBuffers.emplace(handle, CompiledBuffer{ .allocateInfo = _device->getBufferAllocateInfo(bufferDesc) }).first;
+			}
+			else if (keepPlacements && buffer && it->second.firstUseTask == lifecycle.firstUseTask && it->second.lastUseTask == lifecycle.lastUseTask)
+			{
+				_memoryPlanner.addPlacedResource(handle, it->second.allocateInfo, lifecycle.firstUseTask, lifecycle.lastUseTask, it->second.offset);
+				continue;
+			}
+			releaseBuffers.push_back(handle);
+			addResource(handle, it->second.allocateInfo, lifecycle.firstUseTask, lifecycle.lastUseTask);
+			it->second.firstUseTask = lifecycle.firstUseTask;
+			it->second.lastUseTask = lifecycle.lastUseTask;
+		}
+		_memoryPlanner.setBufferImageGranularity(_device->getBufferImageGranularity());
+		_memoryPlanner.plan(_aliasingStrategy);
+
+		// 内存不够、浪费过半或内存类型不被所有资源支持时重新分配，所有资源重建
+		const size_t memorySize = _memory ? _memory->getDesc().size : 0;
+		const uint32_t memoryTypeBits = _memory ? _memory->getDesc().memoryTypeBits : UINT32_MAX;
+		const bool reallocMemory = _memoryPlanner.getPeakSize() > memorySize || _memoryPlanner.getPeakSize() * 2 < memorySize ||
+			(memoryTypeBits & ~_memoryPlanner.getMemoryTypeBits()) != 0;
+		if (reallocMemory)
+		{
+			for (const auto& pair : _compiledTextures)
+				releaseTextures.push_back(pair.first);
+			for (const auto& pair : _compiledBuffers)
+				releaseBuffers.push_back(pair.first);
+			// 缓存的放置已经是上次完整规划的结果
+			_memoryPlanner.plan(_aliasingStrategy, allCachedPlacements);
+		}
+
+		_compileCache._width = _width;
+		_compileCache._height = _height;
+		_compileCache._placements.clear();
+		for (const auto& allocation : _memoryPlanner.getAllocations())
+			_compileCache._placements.push_back({ allocation.handle, allocation.size, allocation.offset });
+
+		// 释放的资源可能还在GPU上使用
+		bool inFlight = false;
+		for (auto handle : releaseTextures)
+			inFlight |= std::get<2>(_registry._texturesMap[handle]) != nullptr;
+		for (auto handle : releaseBuffers)
+			inFlight |= std::get<1>(_registry._buffersMap[handle]) != nullptr;
+		if (inFlight)
+			_waitQueuesIdle();
+		for (auto handle : releaseTextures)
+		{
+			auto& [_, __, texture, textureView] = _registry._texturesMap[handle];
+			// 重建的贴图没有内容，不属于任何队列
+			_textureOwners.erase(handle);
+			textureView.reset();
+			if (_resourcePool)
+				_resourcePool->releaseTexture(texture);
+			texture.reset();
+		}
+		for (auto handle : releaseBuffers)
+			std::get<1>(_registry._buffersMap[handle]).reset();
+
+		if (reallocMemory)
+		{
+			if (_resourcePool)
+				_resourcePool->releaseMemory(_memory);
+			_memory.reset();
+			if (_memoryPlanner.getPeakSize() > 0)
+			{
+				const uint32_t memoryTypeBits = _memoryPlanner.getMemoryTypeBits();
+				if (memoryTypeBits == 0)
+					spdlog::error("render graph {} has no memory type supported by all placed resources", name);
+				_memory = _resourcePool ? _resourcePool->acquireMemory(_memoryPlanner.getPeakSize(), name, memoryTypeBits) :
+					_device->createMemory({ .size = _memoryPlanner.getPeakSize(), .memoryTypeBits = memoryTypeBits, .name = name });
+			}
+			spdlog::info("render graph {} alloc memory size {} (without aliasing {})", name,
+				_memoryPlanner.getPeakSize(), _memoryPlanner.getTotalSize());
+		}
+	}
+
+	void RenderGraph::_createResources()
+	{
+		for (const auto& allocation : _memoryPlanner.getAllocations())
+		{
+			if (auto it = _registry._buffersMap.find(allocation.handle); it != _registry._buffersMap.end())
+			{
+				auto& [bufferDesc, buffer] = it->second;
+				if (buffer) continue;
+
+				_compiledBuffers[allocation.handle].offset = allocation.offset;
+				buffer = _device->createBuffer(bufferDesc, _memory, allocation.offset);
+				spdlog::debug("render graph {} create buffer {} at offset {} tasks [{}, {}]", name, bufferDesc.name,
+					allocation.offset, allocation.firstUseTask, allocation.lastUseTask);
+				continue;
+			}
+
+			auto& [_, size, texture, textureView] = _registry._texturesMap[allocation.handle];
+			if (texture) continue;
+
+			auto resEdge = _getResourceEdge(allocation.handle);
+			auto& compiledTexture = _compiledTextures[allocation.handle];
+			compiledTexture.offset = allocation.offset;
+			texture = _resourcePool ? _resourcePool->acquireTexture(compiledTexture.desc, _memory, allocation.offset) :
+				_device->createTexture(compiledTexture.desc, _memory, allocation.offset);
+			textureView = texture->createView({});
+			spdlog::debug("render graph {} create texture {} at offset {} tasks [{}, {}]", name, resEdge->name,
+				allocation.offset, allocation.firstUseTask, allocation.lastUseTask);
+		}
+
+		// 内存区间重叠的资源生命周期不重叠，首次访问时要等待前一个资源的访问完成
+		_barrierTracker.clearAliases();
+		const auto& allocations = _memoryPlanner.getAllocations();
+		for (const auto& allocation : allocations)
+		{
+			std::vector<std::shared_ptr<Texture>> textureAliases;
+			std::vector<std::shared_ptr<Buffer>> bufferAliases;
+			for (const auto& other : allocations)
+			{
+				if (&other == &allocation) continue;
+				if (other.offset >= allocation.offset + allocation.size || allocation.offset >= other.offset + other.size) continue;
+				if (auto buffer = _registry.getBuffer(other.handle))
+					bufferAliases.push_back(buffer);
+				else
+					textureAliases.push_back(std::get<2>(_registry._texturesMap[other.handle]));
+			}
+			if (textureAliases.empty() && bufferAliases.empty()) continue;
+			if (auto buffer = _registry.getBuffer(allocation.handle))
+				_barrierTracker.setAliases(buffer, textureAliases, bufferAliases);
+			else
+				_barrierTracker.setAliases(std::get<2>(_registry._texturesMap[allocation.handle]), textureAliases, bufferAliases);
+		}
+	}
+
+	void RenderGraph::_allocHistoryTextures()
+	{
+		std::vector<std::tuple<RenderGraphRegistry::HistoryTexture*, TextureDesc, uint32_t>> reallocHistories;
+		bool inFlight = false;
+		for (auto& [handle, history] : _registry._historyTexturesMap)
+		{
+			auto resEdge = _getResourceEdge(handle);
+			TextureDesc textureDesc = std::get<0>(_registry._texturesMap[handle]);
+			// 写入Pass被裁剪时不再需要历史
+			uint32_t versionCount = 0;
+			if (resEdge->producer && !resEdge->producer->isCulled)
+			{
+				if (resEdge->producer->type == RenderGraphPassType::FrameRaster ||
+					resEdge->producer->type == RenderGraphPassType::FrameCompute)
+				{
+					textureDesc.width = _width;
+					textureDesc.height = _height;
+				}
+				_autoSetTextureUsage(resEdge, textureDesc);
+				_autoSetTextureUsage(_getResourceEdge(history.handle), textureDesc);
+				versionCount = _registry._historyVersions;
+			}
+
+			if (history.versions.size() == versionCount && (versionCount == 0 || isSameTextureDesc(history.desc, textureDesc))) continue;
+			inFlight |= !history.versions.empty();
+			reallocHistories.emplace_back(&history, textureDesc, versionCount);
+		}
+
+		// 旧版本可能还在GPU上使用
+		if (inFlight)
+			_waitQueuesIdle();
+		for (auto& [history, textureDesc, versionCount] : reallocHistories)
+		{
+			history->versions.clear();
+			history->desc = textureDesc;
+			history->valid = false;
+			for (uint32_t i = 0; i < versionCount; ++i)
+			{
+				auto texture = _device->createTexture(textureDesc);
+				history->versions.emplace_back(texture, texture->createView({}));
+			}
+			spdlog::debug("render graph {} create history texture {} versions {}", name, textureDesc.name, versionCount);
+		}
+	}
+
+	void RenderGraph::_createRangeViews(RenderGraphResource handle)
+	{
+		if (!handle)
+			_registry._rangeViewsMap.clear();
+
+		auto createView = [this](RenderGraphResource resource, const TextureViewDesc& range)
+			{
+				if (isAllSubresources(range) || _registry.getBuffer(resource)) return;
+
+				// 历史贴图轮换使用每个版本
+				std::vector<std::shared_ptr<Texture>> textures;
+				RenderGraphResource source = resource;
+				if (auto it = _registry._historySourcesMap.find(resource); it != _registry._historySourcesMap.end())
+					source = it->second;
+				if (auto it = _registry._historyTexturesMap.find(source); it != _registry._historyTexturesMap.end())
+				{
+					for (const auto& version : it->second.versions)
+						textures.push_back(std::get<0>(version));
+				}
+				else
+				{
+					textures.push_back(std::get<0>(_registry.getTexture(resource)));
+				}
+
+				for (const auto& texture : textures)
+				{
+					if (!texture) continue;
+					auto& rangeViews = _registry._rangeViewsMap[texture.get()];
+					if (rangeViews.texture.lock() != texture)
+					{
+						rangeViews.texture = texture;
+						rangeViews.views.clear();
+					}
+					auto& views = rangeViews.views;
+					if (std::any_of(views.begin(), views.end(), [&range](const auto& view) { return isSameSubresourceRange(std::get<0>(view), range); }))
+						continue;
+					views.emplace_back(range, texture->createView(range));
+				}
+			};
+		for (auto pass : _passes)
+		{
+			if (pass->isCulled) continue;
+			for (size_t i = 0; i < pass->inputs.size(); ++i)
+			{
+				if (!handle || pass->inputs[i]->handle == handle)
+					createView(pass->inputs[i]->handle, pass->inputRanges[i]);
+			}
+			for (size_t i = 0; i < pass->outputs.size(); ++i)
+			{
+				if (!handle || pass->outputs[i]->handle == handle)
+					createView(pass->outputs[i]->handle, pass->outputRanges[i]);
+			}
+		}
+	}
+
+	void RenderGraph::_releaseResources()
+	{
+		// 资源归还到池或直接销毁，池会等GPU用完再回收
+		for (auto& [handle, tuple] : _registry._texturesMap)
+		{
+			auto& [_, __, texture, textureView] = tuple;
+			textureView.reset();
+			if (_resourcePool)
+				_resourcePool->releaseTexture(texture);
+			texture.reset();
+		}
+		for (auto& [handle, tuple] : _registry._buffersMap)
+		{
+			auto& [bufferDesc, buffer] = tuple;
+			if (_resourcePool && !canPlaceBuffer(bufferDesc))
+				_resourcePool->releaseBuffer(buffer);
+			buffer.reset();
+		}
+		for (auto& [handle, history] : _registry._historyTexturesMap)
+		{
+			history.versions.clear();
+			history.valid = false;
+		}
+		if (_resourcePool)
+			_resourcePool->releaseMemory(_memory);
+		_memory.reset();
+		_compiledTextures.clear();
+		_compiledBuffers.clear();
+		_textureOwners.clear();
+		_barrierTracker.clearAliases();
+	}
+
+	void RenderGraph::_autoSetTextureUsage(RenderGraphResourceEdge* resEdge, TextureDesc& textureDesc)
+	{
+		for (const auto& consumer : resEdge->consumers)
+		{
+			if (consumer->isCulled) continue;
+
+			if (consumer->type == RenderGraphPassType::Copy)
+				textureDesc.usage |= TextureUsage::CopySrc;
+			else if (resEdge->isUAV && (consumer->type == RenderGraphPassType::Compute ||
+				consumer->type == RenderGraphPassType::FrameCompute))
+				textureDesc.usage |= TextureUsage::Storage;
+			else
+				textureDesc.usage |= TextureUsage::Sampled;
+		}
+
+		// 多个Pass写入时合并所有写入方式
+		for (const auto& producer : resEdge->producers)
+		{
+			if (producer->isCulled) continue;
+
+			if (producer->type == RenderGraphPassType::Raster ||
+				producer->type == RenderGraphPassType::FrameRaster)
+			{
+				if (isDepthFormat(textureDesc.format))
+					textureDesc.usage |= TextureUsage::DepthStencilAttachment;
+				else
+					textureDesc.usage |= TextureUsage::ColorAttachment;
+			}
+			else if (producer->type == RenderGraphPassType::Copy)
+				textureDesc.usage |= TextureUsage::CopyDst;
+			// 只有以UAV写入才需要Storage，其他写入方式由创建时的用途决定
+			else if (resEdge->isUAV)
+				textureDesc.usage |= TextureUsage::Storage;
+		}
+	}
+
+	AllocateInfo RenderGraph::_getTextureAllocateInfo(const TextureDesc& textureDesc)
+	{
+		if (auto allocateInfo = _compileCache._findAllocateInfo(textureDesc))
+			return *allocateInfo;
+
+		AllocateInfo allocateInfo = _device->getTextureAllocateInfo(textureDesc);
+		_compileCache._addAllocateInfo(textureDesc, allocateInfo);
+		return allocateInfo;
+	}
+
+	void RenderGraph::_inferAttachmentOps()
+	{
+		std::unordered_map<RenderGraphPassNode*, uint32_t> passOrders;
+		for (auto pass : _passOrder)
+			passOrders[pass] = (uint32_t)passOrders.size();
+
+		for (auto pass : _passes)
+		{
+			if (pass->isCulled) continue;
+
+			auto inferOps = [this, pass, &passOrders](RenderGraphAttachment& attachment)
+				{
+					if (!attachment.resource) return;
+					auto resEdge = _getResourceEdge(attachment.resource);
+					// 渲染图创建的贴图在第一个写入Pass之前没有内容
+					const bool isCreated = _registry._texturesMap.contains(attachment.resource);
+					const bool isFirstWrite = std::none_of(resEdge->producers.begin(), resEdge->producers.end(),
+						[&](RenderGraphPassNode* producer) { return !producer->isCulled && passOrders[producer] < passOrders[pass]; });
+					attachment.inferredLoadOp = (isCreated && isFirstWrite && attachment.loadOp == LoadOp::Load) ? LoadOp::DontCare : attachment.loadOp;
+
+					// 外部资源和历史贴图的内容在渲染图之外使用，之后写入的Pass可能加载内容
+					bool needStore = !isCreated || _registry._historyTexturesMap.contains(attachment.resource);
+					for (auto consumer : resEdge->consumers)
+						needStore |= !consumer->isCulled;
+					for (auto producer : resEdge->producers)
+						needStore |= !producer->isCulled && passOrders[producer] > passOrders[pass];
+					attachment.inferredStoreOp = needStore ? StoreOp::Store : StoreOp::DontCare;
+				};
+			for (auto& attachment : pass->colorAttachments)
+				inferOps(attachment);
+			inferOps(pass->depthAttachment);
+		}
+	}
+
+	RenderPassDesc RenderGraph::_getRenderPassDesc(const RenderGraphPassNode* firstPass, const RenderGraphPassNode* lastPass) const
+	{
+		RenderPassDesc desc;
+		for (size_t i = 0; i < firstPass->colorAttachments.size(); ++i)
+		{
+			const auto& attachment = firstPass->colorAttachments[i];
+			desc.colorAttachments.push_back({
+				.textureView = std::get<1>(_registry.getTexture(attachment.resource)),
+				.loadOp = attachment.inferredLoadOp,
+				.storeOp = lastPass->colorAttachments[i].inferredStoreOp,
+				.clearValue = attachment.clearColor
+				});
+		}
+
+		const auto& depth = firstPass->depthAttachment;
+		if (depth.resource)
+		{
+			const auto& [texture, textureView] = _registry.getTexture(depth.resource);
+			const Format format = texture->getFormat();
+			const StoreOp storeOp = lastPass->depthAttachment.inferredStoreOp;
+			if (format != Format::S8Uint)
+			{
+				desc.depthAttachment = { textureView, depth.inferredLoadOp, storeOp, depth.clearDepth };
+			}
+			if (format == Format::D24UnormS8Uint || format == Format::S8Uint)
+			{
+				desc.stencilAttachment = { textureView, depth.inferredLoadOp, storeOp, depth.clearStencil };
+			}
+		}
+		return desc;
+	}
+
+	bool RenderGraph::_canMergeRenderPass(const RenderGraphPassNode* previous, const RenderGraphPassNode* pass) const
+	{
+		if (pass->colorAttachments.empty() && !pass->depthAttachment.resource) return false;
+		if (pass->colorAttachments.size() != previous->colorAttachments.size() ||
+			pass->depthAttachment.resource != previous->depthAttachment.resource) return false;
+		std::vector<RenderGraphResource> attachments;
+		for (size_t i = 0; i < pass->colorAttachments.size(); ++i)
+		{
+			if (pass->colorAttachments[i].resource != previous->colorAttachments[i].resource ||
+				pass->colorAttachments[i].loadOp != LoadOp::Load) return false;
+			attachments.push_back(pass->colorAttachments[i].resource);
+		}
+		if (pass->depthAttachment.resource)
+		{
+			if (pass->depthAttachment.loadOp != LoadOp::Load) return false;
+			attachments.push_back(pass->depthAttachment.resource);
+		}
+
+		auto isAttachment = [&attachments](const RenderGraphResourceEdge* resEdge)
+			{
+				return std::find(attachments.begin(), attachments.end(), resEdge->handle) != attachments.end();
+			};
+		// 附件在RenderPass里不能作为贴图读取。只写附件时，其他资源的生命周期都覆盖前一个Pass，屏障可以提前
+		if (std::any_of(pass->inputs.begin(), pass->inputs.end(), isAttachment)) return false;
+		return std::all_of(pass->outputs.begin(), pass->outputs.end(), isAttachment);
+	}
+
+	void RenderGraph::_mergeRenderPasses(const std::vector<RenderGraphPassNode*>& passes,
+		std::vector<RenderGraphBarrierBatch>& passBarriers, std::vector<bool>& mergedPasses)
+	{
+		mergedPasses.assign(passes.size(), false);
+
+		// 合并中的RenderPass用到的资源，这些资源上的屏障不能提前
+		std::unordered_set<const Texture*> usedTextures;
+		std::unordered_set<const Buffer*> usedBuffers;
+		auto addUsedResource = [&](const RenderGraphResourceEdge* resEdge)
+			{
+				if (auto buffer = _registry.getBuffer(resEdge->handle))
+					usedBuffers.insert(buffer.get());
+				else if (auto texture = std::get<0>(_registry.getTexture(resEdge->handle)))
+					usedTextures.insert(texture.get());
+			};
+		auto addUsedResources = [&](const RenderGraphPassNode* pass)
+			{
+				for (auto resEdge : pass->inputs)
+					addUsedResource(resEdge);
+				for (auto resEdge : pass->outputs)
+					addUsedResource(resEdge);
+			};
+		uint32_t renderPassIndex = 0;
+		for (uint32_t j = 0; j < passes.size(); ++j)
+		{
+			auto pass = passes[j];
+			if (!pass->isEnabled) continue;
+
+			bool merged = j > 0 && passes[j - 1]->isEnabled && _canMergeRenderPass(passes[j - 1], pass);
+			const auto& barriers = passBarriers[j];
+			for (size_t i = 0; merged && i < barriers.textureBarriers.size(); ++i)
+			{
+				const auto& barrier = barriers.textureBarriers[i];
+				// 附件在RenderPass里按光栅化顺序读写，状态不变时不需要屏障
+				if (usedTextures.contains(barrier.texture.get()))
+					merged = barrier.oldState == barrier.newState && barrier.srcQueue == barrier.dstQueue && barrier.newState != TextureState::General;
+			}
+			for (size_t i = 0; merged && i < barriers.bufferBarriers.size(); ++i)
+			{
+				merged = !usedBuffers.contains(barriers.bufferBarriers[i].buffer.get());
+			}
+
+			if (!merged)
+			{
+				renderPassIndex = j;
+				usedTextures.clear();
+				usedBuffers.clear();
+				addUsedResources(pass);
+				continue;
+			}
+
+			mergedPasses[j] = true;
+			auto& renderPassBarriers = passBarriers[renderPassIndex];
+			for (const auto& barrier : barriers.textureBarriers)
+			{
+				if (!usedTextures.contains(barrier.texture.get()))
+					renderPassBarriers.textureBarriers.push_back(barrier);
+			}
+			renderPassBarriers.bufferBarriers.insert(renderPassBarriers.bufferBarriers.end(),
+				barriers.bufferBarriers.begin(), barriers.bufferBarriers.end());
+			passBarriers[j].clear();
+			addUsedResources(pass);
+		}
+	}
+
+	void RenderGraph::_recordPasses(const std::vector<RenderGraphPassNode*>& passes, const std::vector<RenderGraphBarrierBatch>& passBarriers,
+		const std::vector<bool>& mergedPasses, CommandList& commandList, CommandListType queue)
+	{
+		const RenderGraphPassNode* firstPass = nullptr;
+		for (uint32_t j = 0; j < passes.size(); ++j)
+		{
+			auto pass = passes[j];
+			if (!pass->isEnabled) continue;
+
+			// 合并的Pass共用第一个Pass的标签
+			uint32_t last = j;
+			while (last + 1 < passes.size() && mergedPasses[last + 1])
+				last++;
+			if (!mergedPasses[j])
+			{
+				firstPass = pass;
+				commandList.beginLabel(fmt::format("Pass {}", pass->name));
+				// 计时和统计查询需要在RenderPass外，合并的Pass作为一组统计
+				if (_profiler)
+					_profiler->beginPass(commandList, pass, queue, passes[last]);
+				if (!passBarriers[j].empty())
+					commandList.resourceBarriers(passBarriers[j].textureBarriers, passBarriers[j].bufferBarriers);
+			}
+			_evaluatePass(pass, commandList, firstPass, passes[last]);
+			if (last == j)
+			{
+				if (_profiler)
+					_profiler->endPass(commandList, firstPass);
+				commandList.endLabel();
+			}
+		}
+	}
+
+	void RenderGraph::_evaluatePass(RenderGraphPassNode* pass, CommandList& commandList,
+		const RenderGraphPassNode* firstPass, const RenderGraphPassNode* lastPass)
+	{
+		const bool hasAttachments = !pass->colorAttachments.empty() || pass->depthAttachment.resource;
+		if (hasAttachments && pass == firstPass)
+			commandList.beginRenderPass(_getRenderPassDesc(firstPass, lastPass));
+		pass->evaluation(_registry, commandList);
+		if (hasAttachments && pass == lastPass)
+			commandList.endRenderPass();
+	}
+
+	void RenderGraph::_genPassBarriers(RenderGraphPassNode* pass, RenderGraphBarrierBatch& barriers)
+	{
+		for (size_t i = 0; i < pass->inputs.size(); ++i)
+		{
+			auto inputResEdge = pass->inputs[i];
+			if (auto buffer = _registry.getBuffer(inputResEdge->handle))
+			{
+				BufferState state = getInputBufferState(pass->type, buffer);
+				_barrierTracker.transitionBuffer(barriers, buffer, state, getBufferStage(pass->type, state), false);
+				continue;
+			}
+			const auto& [texture, textureView] = _registry.getTexture(inputResEdge->handle);
+			if (texture)
+			{
+				TextureState state = getInputTextureState(pass->type, texture);
+				_barrierTracker.transitionTexture(barriers, texture, pass->inputRanges[i], state, getTextureStage(pass->type, state), false);
+			}
+		}
+		for (size_t i = 0; i < pass->outputs.size(); ++i)
+		{
+			auto outputResEdge = pass->outputs[i];
+			if (auto buffer = _registry.getBuffer(outputResEdge->handle))
+			{
+				BufferState state = getOutputBufferState(pass->type);
+				_barrierTracker.transitionBuffer(barriers, buffer, state, getBufferStage(pass->type, state), true);
+				continue;
+			}
+			const auto& [texture, textureView] = _registry.getTexture(outputResEdge->handle);
+			if (texture)
+			{
+				TextureState state = getOutputTextureState(pass->type, texture);
+				_barrierTracker.transitionTexture(barriers, texture, pass->outputRanges[i], state, getTextureStage(pass->type, state), true);
 			}
 		}
 	}
@@ -503,6 +1968,11 @@ namespace kdGfx
 			{
 				content.append(", color=red");
 			}
+			// 有执行条件的Pass虚线显示
+			if (pass->condition)
+			{
+				content.append(", style=\"filled,dashed\"");
+			}
 
 			content.append("];\n");
 
@@ -582,6 +2052,7 @@ namespace kdGfx
 		ImGui::Begin("Render Graph");
 		ImNodes::BeginNodeEditor();
 
+		bool cullBaseChanged = false;
 		int linkIDs = 0;
 		std::map<std::pair<int, int>, int> linkIDMap;
 		for (int i = _passesTasks.size() - 1; i > -1; --i)
@@ -596,7 +2067,7 @@ namespace kdGfx
 				ImGui::TextUnformatted(pass->name.c_str());
 				ImNodes::EndNodeTitleBar();
 
-				ImGui::Checkbox("Cull Base", &pass->isCullBase);
+				cullBaseChanged |= ImGui::Checkbox("Cull Base", &pass->isCullBase);
 
 				int k = 0;
 				for (auto& input : pass->inputs)
@@ -648,8 +2119,10 @@ namespace kdGfx
 		static std::vector<std::pair<int, int>> links;
 		if (_imNodesDirty)
 		{
+			links.clear();
 			for (auto consumer : _passes)
 			{
+				if (consumer->isCulled) continue;
 				int consumerID = (int)std::distance(std::find(_passes.begin(), _passes.end(), consumer), _passes.end());
 				for (int i = 0; i < consumer->inputs.size(); i++)
 				{
@@ -695,5 +2168,8 @@ namespace kdGfx
 		}
 
 		_imNodesDirty = false;
+		// 设定节点变化后重新编译，下一帧执行前生效
+		if (cullBaseChanged)
+			markDirty();
 	}
 }
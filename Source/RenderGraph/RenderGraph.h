@@ -1,6 +1,12 @@
 #pragma once
 
 #include "RenderGraphRegistry.h"
+#include "RenderGraphMemoryPlanner.h"
+#include "RenderGraphBarrierTracker.h"
+#include "RenderGraphResourcePool.h"
+#include "RenderGraphProfiler.h"
+#include "RenderGraphCompileCache.h"
+#include "../RHI/Common/ThreadPool.h"
 
 namespace kdGfx
 {
@@ -16,8 +22,12 @@ namespace kdGfx
         // isCullbase裁剪图的依据，一般是最后渲染到后缓冲区Pass
         void addPass(const std::string_view name, RenderGraphPassType type,
             RenderGraphPassNodeConstruction construction, bool isCullBase = false);
+        // 与上次编译结果对比，只重建变化的贴图
         void compile();
+        // 所有Pass录制到setCommandList设置的命令列表
         void execute();
+        // 渲染图自己提交，Compute和Copy Pass可以放到异步队列，可以多线程录制
+        // 开始前等待fence到waitValue，全部完成后在主队列发出signalValue
         void execute(std::shared_ptr<Fence> fence, uint64_t waitValue, uint64_t signalValue);
         // 自动缩放所有帧纹理大小
         void resize(uint32_t width, uint32_t height);
@@ -37,16 +47,142 @@ namespace kdGfx
         {
             _commandList = commandList;
         }
+        inline void setAliasingStrategy(RenderGraphAliasingStrategy strategy)
+        {
+            _aliasingStrategy = strategy;
+            markDirty();
+        }
+        inline const RenderGraphMemoryPlanner& getMemoryPlanner() const { return _memoryPlanner; }
+        // 从共享的资源池获取内存和buffer，不设置时渲染图自己创建
+        void setResourcePool(const std::shared_ptr<RenderGraphResourcePool>& resourcePool);
+        // 关闭后多队列执行也全部放在主队列
+        inline void setAsyncQueues(bool enable)
+        {
+            _asyncQueues = enable;
+            markDirty();
+        }
+        // 并行录制时Pass执行函数会在多个线程同时调用，执行函数里不能修改共享状态
+        inline void setRecordMode(RenderGraphRecordMode mode, const std::shared_ptr<ThreadPool>& threadPool = nullptr)
+        {
+            _recordMode = mode;
+            _threadPool = threadPool;
+            markDirty();
+        }
+        inline void setScheduleStrategy(RenderGraphScheduleStrategy strategy)
+        {
+            _scheduleStrategy = strategy;
+            markDirty();
+        }
+        // 同时在GPU上执行的帧数，历史贴图保留framesInFlight + 1个版本
+        inline void setFramesInFlight(uint32_t framesInFlight)
+        {
+            _registry._historyVersions = std::max(framesInFlight, 1u) + 1;
+            markDirty();
+        }
+        // 替换Pass的执行条件，不需要重新编译
+        void setPassCondition(const std::string_view passName, RenderGraphPassCondition condition);
+        // Pass参数，类型和setParameters不一致时返回null。在两次执行之间修改，执行期间录制命令会读取
+        template<typename T>
+        inline std::shared_ptr<T> getPassParameters(const std::string_view passName) const
+        {
+            for (auto pass : _passes)
+            {
+                if (pass->name == passName && pass->parametersType && *pass->parametersType == typeid(T))
+                    return std::static_pointer_cast<T>(pass->parameters);
+            }
+            return nullptr;
+        }
+        // 设置后统计每个Pass的GPU耗时
+        inline void setProfiler(const std::shared_ptr<RenderGraphProfiler>& profiler) { _profiler = profiler; }
+        inline const std::shared_ptr<RenderGraphProfiler>& getProfiler() const { return _profiler; }
+        inline const std::vector<RenderGraphSubmitBatch>& getSubmitBatches() const { return _submitBatches; }
+        // 单个队列按提交顺序的批次，用于查看各队列时间线
+        std::vector<const RenderGraphSubmitBatch*> getQueueTimeline(CommandListType queue) const;
+        // 加载上次保存的编译结果，图结构一致时compile跳过剔除、分层和贴图大小查询
+        // deviceTag区分设备，不同设备的贴图大小和队列不能共用
+        inline bool loadCompileCache(const std::string& filename, const std::string& deviceTag)
+        {
+            return _compileCache.load(filename, deviceTag);
+        }
+        // 保存最近一次编译的结果，需要在compile之后调用
+        inline bool saveCompileCache(const std::string& filename, const std::string& deviceTag) const
+        {
+            return _compiled && _compileCache.save(filename, deviceTag);
+        }
 
     private:
         std::shared_ptr<Device> _device;
         std::shared_ptr<CommandList> _commandList;
         std::shared_ptr<Memory> _memory;
+        std::shared_ptr<RenderGraphResourcePool> _resourcePool;
+        std::shared_ptr<RenderGraphProfiler> _profiler;
         RenderGraphRegistry _registry;
+        RenderGraphMemoryPlanner _memoryPlanner;
+        RenderGraphAliasingStrategy _aliasingStrategy = RenderGraphAliasingStrategy::GreedyBySize;
+        RenderGraphBarrierTracker _barrierTracker;
+        RenderGraphCompileCache _compileCache;
+        // 本次编译沿用了缓存的剔除、分层和用途
+        bool _compileCacheHit = false;
         
         std::vector<RenderGraphPassNode*> _passes;
         std::unordered_map<RenderGraphResource, RenderGraphResourceEdge*> _resourceEdgesMap;
+        // 按依赖深度分层，用于显示和按层级录制
         std::vector<std::vector<RenderGraphPassNode*>> _passesTasks;
+        // 调度后的执行顺序，资源生命周期按这个顺序计算
+        std::vector<RenderGraphPassNode*> _passOrder;
+        RenderGraphScheduleStrategy _scheduleStrategy = RenderGraphScheduleStrategy::MaximizeOverlap;
+        // 上次编译的贴图状态，用于增量编译
+        struct CompiledTexture
+        {
+            TextureDesc desc;
+            uint32_t firstUseTask = 0;
+            uint32_t lastUseTask = 0;
+            size_t offset = 0;
+        };
+        std::unordered_map<RenderGraphResource, CompiledTexture> _compiledTextures;
+        // 放在渲染图内存上的buffer，描述不随分辨率变化
+        struct CompiledBuffer
+        {
+            AllocateInfo allocateInfo;
+            uint32_t firstUseTask = 0;
+            uint32_t lastUseTask = 0;
+            size_t offset = 0;
+        };
+        std::unordered_map<RenderGraphResource, CompiledBuffer> _compiledBuffers;
+        // 多队列执行
+        std::vector<RenderGraphSubmitBatch> _submitBatches;
+        // 录制单元，每个单元录制到一个命令列表，屏障在录制前推导好
+        struct RecordUnit
+        {
+            uint32_t batchIndex = 0;
+            std::vector<RenderGraphPassNode*> passes;
+            RenderGraphBarrierBatch beginBarriers;
+            std::vector<RenderGraphBarrierBatch> passBarriers;
+            // 本帧接着前一个Pass的RenderPass绘制的Pass
+            std::vector<bool> mergedPasses;
+            RenderGraphBarrierBatch endBarriers;
+            // 每帧轮换一个，比同时在GPU上的帧数多一个
+            std::vector<std::shared_ptr<CommandList>> commandLists;
+        };
+        std::vector<RecordUnit> _recordUnits;
+        // 录制单元的命令列表组，复用前等待上次使用这一组的帧
+        uint32_t _frameSlot = 0;
+        std::vector<std::unordered_map<CommandListType, uint64_t>> _frameSlotFenceValues;
+        // 每个批次开始执行前一定已经完成的批次，由队列内的顺序和跨队列的等待推导
+        std::vector<std::vector<bool>> _batchPredecessors;
+        std::unordered_map<const RenderGraphPassNode*, uint32_t> _passBatchIndices;
+        std::unordered_map<const RenderGraphPassNode*, uint32_t> _passOrderIndices;
+        // Pass在跨队列依赖图上最早和最晚可能执行的层级
+        std::unordered_map<const RenderGraphPassNode*, std::pair<uint32_t, uint32_t>> _passDependencyLevels;
+        // 批次结构变化后资源间的先后关系会变，内存位置全部重新规划
+        size_t _batchesKey = 0;
+        size_t _compiledBatchesKey = 0;
+        RenderGraphRecordMode _recordMode = RenderGraphRecordMode::Serial;
+        std::shared_ptr<ThreadPool> _threadPool;
+        std::unordered_map<CommandListType, std::shared_ptr<Fence>> _queueFences;
+        std::unordered_map<CommandListType, uint64_t> _queueFenceValues;
+        std::unordered_map<RenderGraphResource, CommandListType> _textureOwners;
+        bool _asyncQueues = true;
         
         uint32_t _width = 0;
         uint32_t _height = 0;
@@ -55,13 +191,52 @@ namespace kdGfx
         bool _imNodesDirty = true;
 
     private:
+        // 图结构和资源描述的哈希，作为编译缓存的key
+        size_t _hashTopology() const;
         void _cullPasses();
+        // 多个Pass写入同一资源时，第一个没有被剔除的作为producer
+        void _updateProducers();
         void _genParallelTasks();
+        // 执行前按条件确定本帧执行的Pass
+        void _updatePassConditions();
+        // 列表调度，每次从就绪的Pass中按策略选一个
+        void _schedulePasses();
+        void _assignQueues();
+        void _genSubmitBatches();
+        void _waitSubmitBatches();
+        // 释放资源前等待所有队列，外部提交的命令列表也可能在使用
+        void _waitQueuesIdle();
+        // 两个Pass在GPU上是否一定先后执行，单个命令列表和多队列两种执行方式都要满足
+        bool _isPassBefore(const RenderGraphPassNode* a, const RenderGraphPassNode* b) const;
+        // a的所有使用都在b的第一次使用之前完成
+        bool _isResourceBefore(const RenderGraphResourceEdge* a, const RenderGraphResourceEdge* b) const;
         void _allocResources();
         void _allocMemory();
         void _createResources();
-        void _autoSetTextureUsage();
-        void _autoTransitionTextureState(RenderGraphPassNode* passNode, std::shared_ptr<CommandList> commandList);
+        // 历史贴图跨帧保留内容，不参与内存别名
+        void _allocHistoryTextures();
+        // 为按范围读写的贴图创建视图，handle为0时重建所有贴图的视图
+        void _createRangeViews(RenderGraphResource handle = 0);
+        void _releaseResources();
+        void _autoSetTextureUsage(RenderGraphResourceEdge* resEdge, TextureDesc& textureDesc);
+        // 优先使用缓存的查询结果，查询设备需要创建临时贴图
+        AllocateInfo _getTextureAllocateInfo(const TextureDesc& textureDesc);
+        // 附件之前没有内容时不加载，之后没有读取和写入时不存储
+        void _inferAttachmentOps();
+        // 附件相同的连续Pass合并到一个RenderPass，加载按第一个Pass，存储按最后一个Pass
+        RenderPassDesc _getRenderPassDesc(const RenderGraphPassNode* firstPass, const RenderGraphPassNode* lastPass) const;
+        // 后一个Pass加载前一个Pass的全部附件，并且不读取附件也不写入其他资源
+        bool _canMergeRenderPass(const RenderGraphPassNode* previous, const RenderGraphPassNode* pass) const;
+        // 推导好屏障后决定合并，合并的Pass的屏障提前到RenderPass开始前，附件上状态不变的屏障去掉
+        void _mergeRenderPasses(const std::vector<RenderGraphPassNode*>& passes,
+            std::vector<RenderGraphBarrierBatch>& passBarriers, std::vector<bool>& mergedPasses);
+        void _recordPasses(const std::vector<RenderGraphPassNode*>& passes, const std::vector<RenderGraphBarrierBatch>& passBarriers,
+            const std::vector<bool>& mergedPasses, CommandList& commandList, CommandListType queue);
+        // 执行Pass，声明了附件时包在firstPass开始、lastPass结束的RenderPass里
+        void _evaluatePass(RenderGraphPassNode* pass, CommandList& commandList,
+            const RenderGraphPassNode* firstPass, const RenderGraphPassNode* lastPass);
+        // 推导Pass边界上的屏障，读后读不生成屏障
+        void _genPassBarriers(RenderGraphPassNode* passNode, RenderGraphBarrierBatch& barriers);
         inline RenderGraphResourceEdge* _createResourceEdge(const std::string_view name, RenderGraphResource handle)
         {
             auto resourceEdge = new RenderGraphResourceEdge();
@@ -0,0 +1,316 @@
+#include "RenderGraphBarrierTracker.h"
+
+namespace kdGfx
+{
+	inline static bool containsStages(PipelineStage stages, PipelineStage stage)
+	{
+		return HasAnyBits(stages, PipelineStage::AllCommands) || (stages & stage) == static_cast<int>(stage);
+	}
+
+	// 追加单个子资源的屏障，和前面参数相同、范围相邻的屏障合并
+	static void appendTextureBarrier(RenderGraphBarrierBatch& batch, const TextureBarrierDesc& desc)
+	{
+		auto isSameBarrier = [](const TextureBarrierDesc& a, const TextureBarrierDesc& b)
+			{
+				return a.texture == b.texture && a.oldState == b.oldState && a.newState == b.newState &&
+					a.srcQueue == b.srcQueue && a.dstQueue == b.dstQueue && a.srcStage == b.srcStage && a.dstStage == b.dstStage;
+			};
+
+		auto& barriers = batch.textureBarriers;
+		if (!barriers.empty() && isSameBarrier(barriers.back(), desc))
+		{
+			// 同一数组层的下一个mip
+			auto& subRange = barriers.back().subRange;
+			if (subRange.layerCount == 1 && subRange.baseArrayLayer == desc.subRange.baseArrayLayer &&
+				subRange.baseMipLevel + subRange.levelCount == desc.subRange.baseMipLevel)
+			{
+				subRange.levelCount++;
+			}
+			else
+			{
+				barriers.push_back(desc);
+			}
+		}
+		else
+		{
+			barriers.push_back(desc);
+		}
+
+		// mip范围相同的相邻数组层
+		if (barriers.size() < 2) return;
+		auto& prev = barriers[barriers.size() - 2];
+		const auto& last = barriers.back();
+		if (isSameBarrier(prev, last) && prev.subRange.baseMipLevel == last.subRange.baseMipLevel &&
+			prev.subRange.levelCount == last.subRange.levelCount &&
+			prev.subRange.baseArrayLayer + prev.subRange.layerCount == last.subRange.baseArrayLayer)
+		{
+			prev.subRange.layerCount += last.subRange.layerCount;
+			barriers.pop_back();
+		}
+	}
+
+	TextureState RenderGraphBarrierTracker::transitionTexture(RenderGraphBarrierBatch& batch, const std::shared_ptr<Texture>& texture,
+		const TextureViewDesc& range, TextureState newState, PipelineStage stage, bool isWrite, CommandListType srcQueue, CommandListType dstQueue)
+	{
+		auto& access = _getTextureAccess(texture);
+		const uint32_t mipLevels = std::max(texture->getDesc().mipLevels, 1u);
+		const uint32_t arrayLayers = std::max(texture->getDesc().arrayLayers, 1u);
+		const uint32_t baseMip = std::min(range.baseMipLevel, mipLevels - 1);
+		const uint32_t endMip = baseMip + std::min(range.levelCount, mipLevels - baseMip);
+		const uint32_t baseLayer = std::min(range.baseArrayLayer, arrayLayers - 1);
+		const uint32_t endLayer = baseLayer + std::min(range.layerCount, arrayLayers - baseLayer);
+		const TextureState firstOldState = access.subresources[baseLayer * mipLevels + baseMip].state;
+		const PipelineStage aliasStages = _getAliasStages(texture.get());
+
+		for (uint32_t layer = baseLayer; layer < endLayer; ++layer)
+		{
+			for (uint32_t mip = baseMip; mip < endMip; ++mip)
+			{
+				auto& subresource = access.subresources[layer * mipLevels + mip];
+				TextureState oldState = subresource.state;
+				bool layoutChange = oldState != newState || srcQueue != dstQueue;
+				TextureBarrierDesc barrier = {
+					.texture = texture,
+					.oldState = oldState,
+					.newState = newState,
+					.subRange = { mip, 1, layer, 1 },
+					.dstStage = stage
+				};
+
+				if (!layoutChange && !isWrite)
+				{
+					// 读后读不需要屏障，只需要确认最近的写入对这个阶段可见
+					if (subresource.writeStages != PipelineStage::None && !containsStages(subresource.visibleStages, stage))
+					{
+						barrier.srcStage = subresource.writeStages;
+						appendTextureBarrier(batch, barrier);
+						subresource.visibleStages |= stage;
+					}
+					subresource.readStages |= stage;
+					continue;
+				}
+
+				// 写入之后有读取时，读取前的屏障已经让写入可见，布局不变只需要等待这些读取
+				PipelineStage srcStage = !layoutChange && subresource.readStages != PipelineStage::None ?
+					subresource.readStages : subresource.writeStages | subresource.readStages;
+				if (oldState == TextureState::Undefined)
+					srcStage |= aliasStages;
+				if (layoutChange || srcStage != PipelineStage::None)
+				{
+					barrier.srcQueue = srcQueue;
+					barrier.dstQueue = dstQueue;
+					barrier.srcStage = srcStage;
+					appendTextureBarrier(batch, barrier);
+				}
+
+				subresource.state = newState;
+				subresource.writeStages = stage;
+				// 布局切换本身也是写入，之后的读取在同一阶段可见
+				subresource.readStages = isWrite ? PipelineStage::None : stage;
+				subresource.visibleStages = isWrite ? PipelineStage::None : stage;
+			}
+		}
+		return firstOldState;
+	}
+
+	void RenderGraphBarrierTracker::transitionBuffer(RenderGraphBarrierBatch& batch, const std::shared_ptr<Buffer>& buffer,
+		BufferState newState, PipelineStage stage, bool isWrite)
+	{
+		auto& access = _getBufferAccess(buffer);
+		BufferState oldState = access.state;
+		access.state = newState;
+
+		if (!isWrite)
+		{
+			if (access.writeStages != PipelineStage::None && !containsStages(access.visibleStages, stage))
+			{
+				batch.bufferBarriers.push_back({ .buffer = buffer, .oldState = oldState, .newState = newState, .srcStage = access.writeStages, .dstStage = stage });
+				access.visibleStages |= stage;
+			}
+			access.readStages |= stage;
+			return;
+		}
+
+		// 写入需要等待前面的读写完成，状态不变且有读取时只需要等待这些读取
+		PipelineStage srcStage = oldState == newState && access.readStages != PipelineStage::None ?
+			access.readStages : access.writeStages | access.readStages;
+		if (srcStage != PipelineStage::None)
+		{
+			batch.bufferBarriers.push_back({ .buffer = buffer, .oldState = oldState, .newState = newState, .srcStage = srcStage, .dstStage = stage });
+		}
+		access.writeStages = stage;
+		access.readStages = PipelineStage::None;
+		access.visibleStages = PipelineStage::None;
+	}
+
+	void RenderGraphBarrierTracker::discardTexture(const std::shared_ptr<Texture>& texture)
+	{
+		setTextureState(texture, TextureState::Undefined);
+	}
+
+	void RenderGraphBarrierTracker::setTextureState(const std::shared_ptr<Texture>& texture, TextureState state)
+	{
+		// 其他队列的访问由信号量同步，不需要在这个队列等待
+		auto& access = _getTextureAccess(texture);
+		for (auto& subresource : access.subresources)
+		{
+			subresource.state = state;
+			subresource.writeStages = PipelineStage::None;
+			subresource.readStages = PipelineStage::None;
+			subresource.visibleStages = PipelineStage::None;
+		}
+	}
+
+	void RenderGraphBarrierTracker::setAliases(const std::shared_ptr<Texture>& texture, const std::vector<std::shared_ptr<Texture>>& textureAliases,
+		const std::vector<std::shared_ptr<Buffer>>& bufferAliases)
+	{
+		auto& aliases = _aliases[texture.get()];
+		aliases.textures.assign(textureAliases.begin(), textureAliases.end());
+		aliases.buffers.assign(bufferAliases.begin(), bufferAliases.end());
+	}
+
+	void RenderGraphBarrierTracker::setAliases(const std::shared_ptr<Buffer>& buffer, const std::vector<std::shared_ptr<Texture>>& textureAliases,
+		const std::vector<std::shared_ptr<Buffer>>& bufferAliases)
+	{
+		auto& aliases = _aliases[buffer.get()];
+		aliases.textures.assign(textureAliases.begin(), textureAliases.end());
+		aliases.buffers.assign(bufferAliases.begin(), bufferAliases.end());
+	}
+
+	void RenderGraphBarrierTracker::clearAliases()
+	{
+		_aliases.clear();
+	}
+
+	void RenderGraphBarrierTracker::commit()
+	{
+		for (const auto& [ptr, access] : _textures)
+		{
+			auto texture = access.texture.lock();
+			if (!texture) continue;
+
+			const auto& subresources = access.subresources;
+			const TextureState state = subresources.front().state;
+			if (std::all_of(subresources.begin(), subresources.end(), [state](const SubresourceAccess& subresource) { return subresource.state == state; }))
+			{
+				texture->setState(state);
+				continue;
+			}
+			const uint32_t mipLevels = std::max(texture->getDesc().mipLevels, 1u);
+			for (uint32_t i = 0; i < subresources.size(); ++i)
+				texture->setState(subresources[i].state, { i % mipLevels, 1, i / mipLevels, 1 });
+		}
+		// 只保留本次访问过的资源，避免持有已销毁资源的记录
+		_committedTextures = std::move(_textures);
+		_committedBuffers = std::move(_buffers);
+		_textures.clear();
+		_buffers.clear();
+	}
+
+	void RenderGraphBarrierTracker::clear()
+	{
+		_textures.clear();
+		_committedTextures.clear();
+		_buffers.clear();
+		_committedBuffers.clear();
+		_aliases.clear();
+	}
+
+	RenderGraphBarrierTracker::TextureAccess& RenderGraphBarrierTracker::_getTextureAccess(const std::shared_ptr<Texture>& texture)
+	{
+		auto it = _textures.find(texture.get());
+		if (it != _textures.end())
+			return it->second;
+
+		TextureAccess access;
+		access.texture = texture;
+		const uint32_t mipLevels = std::max(texture->getDesc().mipLevels, 1u);
+		const uint32_t arrayLayers = std::max(texture->getDesc().arrayLayers, 1u);
+		access.subresources.resize(mipLevels * arrayLayers);
+		for (uint32_t layer = 0; layer < arrayLayers; ++layer)
+		{
+			for (uint32_t mip = 0; mip < mipLevels; ++mip)
+				access.subresources[layer * mipLevels + mip].state = texture->getState(mip, layer);
+		}
+		// 上次提交后状态没有被外部修改，可以沿用记录的访问阶段
+		auto committedIt = _committedTextures.find(texture.get());
+		if (committedIt != _committedTextures.end() && committedIt->second.texture.lock() == texture &&
+			std::equal(access.subresources.begin(), access.subresources.end(),
+				committedIt->second.subresources.begin(), committedIt->second.subresources.end(),
+				[](const SubresourceAccess& a, const SubresourceAccess& b) { return a.state == b.state; }))
+		{
+			access = committedIt->second;
+		}
+		// 别名贴图的内存在两次使用之间被其他贴图覆盖，内容和布局都已失效
+		if (_aliases.contains(texture.get()))
+		{
+			for (auto& subresource : access.subresources)
+				subresource.state = TextureState::Undefined;
+		}
+		return _textures[texture.get()] = access;
+	}
+
+	RenderGraphBarrierTracker::BufferAccess& RenderGraphBarrierTracker::_getBufferAccess(const std::shared_ptr<Buffer>& buffer)
+	{
+		auto it = _buffers.find(buffer.get());
+		if (it != _buffers.end())
+			return it->second;
+
+		BufferAccess access;
+		access.buffer = buffer;
+		auto committedIt = _committedBuffers.find(buffer.get());
+		if (committedIt != _committedBuffers.end() && committedIt->second.buffer.lock() == buffer)
+		{
+			access = committedIt->second;
+		}
+		// 别名buffer的内存被其他资源覆盖过，把别名的访问当作上一次写入
+		if (_aliases.contains(buffer.get()))
+		{
+			access.state = BufferState::Undefined;
+			access.writeStages = _getAliasStages(buffer.get());
+			access.readStages = PipelineStage::None;
+			access.visibleStages = PipelineStage::None;
+		}
+		return _buffers[buffer.get()] = access;
+	}
+
+	PipelineStage RenderGraphBarrierTracker::_getAliasStages(const void* resource)
+	{
+		PipelineStage stages = PipelineStage::None;
+		auto aliasesIt = _aliases.find(resource);
+		if (aliasesIt == _aliases.end())
+			return stages;
+
+		for (const auto& weakAlias : aliasesIt->second.buffers)
+		{
+			auto alias = weakAlias.lock();
+			if (!alias) continue;
+
+			const BufferAccess* access = nullptr;
+			if (auto it = _buffers.find(alias.get()); it != _buffers.end())
+				access = &it->second;
+			else if (auto it = _committedBuffers.find(alias.get()); it != _committedBuffers.end() && it->second.buffer.lock() == alias)
+				access = &it->second;
+			if (!access)
+				return PipelineStage::AllCommands;
+			stages |= access->writeStages | access->readStages;
+		}
+		for (const auto& weakAlias : aliasesIt->second.textures)
+		{
+			auto alias = weakAlias.lock();
+			if (!alias) continue;
+
+			const TextureAccess* access = nullptr;
+			if (auto it = _textures.find(alias.get()); it != _textures.end())
+				access = &it->second;
+			else if (auto it = _committedTextures.find(alias.get()); it != _committedTextures.end() && it->second.texture.lock() == alias)
+				access = &it->second;
+			// 没有记录的访问，只能等待全部命令
+			if (!access)
+				return PipelineStage::AllCommands;
+			for (const auto& subresource : access->subresources)
+				stages |= subresource.writeStages | subresource.readStages;
+		}
+		return stages;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "BaseTypes.h"
+
+namespace kdGfx
+{
+    // Pass边界上合并成一次调用的屏障
+    struct RenderGraphBarrierBatch
+    {
+        std::vector<TextureBarrierDesc> textureBarriers;
+        std::vector<BufferBarrierDesc> bufferBarriers;
+
+        inline bool empty() const { return textureBarriers.empty() && bufferBarriers.empty(); }
+        inline void clear()
+        {
+            textureBarriers.clear();
+            bufferBarriers.clear();
+        }
+    };
+
+    // 追踪资源最近的访问，推导最少的屏障和精确的同步阶段
+    // 贴图按mip和数组层分别追踪，推导过程只修改追踪状态，commit后才写回贴图
+    class RenderGraphBarrierTracker
+    {
+    public:
+        // 切换range内的mip和数组层，状态相同的相邻子资源合并成一个屏障。返回range第一个子资源切换前的状态
+        TextureState transitionTexture(RenderGraphBarrierBatch& batch, const std::shared_ptr<Texture>& texture,
+            const TextureViewDesc& range, TextureState newState, PipelineStage stage, bool isWrite,
+            CommandListType srcQueue = CommandListType::General, CommandListType dstQueue = CommandListType::General);
+        void transitionBuffer(RenderGraphBarrierBatch& batch, const std::shared_ptr<Buffer>& buffer,
+            BufferState newState, PipelineStage stage, bool isWrite);
+        // 内容不需要保留，下次切换从Undefined开始
+        void discardTexture(const std::shared_ptr<Texture>& texture);
+        // 强制设置追踪状态，用于跨队列获取时和释放一侧保持一致
+        void setTextureState(const std::shared_ptr<Texture>& texture, TextureState state);
+        // 共用内存的资源，每次推导首次访问时内容无效，并等待别名的访问完成。贴图从Undefined开始
+        void setAliases(const std::shared_ptr<Texture>& texture, const std::vector<std::shared_ptr<Texture>>& textureAliases,
+            const std::vector<std::shared_ptr<Buffer>>& bufferAliases = {});
+        void setAliases(const std::shared_ptr<Buffer>& buffer, const std::vector<std::shared_ptr<Texture>>& textureAliases,
+            const std::vector<std::shared_ptr<Buffer>>& bufferAliases = {});
+        void clearAliases();
+        // 写回贴图状态，保留访问阶段给下次推导
+        void commit();
+        void clear();
+
+    private:
+        struct Access
+        {
+            // 最近一次写入的阶段，未知时是AllCommands
+            PipelineStage writeStages = PipelineStage::AllCommands;
+            // 最近一次写入后读取的阶段
+            PipelineStage readStages = PipelineStage::None;
+            // 最近一次写入已经对这些阶段可见
+            PipelineStage visibleStages = PipelineStage::None;
+        };
+        struct SubresourceAccess : Access
+        {
+            TextureState state = TextureState::Undefined;
+        };
+        struct TextureAccess
+        {
+            std::weak_ptr<Texture> texture;
+            // 按数组层、mip排列
+            std::vector<SubresourceAccess> subresources;
+        };
+        struct BufferAccess : Access
+        {
+            std::weak_ptr<Buffer> buffer;
+            BufferState state = BufferState::Undefined;
+        };
+        // 本次推导的访问，以及上次提交保留的访问
+        std::unordered_map<Texture*, TextureAccess> _textures;
+        std::unordered_map<Texture*, TextureAccess> _committedTextures;
+        std::unordered_map<Buffer*, BufferAccess> _buffers;
+        std::unordered_map<Buffer*, BufferAccess> _committedBuffers;
+        struct Aliases
+        {
+            std::vector<std::weak_ptr<Texture>> textures;
+            std::vector<std::weak_ptr<Buffer>> buffers;
+        };
+        // 贴图和buffer可以互为别名，按资源地址索引
+        std::unordered_map<const void*, Aliases> _aliases;
+
+    private:
+        TextureAccess& _getTextureAccess(const std::shared_ptr<Texture>& texture);
+        BufferAccess& _getBufferAccess(const std::shared_ptr<Buffer>& buffer);
+        PipelineStage _getAliasStages(const void* resource);
+    };
+}
@@ -13,19 +13,79 @@ namespace kdGfx
             : _graph(graph), _passNode(passNode) {};
 
         inline RenderGraphResource read(RenderGraphResource resource)
+        {
+            return read(resource, RenderGraphAllSubresources);
+        }
+        inline RenderGraphResource write(RenderGraphResource resource)
+        {
+            return write(resource, RenderGraphAllSubresources);
+        }
+        // 只读写贴图的部分mip和数组层，依赖和屏障按范围推导
+        // 不同Pass可以写入同一贴图的不同范围，例如在一张贴图的mip链上逐级降采样
+        // 执行时用registry.getTextureView(resource, range)获取对应范围的视图
+        inline RenderGraphResource read(RenderGraphResource resource, const TextureViewDesc& range)
         {
             auto resourceEdge = _graph._getResourceEdge(resource);
             resourceEdge->consumers.emplace_back(_passNode);
             _passNode->inputs.emplace_back(resourceEdge);
+            _passNode->inputRanges.emplace_back(range);
             return resource;
         }
-        inline RenderGraphResource write(RenderGraphResource resource)
+        inline RenderGraphResource write(RenderGraphResource resource, const TextureViewDesc& range)
         {
             auto resourceEdge = _graph._getResourceEdge(resource);
-            resourceEdge->producer = _passNode;
+            if (std::find(resourceEdge->producers.begin(), resourceEdge->producers.end(), _passNode) == resourceEdge->producers.end())
+                resourceEdge->producers.emplace_back(_passNode);
+            if (!resourceEdge->producer)
+                resourceEdge->producer = _passNode;
             _passNode->outputs.emplace_back(resourceEdge);
+            _passNode->outputRanges.emplace_back(range);
             return resource;
         }
+        // 在计算Pass里作为UAV写入，渲染图自动加上Storage用途
+        inline RenderGraphResource writeStorage(RenderGraphResource resource, const TextureViewDesc& range = RenderGraphAllSubresources)
+        {
+            _graph._getResourceEdge(resource)->isUAV = true;
+            return write(resource, range);
+        }
+        // 作为附件写入，渲染图在执行函数前后开始和结束RenderPass，执行函数里直接绘制
+        // 渲染图创建的贴图之前没有内容，Load会推导成DontCare；之后没有Pass读取和写入的附件不存储
+        // 连续的Pass写入相同的附件并且都是Load时合并到一个RenderPass，合并的Pass不能把附件作为贴图读取
+        inline RenderGraphResource writeColorAttachment(RenderGraphResource resource, LoadOp loadOp = LoadOp::Load,
+            const std::array<float, 4>& clearValue = { 0.0f, 0.0f, 0.0f, 0.0f })
+        {
+            _passNode->colorAttachments.push_back({ .resource = resource, .loadOp = loadOp, .clearColor = clearValue });
+            return write(resource);
+        }
+        // 带模板的格式同时作为模板附件
+        inline RenderGraphResource writeDepthAttachment(RenderGraphResource resource, LoadOp loadOp = LoadOp::Load,
+            float clearDepth = 1.0f, uint32_t clearStencil = 0)
+        {
+            _passNode->depthAttachment = { .resource = resource, .loadOp = loadOp, .clearDepth = clearDepth, .clearStencil = clearStencil };
+            return write(resource);
+        }
+        // 每帧执行前判断，返回false时跳过这个Pass，不需要重新编译
+        // 依赖和内存按全部Pass执行规划，任意组合都有效。读取被跳过Pass的输出时内容未定义
+        inline void setCondition(RenderGraphPassCondition condition)
+        {
+            _passNode->condition = std::move(condition);
+        }
+        // Pass参数，执行函数持有返回的指针读取，外部用RenderGraph::getPassParameters修改
+        template<typename T>
+        inline std::shared_ptr<T> setParameters(const T& parameters = {})
+        {
+            auto ptr = std::make_shared<T>(parameters);
+            _passNode->parameters = ptr;
+            _passNode->parametersType = &typeid(T);
+            return ptr;
+        }
+        // 读取资源上一帧的内容，返回历史资源。渲染图保留多个版本并每帧轮换，不需要手动拷贝
+        // 第一帧和重建后没有历史内容，用registry.isHistoryValid判断
+        inline RenderGraphResource readHistory(RenderGraphResource resource)
+        {
+            RenderGraphResource history = _graph.getRegistry()._createHistoryTexture(resource);
+            return history ? read(history) : history;
+        }
         
         // 导入外部资源，渲染图不管理生命周期
         inline RenderGraphResource importBuffer(const std::shared_ptr<Buffer>& buffer, const std::string_view name = "")
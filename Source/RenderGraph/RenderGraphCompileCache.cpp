@@ -0,0 +1,240 @@
+#include "RenderGraphCompileCache.h"
+#include "../Misc.h"
+
+namespace kdGfx
+{
+	// 文件格式变化时递增
+	static constexpr uint32_t compileCacheMagic = 0x4B444743;
+	static constexpr uint32_t compileCacheVersion = 3;
+
+	class CacheWriter
+	{
+	public:
+		template <typename T>
+		inline void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const char* bytes = reinterpret_cast<const char*>(&value);
+			data.insert(data.end(), bytes, bytes + sizeof(T));
+		}
+
+		std::vector<char> data;
+	};
+
+	class CacheReader
+	{
+	public:
+		CacheReader(const std::vector<char>& data) : _data(data) {}
+
+		template <typename T>
+		inline bool read(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			if (_offset + sizeof(T) > _data.size()) return false;
+			memcpy(&value, _data.data() + _offset, sizeof(T));
+			_offset += sizeof(T);
+			return true;
+		}
+
+	private:
+		const std::vector<char>& _data;
+		size_t _offset = 0;
+	};
+
+	inline static void writeTextureDesc(CacheWriter& writer, const TextureDesc& desc)
+	{
+		writer.write(desc.type);
+		writer.write(desc.usage);
+		writer.write(desc.format);
+		writer.write(desc.width);
+		writer.write(desc.height);
+		writer.write(desc.depth);
+		writer.write(desc.mipLevels);
+		writer.write(desc.arrayLayers);
+		writer.write(desc.sampleCount);
+	}
+
+	inline static bool readTextureDesc(CacheReader& reader, TextureDesc& desc)
+	{
+		return reader.read(desc.type) && reader.read(desc.usage) && reader.read(desc.format) &&
+			reader.read(desc.width) && reader.read(desc.height) && reader.read(desc.depth) &&
+			reader.read(desc.mipLevels) && reader.read(desc.arrayLayers) && reader.read(desc.sampleCount);
+	}
+
+	bool RenderGraphCompileCache::load(const std::string& filename, const std::string& deviceTag)
+	{
+		clear();
+		std::vector<char> data;
+		if (!LoadBinaryFile(filename, data)) return false;
+
+		CacheReader reader(data);
+		uint32_t magic = 0, version = 0;
+		size_t deviceHash = 0;
+		if (!reader.read(magic) || !reader.read(version) || !reader.read(deviceHash) ||
+			magic != compileCacheMagic || version != compileCacheVersion)
+		{
+			spdlog::warn("render graph compile cache {} is invalid", filename);
+			return false;
+		}
+		if (deviceHash != std::hash<std::string>{}(deviceTag))
+		{
+			spdlog::info("render graph compile cache {} was saved on other device", filename);
+			return false;
+		}
+
+		bool ok = reader.read(_key);
+		uint32_t count = 0;
+		ok = ok && reader.read(count);
+		_passes.resize(ok ? count : 0);
+		for (auto& pass : _passes)
+			ok = ok && reader.read(pass.isCulled) && reader.read(pass.queue);
+
+		ok = ok && reader.read(count);
+		_tasks.resize(ok ? count : 0);
+		for (auto& task : _tasks)
+		{
+			ok = ok && reader.read(count);
+			task.resize(ok ? count : 0);
+			for (auto& index : task)
+				ok = ok && reader.read(index) && index < _passes.size();
+		}
+
+		ok = ok && reader.read(count);
+		_order.resize(ok ? count : 0);
+		for (auto& index : _order)
+			ok = ok && reader.read(index) && index < _passes.size();
+
+		ok = ok && reader.read(count);
+		for (uint32_t i = 0; ok && i < count; ++i)
+		{
+			RenderGraphResource handle = 0;
+			TextureUsage usage = TextureUsage::Undefined;
+			ok = reader.read(handle) && reader.read(usage);
+			_usages[handle] = usage;
+		}
+
+		ok = ok && reader.read(count);
+		_allocateInfos.resize(ok ? count : 0);
+		for (auto& [desc, allocateInfo] : _allocateInfos)
+			ok = ok && readTextureDesc(reader, desc) && reader.read(allocateInfo.size) && reader.read(allocateInfo.alignment) &&
+				reader.read(allocateInfo.memoryTypeBits);
+
+		ok = ok && reader.read(_width) && reader.read(_height) && reader.read(count);
+		_placements.resize(ok ? count : 0);
+		for (auto& placement : _placements)
+			ok = ok && reader.read(placement.handle) && reader.read(placement.size) && reader.read(placement.offset);
+
+		if (!ok)
+		{
+			spdlog::warn("render graph compile cache {} is truncated", filename);
+			clear();
+			return false;
+		}
+		_loaded = true;
+		return true;
+	}
+
+	bool RenderGraphCompileCache::save(const std::string& filename, const std::string& deviceTag) const
+	{
+		CacheWriter writer;
+		writer.write(compileCacheMagic);
+		writer.write(compileCacheVersion);
+		writer.write(std::hash<std::string>{}(deviceTag));
+		writer.write(_key);
+
+		writer.write((uint32_t)_passes.size());
+		for (const auto& pass : _passes)
+		{
+			writer.write(pass.isCulled);
+			writer.write(pass.queue);
+		}
+
+		writer.write((uint32_t)_tasks.size());
+		for (const auto& task : _tasks)
+		{
+			writer.write((uint32_t)task.size());
+			for (auto index : task)
+				writer.write(index);
+		}
+
+		writer.write((uint32_t)_order.size());
+		for (auto index : _order)
+			writer.write(index);
+
+		writer.write((uint32_t)_usages.size());
+		for (const auto& [handle, usage] : _usages)
+		{
+			writer.write(handle);
+			writer.write(usage);
+		}
+
+		writer.write((uint32_t)_allocateInfos.size());
+		for (const auto& [desc, allocateInfo] : _allocateInfos)
+		{
+			writeTextureDesc(writer, desc);
+			writer.write(allocateInfo.size);
+			writer.write(allocateInfo.alignment);
+			writer.write(allocateInfo.memoryTypeBits);
+		}
+
+		writer.write(_width);
+		writer.write(_height);
+		writer.write((uint32_t)_placements.size());
+		for (const auto& placement : _placements)
+		{
+			writer.write(placement.handle);
+			writer.write(placement.size);
+			writer.write(placement.offset);
+		}
+
+		std::ofstream ofile(filename, std::ios::binary);
+		if (!ofile.is_open())
+		{
+			spdlog::error("render graph compile cache {} can not be written", filename);
+			return false;
+		}
+		ofile.write(writer.data.data(), writer.data.size());
+		return true;
+	}
+
+	void RenderGraphCompileCache::clear()
+	{
+		_loaded = false;
+		_key = 0;
+		_passes.clear();
+		_tasks.clear();
+		_order.clear();
+		_usages.clear();
+		_allocateInfos.clear();
+		_width = 0;
+		_height = 0;
+		_placements.clear();
+	}
+
+	const AllocateInfo* RenderGraphCompileCache::_findAllocateInfo(const TextureDesc& desc) const
+	{
+		for (const auto& [cachedDesc, allocateInfo] : _allocateInfos)
+		{
+			if (isSameTextureDesc(cachedDesc, desc))
+				return &allocateInfo;
+		}
+		return nullptr;
+	}
+
+	void RenderGraphCompileCache::_addAllocateInfo(const TextureDesc& desc, const AllocateInfo& allocateInfo)
+	{
+		if (_allocateInfos.size() >= _maxAllocateInfos)
+			_allocateInfos.erase(_allocateInfos.begin());
+		_allocateInfos.emplace_back(desc, allocateInfo);
+	}
+
+	const RenderGraphCompileCache::Placement* RenderGraphCompileCache::_findPlacement(RenderGraphResource handle) const
+	{
+		for (const auto& placement : _placements)
+		{
+			if (placement.handle == handle)
+				return &placement;
+		}
+		return nullptr;
+	}
+}
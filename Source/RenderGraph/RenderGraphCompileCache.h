@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BaseTypes.h"
+
+namespace kdGfx
+{
+    // 渲染图的编译结果，可以保存到文件，下次启动跳过剔除、分层、队列分配、用途推导和贴图大小查询
+    // key是图结构和资源描述的哈希，不匹配时回退到完整编译
+    // 贴图大小和队列依赖设备，保存和加载时用deviceTag区分（比如显卡名加API）
+    class RenderGraphCompileCache
+    {
+    public:
+        friend class RenderGraph;
+
+        bool load(const std::string& filename, const std::string& deviceTag);
+        bool save(const std::string& filename, const std::string& deviceTag) const;
+        void clear();
+
+        inline bool isLoaded() const { return _loaded; }
+
+    private:
+        struct Pass
+        {
+            bool isCulled = false;
+            CommandListType queue = CommandListType::General;
+        };
+        struct Placement
+        {
+            RenderGraphResource handle = 0;
+            size_t size = 0;
+            size_t offset = 0;
+        };
+
+        bool _loaded = false;
+        uint64_t _key = 0;
+        // 按Pass添加顺序
+        std::vector<Pass> _passes;
+        // 每个task的Pass序号
+        std::vector<std::vector<uint32_t>> _tasks;
+        // 执行顺序的Pass序号
+        std::vector<uint32_t> _order;
+        // 推导后的贴图用途
+        std::unordered_map<RenderGraphResource, TextureUsage> _usages;
+        // 贴图大小查询结果，只和描述有关，图变化后仍然有效
+        std::vector<std::tuple<TextureDesc, AllocateInfo>> _allocateInfos;
+        // 保存时分辨率下的内存放置
+        uint32_t _width = 0;
+        uint32_t _height = 0;
+        std::vector<Placement> _placements;
+
+    private:
+        const AllocateInfo* _findAllocateInfo(const TextureDesc& desc) const;
+        // 窗口缩放会产生很多描述，超过上限时丢弃最早的
+        void _addAllocateInfo(const TextureDesc& desc, const AllocateInfo& allocateInfo);
+        const Placement* _findPlacement(RenderGraphResource handle) const;
+        static constexpr uint32_t _maxAllocateInfos = 256;
+    };
+}
@@ -0,0 +1,153 @@
+#include "RenderGraphMemoryPlanner.h"
+
+namespace kdGfx
+{
+	void RenderGraphMemoryPlanner::addResource(RenderGraphResource handle, const AllocateInfo& info, uint32_t firstUseTask, uint32_t lastUseTask)
+	{
+		assert(!_allocationIndices.contains(handle));
+		_allocationIndices[handle] = _allocations.size();
+		_allocations.push_back({
+			.handle = handle,
+			.size = info.size,
+			.alignment = std::max<size_t>(info.alignment, 1),
+			.firstUseTask = std::min(firstUseTask, lastUseTask),
+			.lastUseTask = std::max(firstUseTask, lastUseTask),
+			.memoryTypeBits = info.memoryTypeBits,
+			.linear = info.linear
+			});
+	}
+
+	void RenderGraphMemoryPlanner::addPlacedResource(RenderGraphResource handle, const AllocateInfo& info, uint32_t firstUseTask, uint32_t lastUseTask, size_t offset)
+	{
+		addResource(handle, info, firstUseTask, lastUseTask);
+		auto& allocation = _allocations.back();
+		allocation.offset = offset;
+		allocation.placed = true;
+	}
+
+	void RenderGraphMemoryPlanner::plan(RenderGraphAliasingStrategy strategy, bool keepPlacements)
+	{
+		_peakSize = 0;
+		_totalSize = 0;
+		_memoryTypeBits = UINT32_MAX;
+		std::vector<Allocation*> order;
+		std::vector<const Allocation*> placed;
+		order.reserve(_allocations.size());
+		placed.reserve(_allocations.size());
+		for (auto& allocation : _allocations)
+		{
+			_totalSize += allocation.size;
+			_memoryTypeBits &= allocation.memoryTypeBits;
+			if (!keepPlacements)
+				allocation.placed = false;
+
+			if (allocation.placed)
+			{
+				_peakSize = std::max(_peakSize, allocation.offset + allocation.size);
+				placed.push_back(&allocation);
+			}
+			else
+			{
+				order.push_back(&allocation);
+			}
+		}
+
+		if (strategy == RenderGraphAliasingStrategy::BestFit)
+		{
+			std::stable_sort(order.begin(), order.end(), [](const Allocation* a, const Allocation* b)
+				{
+					if (a->firstUseTask != b->firstUseTask) return a->firstUseTask < b->firstUseTask;
+					return a->size > b->size;
+				});
+		}
+		else
+		{
+			// 大小相同时生命周期长的优先
+			std::stable_sort(order.begin(), order.end(), [](const Allocation* a, const Allocation* b)
+				{
+					if (a->size != b->size) return a->size > b->size;
+					uint32_t lifeA = a->lastUseTask - a->firstUseTask;
+					uint32_t lifeB = b->lastUseTask - b->firstUseTask;
+					if (lifeA != lifeB) return lifeA > lifeB;
+					return a->firstUseTask < b->firstUseTask;
+				});
+		}
+
+		for (auto allocation : order)
+		{
+			allocation->offset = _findOffset(*allocation, placed);
+			_peakSize = std::max(_peakSize, allocation->offset + allocation->size);
+			placed.push_back(allocation);
+		}
+	}
+
+	void RenderGraphMemoryPlanner::clear()
+	{
+		_allocations.clear();
+		_allocationIndices.clear();
+		_peakSize = 0;
+		_totalSize = 0;
+		_memoryTypeBits = UINT32_MAX;
+	}
+
+	size_t RenderGraphMemoryPlanner::getOffset(RenderGraphResource handle) const
+	{
+		if (auto it = _allocationIndices.find(handle); it != _allocationIndices.end())
+		{
+			return _allocations[it->second].offset;
+		}
+		assert(false);
+		return 0;
+	}
+
+	bool RenderGraphMemoryPlanner::_isOverlap(const Allocation& a, const Allocation& b) const
+	{
+		if (_overlapTest)
+			return _overlapTest(a, b);
+		return a.firstUseTask <= b.lastUseTask && b.firstUseTask <= a.lastUseTask;
+	}
+
+	size_t RenderGraphMemoryPlanner::_findOffset(const Allocation& allocation, const std::vector<const Allocation*>& placed) const
+	{
+		// 只有生命周期重叠的资源会占用地址
+		std::vector<const Allocation*> overlaps;
+		for (auto other : placed)
+		{
+			if (_isOverlap(*other, allocation))
+			{
+				overlaps.push_back(other);
+			}
+		}
+		std::sort(overlaps.begin(), overlaps.end(), [](const Allocation* a, const Allocation* b)
+			{
+				return a->offset < b->offset;
+			});
+
+		// 在占用区间之间找能容纳的最小空隙，线性和非线性资源的两侧都补齐到粒度
+		size_t bestOffset = SIZE_MAX;
+		size_t bestGap = SIZE_MAX;
+		size_t cursor = 0;
+		for (auto other : overlaps)
+		{
+			const bool padded = other->linear != allocation.linear;
+			size_t offset = MemAlign(cursor, allocation.alignment);
+			size_t end = padded ? MemAlign(offset + allocation.size, _granularity) : offset + allocation.size;
+			if (end <= other->offset)
+			{
+				size_t gap = other->offset - cursor;
+				if (gap < bestGap)
+				{
+					bestGap = gap;
+					bestOffset = offset;
+				}
+			}
+			size_t otherEnd = other->offset + other->size;
+			cursor = std::max(cursor, padded ? MemAlign(otherEnd, _granularity) : otherEnd);
+		}
+		if (bestOffset == SIZE_MAX)
+		{
+			bestOffset = MemAlign(cursor, allocation.alignment);
+		}
+		return bestOffset;
+	}
+}
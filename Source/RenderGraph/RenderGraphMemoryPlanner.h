@@ -0,0 +1,72 @@
+#pragma once
+
+#include "BaseTypes.h"
+
+namespace kdGfx
+{
+    // 内存别名放置策略
+    enum struct RenderGraphAliasingStrategy
+    {
+        // 按首次使用顺序放置，选择能容纳的最小空隙
+        BestFit,
+        // 按大小降序放置，大资源优先占据低地址
+        GreedyBySize
+    };
+
+    // 基于生命周期区间的内存别名规划
+    // 生命周期不重叠的资源可以共用同一段内存
+    class RenderGraphMemoryPlanner
+    {
+    public:
+        struct Allocation;
+        // 两个资源是否可能同时存活
+        using OverlapTest = std::function<bool(const Allocation& a, const Allocation& b)>;
+
+        struct Allocation
+        {
+            RenderGraphResource handle = 0;
+            size_t size = 0;
+            size_t alignment = 1;
+            uint32_t firstUseTask = 0;
+            uint32_t lastUseTask = 0;
+            uint32_t memoryTypeBits = UINT32_MAX;
+            bool linear = false;
+            size_t offset = 0;
+            // 沿用上次编译的位置
+            bool placed = false;
+        };
+
+        void addResource(RenderGraphResource handle, const AllocateInfo& info, uint32_t firstUseTask, uint32_t lastUseTask);
+        // 固定在offset的资源，规划时其他资源绕开它
+        void addPlacedResource(RenderGraphResource handle, const AllocateInfo& info, uint32_t firstUseTask, uint32_t lastUseTask, size_t offset);
+        // keepPlacements为false时忽略固定位置，全部重新规划
+        void plan(RenderGraphAliasingStrategy strategy, bool keepPlacements = true);
+        void clear();
+        // 默认比较task区间。多个队列同时执行时区间不重叠也可能同时存活，由调用者按队列间的同步判断
+        inline void setOverlapTest(OverlapTest overlapTest) { _overlapTest = std::move(overlapTest); }
+        // 同时存活的线性和非线性资源之间按粒度隔开
+        inline void setBufferImageGranularity(size_t granularity) { _granularity = std::max<size_t>(granularity, 1); }
+
+        size_t getOffset(RenderGraphResource handle) const;
+        inline const std::vector<Allocation>& getAllocations() const { return _allocations; }
+        // 规划后所需的内存峰值
+        inline size_t getPeakSize() const { return _peakSize; }
+        // 不做别名时所有资源大小总和
+        inline size_t getTotalSize() const { return _totalSize; }
+        // 所有资源都支持的内存类型，为0时没有能放下全部资源的内存
+        inline uint32_t getMemoryTypeBits() const { return _memoryTypeBits; }
+
+    private:
+        std::vector<Allocation> _allocations;
+        std::unordered_map<RenderGraphResource, size_t> _allocationIndices;
+        size_t _peakSize = 0;
+        size_t _totalSize = 0;
+        uint32_t _memoryTypeBits = UINT32_MAX;
+        size_t _granularity = 1;
+        OverlapTest _overlapTest;
+
+    private:
+        bool _isOverlap(const Allocation& a, const Allocation& b) const;
+        size_t _findOffset(const Allocation& allocation, const std::vector<const Allocation*>& placed) const;
+    };
+}
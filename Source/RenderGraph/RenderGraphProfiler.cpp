@@ -0,0 +1,167 @@
+#include "RenderGraphProfiler.h"
+#include <imgui/imgui.h>
+
+namespace kdGfx
+{
+	RenderGraphProfiler::RenderGraphProfiler(const std::shared_ptr<Device>& device, uint32_t frameLatency, uint32_t sampleCount) :
+		_device(device),
+		_sampleCount(std::max(sampleCount, 1u))
+	{
+		_frames.resize(std::max(frameLatency, 1u));
+		for (auto type : { CommandListType::General, CommandListType::Compute })
+		{
+			_timestampFrequencies[type] = _device->getCommandQueue(type)->getTimestampFrequency();
+		}
+	}
+
+	void RenderGraphProfiler::beginFrame(uint32_t passCount)
+	{
+		_frameIndex = (_frameIndex + 1) % _frames.size();
+		auto& frame = _frames[_frameIndex];
+		if (frame.pending)
+		{
+			_readResults(frame);
+			frame.pending = false;
+		}
+
+		// 这一帧的查询池frameLatency帧前使用，GPU已经用完，可以直接重建
+		const uint32_t capacity = frame.timestampPool ? frame.timestampPool->getDesc().count / 2 : 0;
+		if (capacity < passCount)
+		{
+			frame.timestampPool = _device->createQueryPool({ .type = QueryType::Timestamp, .count = passCount * 2, .name = "RenderGraphTimestamps" });
+			frame.statisticsPool.reset();
+			if (_device->isPipelineStatisticsSupported())
+				frame.statisticsPool = _device->createQueryPool({ .type = QueryType::PipelineStatistics, .count = passCount, .name = "RenderGraphStatistics" });
+		}
+		frame.passes.assign(passCount, {});
+		frame.pending = true;
+	}
+
+	void RenderGraphProfiler::beginPass(CommandList& commandList, const RenderGraphPassNode* pass, CommandListType queue,
+		const RenderGraphPassNode* lastPass)
+	{
+		auto& frame = _frames[_frameIndex];
+		if (pass->index >= frame.passes.size() || queue == CommandListType::Copy) return;
+
+		auto& query = frame.passes[pass->index];
+		query.name = lastPass && lastPass != pass ? fmt::format("{} ~ {}", pass->name, lastPass->name) : pass->name;
+		query.queue = queue;
+		query.recorded = true;
+		// 图形管线统计只能在主队列
+		query.hasStatistics = _statisticsEnabled && frame.statisticsPool && queue == CommandListType::General;
+
+		commandList.resetQueries(frame.timestampPool, pass->index * 2, 2);
+		if (query.hasStatistics)
+		{
+			commandList.resetQueries(frame.statisticsPool, pass->index, 1);
+			commandList.beginQuery(frame.statisticsPool, pass->index);
+		}
+		commandList.writeTimestamp(frame.timestampPool, pass->index * 2, true);
+	}
+
+	void RenderGraphProfiler::endPass(CommandList& commandList, const RenderGraphPassNode* pass)
+	{
+		auto& frame = _frames[_frameIndex];
+		if (pass->index >= frame.passes.size() || !frame.passes[pass->index].recorded) return;
+
+		commandList.writeTimestamp(frame.timestampPool, pass->index * 2 + 1);
+		commandList.resolveQueries(frame.timestampPool, pass->index * 2, 2);
+		if (frame.passes[pass->index].hasStatistics)
+		{
+			commandList.endQuery(frame.statisticsPool, pass->index);
+			commandList.resolveQueries(frame.statisticsPool, pass->index, 1);
+		}
+	}
+
+	void RenderGraphProfiler::_readResults(FrameQueries& frame)
+	{
+		float totalTime = 0.0f;
+		for (uint32_t i = 0; i < frame.passes.size(); ++i)
+		{
+			const auto& query = frame.passes[i];
+			if (!query.recorded) continue;
+
+			// 还没执行完的Pass丢弃这一帧的结果
+			uint64_t timestamps[2] = {};
+			if (!frame.timestampPool->getResults(i * 2, 2, timestamps)) continue;
+			const float time = timestamps[1] > timestamps[0] ?
+				float(double(timestamps[1] - timestamps[0]) * 1000.0 / _timestampFrequencies[query.queue]) : 0.0f;
+
+			auto [it, inserted] = _timingIndices.try_emplace(query.name, (uint32_t)_timings.size());
+			if (inserted)
+			{
+				_timings.push_back({ .name = query.name });
+				_samples.emplace_back();
+			}
+			auto& timing = _timings[it->second];
+			auto& samples = _samples[it->second];
+			samples.push_back(time);
+			if (samples.size() > _sampleCount)
+				samples.pop_front();
+
+			timing.queue = query.queue;
+			timing.lastTime = time;
+			timing.minTime = *std::min_element(samples.begin(), samples.end());
+			timing.maxTime = *std::max_element(samples.begin(), samples.end());
+			float sum = 0.0f;
+			for (float sample : samples)
+				sum += sample;
+			timing.avgTime = sum / samples.size();
+			if (query.hasStatistics)
+				frame.statisticsPool->getResults(i, 1, &timing.statistics);
+			totalTime += time;
+		}
+		_totalTime = totalTime;
+	}
+
+	void RenderGraphProfiler::drawImGui()
+	{
+		ImGui::Begin("GPU Profiler");
+		ImGui::Text("Total %.3f ms", _totalTime);
+
+		const bool showStatistics = _statisticsEnabled && _device->isPipelineStatisticsSupported();
+		const ImGuiTableFlags tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+		if (ImGui::BeginTable("Passes", showStatistics ? 9 : 6, tableFlags))
+		{
+			ImGui::TableSetupColumn("Pass");
+			ImGui::TableSetupColumn("Queue");
+			ImGui::TableSetupColumn("Last");
+			ImGui::TableSetupColumn("Min");
+			ImGui::TableSetupColumn("Avg");
+			ImGui::TableSetupColumn("Max");
+			if (showStatistics)
+			{
+				ImGui::TableSetupColumn("Primitives");
+				ImGui::TableSetupColumn("PS");
+				ImGui::TableSetupColumn("CS");
+			}
+			ImGui::TableHeadersRow();
+
+			static const char* queueNames[] = { "General", "Compute", "Copy" };
+			for (const auto& timing : _timings)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(timing.name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(queueNames[(uint32_t)timing.queue]);
+				for (float time : { timing.lastTime, timing.minTime, timing.avgTime, timing.maxTime })
+				{
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", time);
+				}
+				if (showStatistics)
+				{
+					const auto& statistics = timing.statistics;
+					for (uint64_t value : { statistics.clippingPrimitives, statistics.pixelShaderInvocations, statistics.computeShaderInvocations })
+					{
+						ImGui::TableNextColumn();
+						ImGui::Text("%llu", (unsigned long long)value);
+					}
+				}
+			}
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "BaseTypes.h"
+
+namespace kdGfx
+{
+    // 单个Pass最近若干帧的GPU耗时，单位毫秒
+    struct RenderGraphPassTiming
+    {
+        std::string name;
+        CommandListType queue = CommandListType::General;
+        float lastTime = 0.0f;
+        float minTime = 0.0f;
+        float avgTime = 0.0f;
+        float maxTime = 0.0f;
+        // 只统计主队列的Pass
+        PipelineStatistics statistics;
+    };
+
+    // 每个Pass前后写入时间戳，frameLatency帧后再读取，不等待GPU
+    // 复制队列的Pass不统计
+    class RenderGraphProfiler
+    {
+    public:
+        // frameLatency需要大于同时在GPU上执行的帧数，sampleCount是统计最大最小平均的帧数
+        RenderGraphProfiler(const std::shared_ptr<Device>& device, uint32_t frameLatency = MaxFrameLatency, uint32_t sampleCount = 120);
+
+        // 渲染图每次执行前调用，读取最早一帧的结果
+        void beginFrame(uint32_t passCount);
+        // queue是命令列表所在的队列，不同Pass可以在多个线程同时调用
+        // 合并成一个RenderPass的Pass从pass到lastPass一起统计，endPass传入第一个Pass
+        void beginPass(CommandList& commandList, const RenderGraphPassNode* pass, CommandListType queue,
+            const RenderGraphPassNode* lastPass = nullptr);
+        void endPass(CommandList& commandList, const RenderGraphPassNode* pass);
+        // ImGui窗口显示各Pass耗时
+        void drawImGui();
+
+        inline const std::vector<RenderGraphPassTiming>& getPassTimings() const { return _timings; }
+        // 最近一帧所有Pass耗时的和，多队列重叠执行时大于实际帧时间
+        inline float getTotalTime() const { return _totalTime; }
+        inline void setPipelineStatisticsEnabled(bool enable) { _statisticsEnabled = enable; }
+
+    private:
+        // 按Pass索引存放，读取时Pass可能已经销毁，记录名字
+        struct PassQuery
+        {
+            std::string name;
+            CommandListType queue = CommandListType::General;
+            bool recorded = false;
+            bool hasStatistics = false;
+        };
+        struct FrameQueries
+        {
+            std::shared_ptr<QueryPool> timestampPool;
+            std::shared_ptr<QueryPool> statisticsPool;
+            std::vector<PassQuery> passes;
+            bool pending = false;
+        };
+
+        std::shared_ptr<Device> _device;
+        std::vector<FrameQueries> _frames;
+        uint32_t _frameIndex = 0;
+        uint32_t _sampleCount = 0;
+        bool _statisticsEnabled = true;
+        std::unordered_map<CommandListType, uint64_t> _timestampFrequencies;
+        std::vector<RenderGraphPassTiming> _timings;
+        std::vector<std::deque<float>> _samples;
+        std::unordered_map<std::string, uint32_t> _timingIndices;
+        float _totalTime = 0.0f;
+
+    private:
+        void _readResults(FrameQueries& frame);
+    };
+}
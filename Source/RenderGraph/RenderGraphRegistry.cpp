@@ -54,48 +54,102 @@ namespace kdGfx
 			auto& entry = it->second;
 			std::get<0>(entry) = texture;
 			std::get<1>(entry) = textureView;
+			// 新贴图按Pass声明的范围重建视图
+			if (_graph._compiled)
+				_graph._createRangeViews(handle);
 		}
 	}
 
-	std::shared_ptr<Buffer> RenderGraphRegistry::getBuffer(RenderGraphResource handle)
+	RenderGraphResource RenderGraphRegistry::_createHistoryTexture(RenderGraphResource handle)
 	{
-		if (_buffersMap.contains(handle))	return std::get<1>(_buffersMap[handle]);
-		if (_importBuffersMap.contains(handle))	return _importBuffersMap[handle];
+		if (auto it = _historyTexturesMap.find(handle); it != _historyTexturesMap.end())	return it->second.handle;
+
+		auto resourceEdge = _graph._getResourceEdge(handle);
+		if (!resourceEdge || !_texturesMap.contains(handle))
+		{
+			spdlog::error("render graph {} history only supports created textures", _graph.name);
+			return 0;
+		}
+
+		RenderGraphResource index = ++_resourcesCount;
+		_historyTexturesMap[handle].handle = index;
+		_historySourcesMap[index] = handle;
+		auto historyEdge = _graph._createResourceEdge(fmt::format("{} History", resourceEdge->name), index);
+		historyEdge->historySource = resourceEdge;
+		return index;
+	}
+
+	void RenderGraphRegistry::_advanceHistory()
+	{
+		_historyFrame++;
+		for (auto& [handle, history] : _historyTexturesMap)
+		{
+			// 这一帧写入Pass都被跳过时，当前版本没有内容
+			auto resEdge = _graph._getResourceEdge(handle);
+			const bool written = resEdge && std::any_of(resEdge->producers.begin(), resEdge->producers.end(),
+				[](RenderGraphPassNode* producer) { return !producer->isCulled && producer->isEnabled; });
+			history.valid = !history.versions.empty() && written;
+		}
+	}
+
+	std::shared_ptr<Buffer> RenderGraphRegistry::getBuffer(RenderGraphResource handle) const
+	{
+		if (auto it = _buffersMap.find(handle); it != _buffersMap.end())	return std::get<1>(it->second);
+		if (auto it = _importBuffersMap.find(handle); it != _importBuffersMap.end())	return it->second;
 		return nullptr;
 	}
 
-	std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>> RenderGraphRegistry::getTexture(RenderGraphResource handle)
+	std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>> RenderGraphRegistry::getTexture(RenderGraphResource handle) const
 	{
-		if (_texturesMap.contains(handle))
+		if (auto it = _historySourcesMap.find(handle); it != _historySourcesMap.end())
+		{
+			const auto& versions = _historyTexturesMap.at(it->second).versions;
+			if (versions.empty())	return std::make_tuple(nullptr, nullptr);
+			return versions[(_historyFrame + versions.size() - 1) % versions.size()];
+		}
+		if (auto it = _historyTexturesMap.find(handle); it != _historyTexturesMap.end())
 		{
-			return std::make_tuple(std::get<2>(_texturesMap[handle]), std::get<3>(_texturesMap[handle]));
+			const auto& versions = it->second.versions;
+			if (versions.empty())	return std::make_tuple(nullptr, nullptr);
+			return versions[_historyFrame % versions.size()];
 		}
-		if (_importTexturesMap.contains(handle))	return _importTexturesMap[handle];
+		if (auto it = _texturesMap.find(handle); it != _texturesMap.end())
+		{
+			return std::make_tuple(std::get<2>(it->second), std::get<3>(it->second));
+		}
+		if (auto it = _importTexturesMap.find(handle); it != _importTexturesMap.end())	return it->second;
 		return std::make_tuple(nullptr, nullptr);
 	}
 
+	std::shared_ptr<TextureView> RenderGraphRegistry::getTextureView(RenderGraphResource handle, const TextureViewDesc& range) const
+	{
+		auto texture = std::get<0>(getTexture(handle));
+		if (!texture)	return nullptr;
+		auto it = _rangeViewsMap.find(texture.get());
+		if (it == _rangeViewsMap.end() || it->second.texture.lock() != texture)	return nullptr;
+		for (const auto& [viewRange, textureView] : it->second.views)
+		{
+			if (isSameSubresourceRange(viewRange, range))	return textureView;
+		}
+		return nullptr;
+	}
+
+	bool RenderGraphRegistry::isHistoryValid(RenderGraphResource handle) const
+	{
+		if (auto it = _historySourcesMap.find(handle); it != _historySourcesMap.end())	handle = it->second;
+		auto it = _historyTexturesMap.find(handle);
+		return it != _historyTexturesMap.end() && it->second.valid;
+	}
+
 	void RenderGraphRegistry::destroy()
 	{
 		_buffersMap.clear();
 		_texturesMap.clear();
+		_historyTexturesMap.clear();
+		_historySourcesMap.clear();
 
 		_importBuffersMap.clear();
 		_importTexturesMap.clear();
-	}
-
-	void RenderGraphRegistry::resize(uint32_t width, uint32_t height)
-	{
-		for (auto& texturePair : _texturesMap)
-		{
-			auto writer = _graph._getResourceEdge(texturePair.first)->producer;
-			if (writer->type == RenderGraphPassType::FrameRaster || writer->type == RenderGraphPassType::FrameCompute)
-			{
-				auto& [textureDesc, size, texture, textureView] = texturePair.second;
-				textureDesc.width = width;
-				textureDesc.height = height;
-				texture = _graph._device->createTexture(textureDesc);
-				textureView = texture->createView({});
-			}
-		}
+		_rangeViewsMap.clear();
 	}
 }
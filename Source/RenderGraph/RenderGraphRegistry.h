@@ -21,10 +21,14 @@ namespace kdGfx
         RenderGraphResource importTexture(const std::shared_ptr<Texture>& texture, const std::shared_ptr<TextureView>& textureView, const std::string_view name);
         void setImportedTexture(RenderGraphResource handle, const std::shared_ptr<Texture>& texture, const std::shared_ptr<TextureView>& textureView);
 
-        std::shared_ptr<Buffer> getBuffer(RenderGraphResource handle);
-        std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>> getTexture(RenderGraphResource handle);
+        // 查询不修改注册表，执行期间可以多线程调用
+        std::shared_ptr<Buffer> getBuffer(RenderGraphResource handle) const;
+        std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>> getTexture(RenderGraphResource handle) const;
+        // Pass按范围读写的贴图视图，编译时创建。没有按这个范围声明读写时返回null
+        std::shared_ptr<TextureView> getTextureView(RenderGraphResource handle, const TextureViewDesc& range) const;
+        // 历史贴图是否已经写入过内容，第一帧和重建后无效。资源和它的历史都可以查询
+        bool isHistoryValid(RenderGraphResource handle) const;
         void destroy();
-        void resize(uint32_t width, uint32_t height);
 
     private:
         RenderGraph& _graph;
@@ -33,5 +37,30 @@ namespace kdGfx
         std::unordered_map<RenderGraphResource, std::tuple<TextureDesc, size_t, std::shared_ptr<Texture>, std::shared_ptr<TextureView>>> _texturesMap;
         std::unordered_map<RenderGraphResource, std::shared_ptr<Buffer>> _importBuffersMap;
         std::unordered_map<RenderGraphResource, std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>>> _importTexturesMap;
+        // 需要保留历史的贴图，多个版本每帧轮换，当前帧写入的版本下一帧作为历史读取
+        struct HistoryTexture
+        {
+            RenderGraphResource handle = 0;
+            TextureDesc desc;
+            std::vector<std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>>> versions;
+            bool valid = false;
+        };
+        std::unordered_map<RenderGraphResource, HistoryTexture> _historyTexturesMap;
+        // 历史资源到当前帧资源
+        std::unordered_map<RenderGraphResource, RenderGraphResource> _historySourcesMap;
+        uint32_t _historyVersions = 2;
+        uint64_t _historyFrame = 0;
+        // 按贴图索引的范围视图，贴图重建后失效
+        struct RangeViews
+        {
+            std::weak_ptr<Texture> texture;
+            std::vector<std::tuple<TextureViewDesc, std::shared_ptr<TextureView>>> views;
+        };
+        std::unordered_map<const Texture*, RangeViews> _rangeViewsMap;
+
+    private:
+        RenderGraphResource _createHistoryTexture(RenderGraphResource handle);
+        // 每次执行后轮换版本
+        void _advanceHistory();
     };
 }
@@ -0,0 +1,239 @@
+#include "RenderGraphResourcePool.h"
+
+namespace kdGfx
+{
+	RenderGraphResourcePool::RenderGraphResourcePool(const std::shared_ptr<Device>& device, size_t budget, uint32_t frameLatency) :
+		_device(device),
+		_budget(budget),
+		_frameLatency(frameLatency)
+	{
+	}
+
+	RenderGraphResourcePool::~RenderGraphResourcePool()
+	{
+		_buffers.clear();
+		_memories.clear();
+		_device.reset();
+	}
+
+	void RenderGraphResourcePool::beginFrame()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_frame++;
+		_evict(_budget);
+	}
+
+	std::shared_ptr<Memory> RenderGraphResourcePool::acquireMemory(size_t size, const std::string& name, uint32_t memoryTypeBits)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		// 选择能容纳的最小空闲内存
+		MemoryEntry* bestEntry = nullptr;
+		for (auto& entry : _memories)
+		{
+			const size_t memorySize = entry.memory->getDesc().size;
+			if (entry.inUse || !_isRetired(entry.lastUsedFrame) || memorySize < size || memorySize > size * 2) continue;
+			// 创建时允许的内存类型都在要求之内，实际选择的类型一定满足
+			if (entry.memory->getDesc().memoryTypeBits & ~memoryTypeBits) continue;
+			if (!bestEntry || memorySize < bestEntry->memory->getDesc().size)
+				bestEntry = &entry;
+		}
+		if (bestEntry)
+		{
+			bestEntry->inUse = true;
+			bestEntry->lastUsedFrame = _frame;
+			_stats.hits++;
+			return bestEntry->memory;
+		}
+
+		MemoryEntry entry;
+		entry.memory = _device->createMemory({ .size = size, .memoryTypeBits = memoryTypeBits, .name = name });
+		entry.inUse = true;
+		entry.lastUsedFrame = _frame;
+		_memories.push_back(entry);
+		_allocatedSize += size;
+		_stats.misses++;
+		spdlog::info("render graph resource pool alloc memory size {} (total {})", size, _allocatedSize);
+
+		_evict(_budget);
+		return entry.memory;
+	}
+
+	void RenderGraphResourcePool::releaseMemory(const std::shared_ptr<Memory>& memory)
+	{
+		if (!memory) return;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& entry : _memories)
+		{
+			if (entry.memory != memory) continue;
+			entry.inUse = false;
+			entry.lastUsedFrame = _frame;
+			for (auto& textureEntry : entry.textures)
+			{
+				if (textureEntry.inUse)
+					textureEntry.lastUsedFrame = _frame;
+				textureEntry.inUse = false;
+			}
+			return;
+		}
+	}
+
+	std::shared_ptr<Texture> RenderGraphResourcePool::acquireTexture(const TextureDesc& desc, const std::shared_ptr<Memory>& memory, size_t offset)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto memoryIt = std::find_if(_memories.begin(), _memories.end(),
+			[&memory](const MemoryEntry& entry) { return entry.memory == memory; });
+		if (memoryIt == _memories.end())
+		{
+			spdlog::error("render graph resource pool acquire texture {} on memory not from pool", desc.name);
+			return _device->createTexture(desc, memory, offset);
+		}
+
+		for (auto& entry : memoryIt->textures)
+		{
+			if (entry.inUse || !_isRetired(entry.lastUsedFrame) || entry.offset != offset || !isSameTextureDesc(entry.texture->getDesc(), desc)) continue;
+			entry.inUse = true;
+			entry.lastUsedFrame = _frame;
+			// 内存可能被其他贴图写过，布局已经失效
+			entry.texture->setState(TextureState::Undefined);
+			_stats.hits++;
+			return entry.texture;
+		}
+
+		// 空闲贴图太多时删除最久没用的，只删除GPU已经用完的
+		auto& textures = memoryIt->textures;
+		size_t idleCount = std::count_if(textures.begin(), textures.end(), [](const TextureEntry& entry) { return !entry.inUse; });
+		while (idleCount >= _maxIdleTextures)
+		{
+			auto oldestIt = textures.end();
+			for (auto it = textures.begin(); it != textures.end(); ++it)
+			{
+				if (it->inUse || !_isRetired(it->lastUsedFrame)) continue;
+				if (oldestIt == textures.end() || it->lastUsedFrame < oldestIt->lastUsedFrame)
+					oldestIt = it;
+			}
+			if (oldestIt == textures.end()) break;
+			textures.erase(oldestIt);
+			idleCount--;
+		}
+
+		TextureEntry entry;
+		entry.texture = _device->createTexture(desc, memory, offset);
+		entry.offset = offset;
+		entry.inUse = true;
+		entry.lastUsedFrame = _frame;
+		textures.push_back(entry);
+		_stats.misses++;
+		return entry.texture;
+	}
+
+	void RenderGraphResourcePool::releaseTexture(const std::shared_ptr<Texture>& texture)
+	{
+		if (!texture) return;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& memoryEntry : _memories)
+		{
+			for (auto& entry : memoryEntry.textures)
+			{
+				if (entry.texture == texture)
+				{
+					entry.inUse = false;
+					entry.lastUsedFrame = _frame;
+					return;
+				}
+			}
+		}
+	}
+
+	std::shared_ptr<Buffer> RenderGraphResourcePool::acquireBuffer(const BufferDesc& desc)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& entry : _buffers)
+		{
+			if (entry.inUse || !_isRetired(entry.lastUsedFrame) || !isSameBufferDesc(entry.buffer->getDesc(), desc)) continue;
+			entry.inUse = true;
+			entry.lastUsedFrame = _frame;
+			_stats.hits++;
+			return entry.buffer;
+		}
+
+		BufferEntry entry;
+		entry.buffer = _device->createBuffer(desc);
+		entry.inUse = true;
+		entry.lastUsedFrame = _frame;
+		_buffers.push_back(entry);
+		_allocatedSize += desc.size;
+		_stats.misses++;
+
+		_evict(_budget);
+		return entry.buffer;
+	}
+
+	void RenderGraphResourcePool::releaseBuffer(const std::shared_ptr<Buffer>& buffer)
+	{
+		if (!buffer) return;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& entry : _buffers)
+		{
+			if (entry.buffer != buffer) continue;
+			entry.inUse = false;
+			entry.lastUsedFrame = _frame;
+			return;
+		}
+	}
+
+	void RenderGraphResourcePool::trim()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_evict(0);
+	}
+
+	void RenderGraphResourcePool::_evict(size_t budget)
+	{
+		while (_allocatedSize > budget)
+		{
+			// 找最久没有使用并且GPU已经用完的空闲资源
+			MemoryEntry* oldestMemory = nullptr;
+			BufferEntry* oldestBuffer = nullptr;
+			uint64_t oldestFrame = UINT64_MAX;
+			for (auto& entry : _memories)
+			{
+				if (entry.inUse || !_isRetired(entry.lastUsedFrame)) continue;
+				if (entry.lastUsedFrame < oldestFrame)
+				{
+					oldestFrame = entry.lastUsedFrame;
+					oldestMemory = &entry;
+				}
+			}
+			for (auto& entry : _buffers)
+			{
+				if (entry.inUse || !_isRetired(entry.lastUsedFrame)) continue;
+				if (entry.lastUsedFrame < oldestFrame)
+				{
+					oldestFrame = entry.lastUsedFrame;
+					oldestBuffer = &entry;
+					oldestMemory = nullptr;
+				}
+			}
+
+			if (oldestBuffer)
+			{
+				_allocatedSize -= oldestBuffer->buffer->getSize();
+				_buffers.erase(_buffers.begin() + (oldestBuffer - _buffers.data()));
+			}
+			else if (oldestMemory)
+			{
+				_allocatedSize -= oldestMemory->memory->getDesc().size;
+				_memories.erase(_memories.begin() + (oldestMemory - _memories.data()));
+			}
+			else
+			{
+				// 剩下的都在使用中或可能还在GPU上，暂时超出预算
+				break;
+			}
+			_stats.evictions++;
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "BaseTypes.h"
+#include <mutex>
+
+namespace kdGfx
+{
+    // 设备级的临时资源池，多个渲染图和多次编译之间复用内存、贴图和buffer
+    // 归还的资源保留在池中，超出预算时按最近最少使用回收
+    class RenderGraphResourcePool
+    {
+    public:
+        struct Stats
+        {
+            uint32_t hits = 0;
+            uint32_t misses = 0;
+            uint32_t evictions = 0;
+        };
+
+        // frameLatency帧之前归还的资源GPU一定已经用完，才允许复用和销毁
+        RenderGraphResourcePool(const std::shared_ptr<Device>& device, size_t budget = 256ull << 20, uint32_t frameLatency = MaxFrameLatency);
+        ~RenderGraphResourcePool();
+
+        // 每帧调用一次，推进帧计数并回收超出预算的资源
+        void beginFrame();
+        // 返回不小于size的内存，大小超过两倍的空闲内存不复用，memoryTypeBits之外的内存类型不复用
+        // 归还不满frameLatency帧的资源不参与复用，以下acquire相同
+        std::shared_ptr<Memory> acquireMemory(size_t size, const std::string& name = "", uint32_t memoryTypeBits = UINT32_MAX);
+        // 归还内存，放置在上面的贴图需要先归还
+        void releaseMemory(const std::shared_ptr<Memory>& memory);
+        // 放置在池内存上的贴图，同一位置同一描述的贴图直接复用，复用的贴图内容不保留
+        std::shared_ptr<Texture> acquireTexture(const TextureDesc& desc, const std::shared_ptr<Memory>& memory, size_t offset);
+        void releaseTexture(const std::shared_ptr<Texture>& texture);
+        std::shared_ptr<Buffer> acquireBuffer(const BufferDesc& desc);
+        void releaseBuffer(const std::shared_ptr<Buffer>& buffer);
+        // 回收所有可以安全销毁的空闲资源
+        void trim();
+
+        inline void setBudget(size_t budget)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _budget = budget;
+        }
+        inline size_t getBudget() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _budget;
+        }
+        // 池创建的内存和buffer总大小
+        inline size_t getAllocatedSize() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _allocatedSize;
+        }
+        inline Stats getStats() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _stats;
+        }
+
+    private:
+        struct TextureEntry
+        {
+            std::shared_ptr<Texture> texture;
+            size_t offset = 0;
+            bool inUse = false;
+            uint64_t lastUsedFrame = 0;
+        };
+        struct MemoryEntry
+        {
+            std::shared_ptr<Memory> memory;
+            std::vector<TextureEntry> textures;
+            bool inUse = false;
+            uint64_t lastUsedFrame = 0;
+        };
+        struct BufferEntry
+        {
+            std::shared_ptr<Buffer> buffer;
+            bool inUse = false;
+            uint64_t lastUsedFrame = 0;
+        };
+
+        std::shared_ptr<Device> _device;
+        mutable std::mutex _mutex;
+        std::vector<MemoryEntry> _memories;
+        std::vector<BufferEntry> _buffers;
+        size_t _budget = 0;
+        size_t _allocatedSize = 0;
+        uint32_t _frameLatency = 0;
+        uint64_t _frame = 0;
+        Stats _stats;
+
+    private:
+        void _evict(size_t budget);
+        // 空闲资源归还后已经过了frameLatency帧
+        inline bool _isRetired(uint64_t lastUsedFrame) const { return lastUsedFrame + _frameLatency <= _frame; }
+        // 每块内存上缓存的空闲贴图数量上限
+        static constexpr uint32_t _maxIdleTextures = 64;
+    };
+}
@@ -1,6 +1,6 @@
 #include "Scene.h"
 #include "Project.h"
-#include "StagingBuffer.h"
+#include "UploadRing.h"
 #include "ImageProcessor.h"
 #include "MipMapsGen.h"
 
@@ -63,6 +63,10 @@ namespace kdGfx
 			Project::singleton()->eventTower.dispatchEvent(EventNodesChanged);
 			_dirty = false;
 		}
+
+		// 之后主队列上的渲染等待这一帧的上传
+		auto& uploadRing = UploadRing::singleton();
+		uploadRing.acquire(uploadRing.flush());
 	}
 
 	void Scene::traverseNodes(std::function<void(Node* node)> processNode, Node* node)
@@ -391,14 +395,14 @@ namespace kdGfx
 		verticesBufferDesc.usage = BufferUsage::Vertex | BufferUsage::Storage | BufferUsage::CopyDst;
 		verticesBufferDesc.name = "Vertices";
 		verticesBuffer = _device->createBuffer(verticesBufferDesc);
-		StagingBuffer::getUploadGlobal().uploadBuffer(verticesBuffer, mergedVertices.data(), verticesBufferDesc.size);
+		UploadRing::singleton().uploadBuffer(verticesBuffer, mergedVertices.data(), verticesBufferDesc.size, 0, BufferState::VertexIndex);
 
 		BufferDesc indicesBufferDesc;
 		indicesBufferDesc.size = sizeof(uint32_t) * mergedIndices.size();
 		indicesBufferDesc.usage = BufferUsage::Index | BufferUsage::Storage | BufferUsage::CopyDst;
 		indicesBufferDesc.name = "Indices";
 		indicesBuffer = _device->createBuffer(indicesBufferDesc);
-		StagingBuffer::getUploadGlobal().uploadBuffer(indicesBuffer, mergedIndices.data(), indicesBufferDesc.size);
+		UploadRing::singleton().uploadBuffer(indicesBuffer, mergedIndices.data(), indicesBufferDesc.size, 0, BufferState::VertexIndex);
 	}
 
 	void Scene::_uploadImages()
@@ -417,12 +421,32 @@ namespace kdGfx
 			desc.mipLevels = image->genMipmap ? fitMipLevel : 1;
 			image->texture = _device->createTexture(desc);
 			image->textureView = image->texture->createView({ .levelCount = desc.mipLevels });
-			StagingBuffer::getUploadGlobal().uploadTexture(image->texture, image->data.data(), image->data.size());
-			if (image->isSrgb)	ImageProcessor::singleton().process({ .gamma = 2.2f }, image->texture, 0);
-			if (image->genMipmap) MipMapsGen::singleton().generate(image->texture);
+			UploadRing::singleton().uploadTexture(image->texture, image->data.data(), image->data.size());
+		}
+
+		// 所有贴图一次提交，主队列等待上传完成后再做后处理
+		auto& uploadRing = UploadRing::singleton();
+		uploadRing.acquire(uploadRing.flush());
+		// 所有贴图的后处理和mipmap记录到一个命令列表，只提交和等待一次
+		auto commandList = _device->createCommandList(CommandListType::General);
+		ImageProcessor::Recording processRecording;
+		MipMapsGen::Recording mipMapsRecording;
+		commandList->begin();
+		for (auto& image : images)
+		{
+			if (!image->dirty)	continue;
+			if (image->isSrgb)	ImageProcessor::singleton().process(*commandList, { .gamma = 2.2f }, image->texture, processRecording, 0);
+			if (image->genMipmap) MipMapsGen::singleton().generate(*commandList, image->texture, mipMapsRecording);
 			image->data.clear();
 			image->dirty = false;
 		}
+		commandList->end();
+		if (!processRecording.bindSets.empty() || !mipMapsRecording.bindSets.empty())
+		{
+			auto queue = _device->getCommandQueue(CommandListType::General);
+			queue->submit({ commandList });
+			queue->waitIdle();
+		}
 		auto endTime = std::chrono::steady_clock::now();
 		std::chrono::duration<float> timeDura = endTime - startTime;
 		spdlog::info("scene upload images cost {}s", timeDura.count());
@@ -447,7 +471,7 @@ namespace kdGfx
 		desc.usage = BufferUsage::Storage | BufferUsage::CopyDst;
 		desc.name = "Materials";
 		materialsBuffer = _device->createBuffer(desc);
-		StagingBuffer::getUploadGlobal().uploadBuffer(materialsBuffer, materialGPUs.data(), materialsBuffer->getSize());
+		UploadRing::singleton().uploadBuffer(materialsBuffer, materialGPUs.data(), materialsBuffer->getSize());
 
 		for (auto& material : materials)	material->dirty = false;
 	}
@@ -505,7 +529,7 @@ namespace kdGfx
 			desc.usage = BufferUsage::Storage | BufferUsage::CopyDst;
 			desc.name = "Scene-Instances";
 			instancesBuffer = _device->createBuffer(desc);
-			StagingBuffer::getUploadGlobal().uploadBuffer(instancesBuffer, instances.data(), instancesBuffer->getSize());
+			UploadRing::singleton().uploadBuffer(instancesBuffer, instances.data(), instancesBuffer->getSize());
 		}
 
 		lightsBuffer.reset();
@@ -517,7 +541,7 @@ namespace kdGfx
 			desc.usage = BufferUsage::Storage | BufferUsage::CopyDst;
 			desc.name = "Scene-Lights";
 			lightsBuffer = _device->createBuffer(desc);
-			StagingBuffer::getUploadGlobal().uploadBuffer(lightsBuffer, lights.data(), lightsBuffer->getSize());
+			UploadRing::singleton().uploadBuffer(lightsBuffer, lights.data(), lightsBuffer->getSize());
 		}
 
 		drawCommandsBuffer.reset();
@@ -529,7 +553,7 @@ namespace kdGfx
 			desc.usage = BufferUsage::Storage | BufferUsage::Indirect | BufferUsage::CopyDst;
 			desc.name = "Scene-DrawCommands";
 			drawCommandsBuffer = _device->createBuffer(desc);
-			StagingBuffer::getUploadGlobal().uploadBuffer(drawCommandsBuffer, drawCommands.data(), drawCommandsBuffer->getSize());
+			UploadRing::singleton().uploadBuffer(drawCommandsBuffer, drawCommands.data(), drawCommandsBuffer->getSize(), 0, BufferState::Indirect);
 		}
 		drawCommandCount = drawCommands.size();
 	}
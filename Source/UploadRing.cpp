@@ -0,0 +1,312 @@
+#include "UploadRing.h"
+
+namespace kdGfx
+{
+	static UploadRing gUploadRing;
+
+	// 上传后第一次使用buffer的状态
+	inline static BufferState getUploadedBufferState(BufferUsage usage)
+	{
+		if (usage & (BufferUsage::Vertex | BufferUsage::Index))
+			return BufferState::VertexIndex;
+		if (usage & BufferUsage::Indirect)
+			return BufferState::Indirect;
+		if (usage & BufferUsage::Constant)
+			return BufferState::Constant;
+		return BufferState::ShaderRead;
+	}
+
+	// 使用这个状态的管线阶段
+	inline static PipelineStage getUploadedBufferStage(BufferState state)
+	{
+		switch (state)
+		{
+		case BufferState::VertexIndex:
+			return PipelineStage::VertexInput;
+		case BufferState::Indirect:
+			return PipelineStage::DrawIndirect;
+		default:
+			return PipelineStage::AllCommands;
+		}
+	}
+
+	void UploadRing::initSingleton(BackendType backend, const std::shared_ptr<Device>& device, size_t capacity)
+	{
+		gUploadRing._backend = backend;
+		gUploadRing._device = device;
+		// dx12复制队列复制贴图需要General状态。vulkan有独立的传输队列族时在传输队列复制，再转移所有权到主队列
+		gUploadRing._ownershipTransfer = backend == BackendType::Vulkan &&
+			device->getCommandQueue(CommandListType::Copy) != device->getCommandQueue(CommandListType::General);
+		gUploadRing._queueType = (backend == BackendType::DirectX12 || gUploadRing._ownershipTransfer) ?
+			CommandListType::Copy : CommandListType::General;
+		gUploadRing._capacity = capacity;
+		gUploadRing._buffer = device->createBuffer
+		({
+			.size = capacity,
+			.usage = BufferUsage::CopySrc,
+			.hostVisible = HostVisible::Upload,
+			.name = "Upload Ring"
+		});
+		gUploadRing._mappedPtr = static_cast<uint8_t*>(gUploadRing._buffer->map());
+		gUploadRing._fence = device->createFence(0);
+	}
+
+	void UploadRing::destroySingleton()
+	{
+		if (!gUploadRing._device) return;
+
+		gUploadRing.wait(gUploadRing.flush());
+		gUploadRing._inFlight.clear();
+		gUploadRing._allocations.clear();
+		gUploadRing._head = 0;
+		gUploadRing._submittedToken = 0;
+		gUploadRing._acquiredToken = 0;
+		gUploadRing._mappedPtr = nullptr;
+		gUploadRing._buffer.reset();
+		gUploadRing._fence.reset();
+		gUploadRing._device.reset();
+	}
+
+	UploadRing& UploadRing::singleton()
+	{
+		return gUploadRing;
+	}
+
+	UploadToken UploadRing::uploadBuffer(const std::shared_ptr<Buffer>& buffer, const void* data, size_t size, size_t dstOffset,
+		BufferState state)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto [srcBuffer, srcOffset] = _allocate(size);
+		memcpy(static_cast<uint8_t*>(srcBuffer->map()) + srcOffset, data, size);
+		_getCommandList().copyBuffer(srcBuffer, buffer, size, srcOffset, dstOffset);
+		if (_ownershipTransfer && std::none_of(_recording.bufferTransfers.begin(), _recording.bufferTransfers.end(),
+			[&buffer](const BufferBarrierDesc& desc) { return desc.buffer == buffer; }))
+		{
+			if (state == BufferState::Undefined)
+				state = getUploadedBufferState(buffer->getDesc().usage);
+			_recording.bufferTransfers.push_back
+			({
+				.buffer = buffer,
+				.oldState = BufferState::CopyDst,
+				.newState = state,
+				.srcQueue = CommandListType::Copy,
+				.dstQueue = CommandListType::General,
+				.srcStage = PipelineStage::Copy,
+				.dstStage = getUploadedBufferStage(state)
+			});
+		}
+		return _recording.token;
+	}
+
+	UploadToken UploadRing::uploadTexture(const std::shared_ptr<Texture>& texture, const void* data, size_t size)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto [srcBuffer, srcOffset] = _allocate(size);
+		memcpy(static_cast<uint8_t*>(srcBuffer->map()) + srcOffset, data, size);
+
+		auto& commandList = _getCommandList();
+		if (_backend == BackendType::Vulkan)
+		{
+			commandList.resourceBarrier
+			({
+				.texture = texture,
+				.oldState = TextureState::Undefined,
+				.newState = TextureState::CopyDst,
+				.subRange = { 0, texture->getDesc().mipLevels, 0, 1 }
+			});
+		}
+		commandList.copyBufferToTexture(srcBuffer, texture, 0, srcOffset);
+		if (_ownershipTransfer)
+		{
+			// 布局在释放和获取之间切换
+			_recording.textureTransfers.push_back
+			({
+				.texture = texture,
+				.oldState = TextureState::CopyDst,
+				.newState = TextureState::ShaderRead,
+				.subRange = { 0, texture->getDesc().mipLevels, 0, 1 },
+				.srcQueue = CommandListType::Copy,
+				.dstQueue = CommandListType::General,
+				.srcStage = PipelineStage::Copy
+			});
+		}
+		else if (_backend == BackendType::Vulkan)
+		{
+			commandList.resourceBarrier
+			({
+				.texture = texture,
+				.oldState = TextureState::CopyDst,
+				.newState = TextureState::ShaderRead,
+				.subRange = { 0, texture->getDesc().mipLevels, 0, 1 }
+			});
+		}
+		return _recording.token;
+	}
+
+	UploadToken UploadRing::flush()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _flush();
+	}
+
+	bool UploadRing::isComplete(UploadToken token)
+	{
+		return token == 0 || _fence->getCompletedValue() >= token;
+	}
+
+	void UploadRing::wait(UploadToken token)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (token > _submittedToken)
+				_flush();
+		}
+		if (!isComplete(token))
+			_fence->wait(token);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_acquire(token, false);
+	}
+
+	void UploadRing::acquire(UploadToken token)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (token > _submittedToken)
+			_flush();
+		_acquire(token, true);
+	}
+
+	std::tuple<std::shared_ptr<Buffer>, size_t> UploadRing::_allocate(size_t size)
+	{
+		const size_t alignedSize = (size + _alignment - 1) & ~(_alignment - 1);
+		if (alignedSize > _capacity)
+		{
+			auto buffer = _device->createBuffer
+			({
+				.size = size,
+				.usage = BufferUsage::CopySrc,
+				.hostVisible = HostVisible::Upload,
+				.name = "Upload Ring Overflow"
+			});
+			_recording.buffers.push_back(buffer);
+			return { buffer, 0 };
+		}
+
+		size_t offset = 0;
+		while (true)
+		{
+			_retire();
+			if (_allocations.empty())
+			{
+				_head = 0;
+				break;
+			}
+			// 已用区间是[tail, head)，或者绕回后的[tail, capacity)和[0, head)
+			const size_t tail = _allocations.front().offset;
+			if (_head >= tail)
+			{
+				if (_head + alignedSize <= _capacity)
+				{
+					offset = _head;
+					break;
+				}
+				if (alignedSize < tail)
+				{
+					offset = 0;
+					break;
+				}
+			}
+			else if (_head + alignedSize < tail)
+			{
+				offset = _head;
+				break;
+			}
+
+			// 空间不够，提交当前批次并等待最早的上传完成
+			const UploadToken token = _allocations.front().token;
+			if (token > _submittedToken)
+				_flush();
+			_fence->wait(token);
+		}
+
+		_head = offset + alignedSize;
+		_allocations.push_back({ offset, alignedSize, _submittedToken + 1 });
+		return { _buffer, offset };
+	}
+
+	void UploadRing::_retire()
+	{
+		const UploadToken completed = _fence->getCompletedValue();
+		while (!_allocations.empty() && _allocations.front().token <= completed)
+			_allocations.pop_front();
+		// 还没有被主队列获取的批次保留屏障
+		while (!_inFlight.empty() && _inFlight.front().token <= completed &&
+			(_inFlight.front().acquired || (_inFlight.front().textureTransfers.empty() && _inFlight.front().bufferTransfers.empty())))
+			_inFlight.pop_front();
+	}
+
+	CommandList& UploadRing::_getCommandList()
+	{
+		if (!_recording.commandList)
+		{
+			_recording.token = _submittedToken + 1;
+			_recording.commandList = _device->createCommandList(_queueType);
+			_recording.commandList->begin();
+		}
+		return *_recording.commandList;
+	}
+
+	UploadToken UploadRing::_flush()
+	{
+		if (!_recording.commandList)
+			return _submittedToken;
+
+		if (!_recording.textureTransfers.empty() || !_recording.bufferTransfers.empty())
+		{
+			_recording.commandList->resourceBarriers(_recording.textureTransfers, _recording.bufferTransfers);
+		}
+		_recording.commandList->end();
+		_device->getCommandQueue(_queueType)->submit
+		({
+			.commandLists = { _recording.commandList },
+			.signals = { { _fence, _recording.token } }
+		});
+		_submittedToken = _recording.token;
+		_inFlight.push_back(std::move(_recording));
+		_recording = {};
+		return _submittedToken;
+	}
+
+	void UploadRing::_acquire(UploadToken token, bool gpuWait)
+	{
+		SubmitDesc submitDesc;
+		if (gpuWait && token > _acquiredToken && !isComplete(token))
+		{
+			submitDesc.waits.push_back({ _fence, token });
+		}
+		_acquiredToken = std::max(_acquiredToken, token);
+
+		std::vector<TextureBarrierDesc> textureBarriers;
+		std::vector<BufferBarrierDesc> bufferBarriers;
+		for (auto& batch : _inFlight)
+		{
+			if (batch.token > token || batch.acquired) continue;
+			textureBarriers.insert(textureBarriers.end(), batch.textureTransfers.begin(), batch.textureTransfers.end());
+			bufferBarriers.insert(bufferBarriers.end(), batch.bufferTransfers.begin(), batch.bufferTransfers.end());
+			batch.acquired = true;
+		}
+		if (!textureBarriers.empty() || !bufferBarriers.empty())
+		{
+			auto commandList = _device->createCommandList(CommandListType::General);
+			commandList->begin();
+			commandList->resourceBarriers(textureBarriers, bufferBarriers);
+			commandList->end();
+			submitDesc.commandLists.push_back(commandList);
+		}
+
+		if (!submitDesc.waits.empty() || !submitDesc.commandLists.empty())
+		{
+			_device->getCommandQueue(CommandListType::General)->submit(submitDesc);
+		}
+	}
+}
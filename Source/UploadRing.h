@@ -0,0 +1,83 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include "RHI/Device.h"
+
+namespace kdGfx
+{
+	// 上传完成的标记，fence到达这个值时上传完成
+	using UploadToken = uint64_t;
+
+	// 持久映射的环形上传缓冲，多次上传记录到同一个命令列表，flush时一次提交
+	// 环形空间在fence到达对应值之后才回收，超过容量的上传单独创建临时缓冲
+	// vulkan有独立传输队列时在传输队列复制，主队列acquire时获取所有权，渲染不用等待复制
+	class UploadRing final
+	{
+	public:
+		static void initSingleton(BackendType backend, const std::shared_ptr<Device>& device, size_t capacity = 64ull << 20);
+		static void destroySingleton();
+		static UploadRing& singleton();
+
+		// 数据立即拷贝到环形缓冲，复制命令在flush后执行
+		// state是主队列获取后的状态，Undefined时按buffer用途推导，顶点和索引是VertexIndex，间接绘制是Indirect
+		UploadToken uploadBuffer(const std::shared_ptr<Buffer>& buffer, const void* data, size_t size, size_t dstOffset = 0,
+			BufferState state = BufferState::Undefined);
+		// vulkan最后切换到ShaderRead
+		UploadToken uploadTexture(const std::shared_ptr<Texture>& texture, const void* data, size_t size);
+		// 提交当前批次，返回最后一次提交的标记
+		UploadToken flush();
+		bool isComplete(UploadToken token);
+		// CPU等待，之后主队列获取所有权
+		void wait(UploadToken token);
+		// 主队列之后的命令等待上传完成并获取所有权，不阻塞CPU
+		void acquire(UploadToken token);
+
+		inline const std::shared_ptr<Fence>& getFence() const { return _fence; }
+
+	private:
+		struct Allocation
+		{
+			size_t offset = 0;
+			size_t size = 0;
+			UploadToken token = 0;
+		};
+		struct Batch
+		{
+			UploadToken token = 0;
+			std::shared_ptr<CommandList> commandList;
+			// 超过容量的临时缓冲
+			std::vector<std::shared_ptr<Buffer>> buffers;
+			// 传输队列释放、主队列获取的屏障，两侧相同
+			std::vector<TextureBarrierDesc> textureTransfers;
+			std::vector<BufferBarrierDesc> bufferTransfers;
+			bool acquired = false;
+		};
+
+		BackendType _backend = BackendType::Vulkan;
+		std::shared_ptr<Device> _device;
+		CommandListType _queueType = CommandListType::General;
+		bool _ownershipTransfer = false;
+		std::shared_ptr<Buffer> _buffer;
+		uint8_t* _mappedPtr = nullptr;
+		size_t _capacity = 0;
+		size_t _head = 0;
+		std::deque<Allocation> _allocations;
+		std::shared_ptr<Fence> _fence;
+		UploadToken _submittedToken = 0;
+		// 主队列已经等待过的值
+		UploadToken _acquiredToken = 0;
+		Batch _recording;
+		std::deque<Batch> _inFlight;
+		std::mutex _mutex;
+
+		// 返回数据所在的缓冲和偏移
+		std::tuple<std::shared_ptr<Buffer>, size_t> _allocate(size_t size);
+		void _retire();
+		CommandList& _getCommandList();
+		UploadToken _flush();
+		void _acquire(UploadToken token, bool gpuWait);
+		static constexpr size_t _alignment = 512;
+	};
+}
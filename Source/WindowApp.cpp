@@ -1,5 +1,7 @@
 #include "WindowApp.h"
 #include "StagingBuffer.h"
+#include "UploadRing.h"
+#include "AsyncReadback.h"
 #include "ImageProcessor.h"
 #include "MipMapsGen.h"
 #include "ImGuiRenderer.h"
@@ -19,6 +21,11 @@
 #include <imgui/imgui_impl_glfw.h>
 #include <imnodes/imnodes.h>
 #include <stb_image.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 namespace kdGfx
 {
@@ -27,7 +34,10 @@ namespace kdGfx
 	WindowApp::~WindowApp()
 	{
 		_swapchain.reset();
-		glfwDestroyWindow(gWindow);
+		if (_frameOutputFile && _frameOutputFile != stdout)
+			fclose(_frameOutputFile);
+		if (gWindow)
+			glfwDestroyWindow(gWindow);
 	}
 	
 	bool WindowApp::init(const WindowAppDesc& desc)
@@ -39,23 +49,54 @@ namespace kdGfx
 		spdlog::info("use GPU: {}", _adapter->getName());
 		_device = _adapter->createDevice();
 		_desc.backend = _instance->getBackendType();
+		if (!_desc.pipelineCacheFile.empty())
+			_device->loadPipelineCache(_desc.pipelineCacheFile);
 
-		if (!glfwInit())
+		if (_desc.headless)
 		{
-			RuntimeError("failed init glfw");
+			if (_desc.format == Format::Undefined)
+				_desc.format = Format::RGBA8Unorm;
+			// 延迟回收的组件只等待MaxFrameLatency帧，更多的帧同时执行会复用GPU还在使用的资源
+			_frameCount = std::clamp(_desc.framesInFlight, 1u, MaxFrameLatency);
+			if (_frameCount != _desc.framesInFlight)
+				spdlog::warn("frames in flight {} clamped to {}", _desc.framesInFlight, _frameCount);
+			if (_desc.frameOutput == "-")
+			{
+				// 帧数据占用标准输出，日志改到标准错误
+				spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+#if defined(_WIN32)
+				_setmode(_fileno(stdout), _O_BINARY);
+#endif
+				_frameOutputFile = stdout;
+			}
+			else if (!_desc.frameOutput.empty() && _desc.frameOutput.find("{}") == std::string::npos)
+			{
+				_frameOutputFile = fopen(_desc.frameOutput.c_str(), "wb");
+				if (_frameOutputFile == nullptr)
+				{
+					RuntimeError(fmt::format("failed to open frame output {}", _desc.frameOutput));
+				}
+			}
 		}
-		float yScale = 1.0f;
-		glfwGetMonitorContentScale(glfwGetPrimaryMonitor(), &_dpiScale, &yScale);
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-		gWindow = glfwCreateWindow(_desc.width * _dpiScale, _desc.height * _dpiScale, _desc.title.data(), nullptr, nullptr);
-		if (gWindow == nullptr)
+		else
 		{
-			RuntimeError("failed to create window");
+			if (!glfwInit())
+			{
+				RuntimeError("failed init glfw");
+			}
+			float yScale = 1.0f;
+			glfwGetMonitorContentScale(glfwGetPrimaryMonitor(), &_dpiScale, &yScale);
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+			gWindow = glfwCreateWindow(_desc.width * _dpiScale, _desc.height * _dpiScale, _desc.title.data(), nullptr, nullptr);
+			if (gWindow == nullptr)
+			{
+				RuntimeError("failed to create window");
+			}
+			int width, height;
+			glfwGetFramebufferSize(gWindow, &width, &height);
+			_desc.width = (uint32_t)width;
+			_desc.height = (uint32_t)height;
 		}
-		int width, height;
-		glfwGetFramebufferSize(gWindow, &width, &height);
-		_desc.width = (uint32_t)width;
-		_desc.height = (uint32_t)height;
 
 		_commandQueue = _device->getCommandQueue(CommandListType::General);
 
@@ -68,12 +109,23 @@ namespace kdGfx
 		
 		StagingBuffer::initUploadGlobal(_desc.backend, _device);
 		StagingBuffer::initReadbackGlobal(_desc.backend, _device);
+		UploadRing::initSingleton(_desc.backend, _device);
+		AsyncReadback::initSingleton(_desc.backend, _device);
 		ImageProcessor::initSingleton(_desc.backend, _device);
 		MipMapsGen::initSingleton(_desc.backend, _device);
 
-		_commandList = _device->createCommandList(CommandListType::General);
-
-		_reCreateSwapchain();
+		if (_desc.headless)
+		{
+			for (uint32_t i = 0; i < _frameCount; i++)
+				_frameCommandLists.push_back(_device->createCommandList(CommandListType::General));
+			_frameFenceValues.resize(_frameCount, 0);
+			_createOffscreenTargets();
+		}
+		else
+		{
+			_commandList = _device->createCommandList(CommandListType::General);
+			_reCreateSwapchain();
+		}
 
 		_initImGui();
 
@@ -84,6 +136,42 @@ namespace kdGfx
 	{
 		onSetup();
 
+		if (_desc.headless)
+			_headlessLoop();
+		else
+			_windowLoop();
+		_commandQueue->waitIdle();
+		AsyncReadback::singleton().poll();
+		if (_frameOutputFile)
+			fflush(_frameOutputFile);
+
+		if (!_desc.pipelineCacheFile.empty() && _device->savePipelineCache(_desc.pipelineCacheFile))
+		{
+			PipelineCacheStats stats = _device->getPipelineCacheStats();
+			spdlog::info("pipeline cache hits {}/{}, shader module hits {}/{}, pipeline layout hits {}/{}, creation time {:.1f}ms",
+				stats.pipelineHits, stats.pipelines, stats.shaderModuleHits, stats.shaderModules,
+				stats.pipelineLayoutHits, stats.pipelineLayouts, stats.pipelineCreationTime / 1e6);
+		}
+
+		onDestroy();
+		_destroyImGui();
+		ImageProcessor::destroySingleton();
+		MipMapsGen::destroySingleton();
+		StagingBuffer::destroyReadbackGlobal();
+		StagingBuffer::destroyUploadGlobal();
+		UploadRing::destroySingleton();
+		AsyncReadback::destroySingleton();
+	}
+
+	void WindowApp::requestExit()
+	{
+		_exitRequested = true;
+		if (gWindow)
+			glfwSetWindowShouldClose(gWindow, GLFW_TRUE);
+	}
+
+	void WindowApp::_windowLoop()
+	{
 		auto lastTime = std::chrono::steady_clock::now();
 
 		while (!glfwWindowShouldClose(gWindow))
@@ -104,9 +192,12 @@ namespace kdGfx
 
 			// 等待上一帧命令和呈现完成
 			_fence->wait(_fenceValue);
+			_device->beginFrame();
+			// 交付已经完成的回读
+			AsyncReadback::singleton().poll();
 
 			// ImGui计算和gpu不异步，更方便修改gpu资源
-			_renderImGui();
+			_renderImGui(deltaTime);
 
 			// 窗口大小变化重建交换链
 			if (_desc.width != _lastWidth || _desc.height != _lastHeight)
@@ -135,37 +226,73 @@ namespace kdGfx
 			_commandList->endLabel();
 			_commandList->resourceBarrier({ backBuffer, TextureState::ColorAttachment, TextureState::Present });
 			_commandList->end();
-			_commandQueue->submit({ _commandList });
-			_commandQueue->signal(_fence, ++_fenceValue);
+			_commandQueue->submit({ .commandLists = { _commandList }, .signals = { { _fence, ++_fenceValue } } });
+			AsyncReadback::singleton().commit(_fence, _fenceValue);
 			
 			_swapchain->present(_fence, _fenceValue, _fenceValue + 1);
 			_fenceValue += 1;
 
 			_frameTotalCount++;
 		}
-		_commandQueue->waitIdle();
+	}
 
-		onDestroy();
-		_destroyImGui();
-		ImageProcessor::destroySingleton();
-		MipMapsGen::destroySingleton();
-		StagingBuffer::destroyReadbackGlobal();
-		StagingBuffer::destroyUploadGlobal();
+	void WindowApp::_headlessLoop()
+	{
+		const bool readback = _frameOutputFile || !_desc.frameOutput.empty() || _desc.frameCallback;
+		const size_t frameSize = (size_t)_desc.width * _desc.height * GetBytesPerPixel(_desc.format);
+		auto lastTime = std::chrono::steady_clock::now();
+
+		while (!_exitRequested && (_desc.frameLimit == 0 || _frameTotalCount < _desc.frameLimit))
+		{
+			auto currentTime = std::chrono::steady_clock::now();
+			std::chrono::duration<float> deltaTimeDura = currentTime - lastTime;
+			lastTime = currentTime;
+			float deltaTime = deltaTimeDura.count();
+			onUpdate(deltaTime);
+
+			// 只等待上次使用这个目标的帧，其余的帧继续在GPU上执行
+			_frameIndex = _frameTotalCount % _frameCount;
+			_fence->wait(_frameFenceValues[_frameIndex]);
+			_device->beginFrame();
+			AsyncReadback::singleton().poll();
+
+			// 只运行onImGui里的逻辑，界面不画到输出的帧上
+			_renderImGui(deltaTime);
+
+			auto& commandList = _frameCommandLists[_frameIndex];
+			commandList->reset();
+			commandList->begin();
+			auto backBuffer = _backBuffers[_frameIndex];
+			commandList->resourceBarrier({ backBuffer, backBuffer->getState(), TextureState::ColorAttachment });
+			onRender(commandList);
+			if (readback)
+			{
+				const uint32_t frame = _frameTotalCount;
+				AsyncReadback::singleton().readbackTexture(*commandList, backBuffer, frameSize,
+					[this, frame](const void* data, size_t size) { _writeFrame(frame, data, size); });
+			}
+			commandList->end();
+			_commandQueue->submit({ .commandLists = { commandList }, .signals = { { _fence, ++_fenceValue } } });
+			AsyncReadback::singleton().commit(_fence, _fenceValue);
+			_frameFenceValues[_frameIndex] = _fenceValue;
+
+			_frameTotalCount++;
+		}
 	}
 
 	bool WindowApp::mouseButtonPress(int button)
 	{
-		return glfwGetMouseButton(gWindow, button) == GLFW_PRESS;
+		return gWindow && glfwGetMouseButton(gWindow, button) == GLFW_PRESS;
 	}
 
 	bool WindowApp::mouseButtonRelease(int button)
 	{
-		return glfwGetMouseButton(gWindow, button) == GLFW_RELEASE;
+		return !gWindow || glfwGetMouseButton(gWindow, button) == GLFW_RELEASE;
 	}
 
 	bool WindowApp::keyPress(int keycode)
 	{
-		return glfwGetKey(gWindow, keycode) == GLFW_PRESS;
+		return gWindow && glfwGetKey(gWindow, keycode) == GLFW_PRESS;
 	}
 
 	std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>>
@@ -192,7 +319,13 @@ namespace kdGfx
 	{
 		auto commandList = _device->createCommandList(CommandListType::General);
 		commandList->begin();
-		commandList->resourceBarrier({ texture, texture->getState(), state});
+		commandList->resourceBarrier
+		({
+			.texture = texture,
+			.oldState = texture->getState(),
+			.newState = state,
+			.subRange = { 0, texture->getDesc().mipLevels, 0, texture->getDesc().arrayLayers }
+		});
 		commandList->end();
 		auto queue = _device->getCommandQueue(CommandListType::General);
 		queue->submit({ commandList });
@@ -217,11 +350,13 @@ namespace kdGfx
 
 	void WindowApp::setWindowSize(uint32_t width, uint32_t height)
 	{
-		glfwSetWindowSize(gWindow, width, height);
+		if (gWindow)
+			glfwSetWindowSize(gWindow, width, height);
 	}
 
 	glm::vec2 WindowApp::getCursorPos()
 	{
+		if (!gWindow) return glm::vec2(0.0f);
 		double x, y;
 		glfwGetCursorPos(gWindow, &x, &y);
 		return glm::vec2(x, y);
@@ -256,11 +391,12 @@ namespace kdGfx
 		_frameCount = _swapchain->getFrameCount();
 		_desc.format = _swapchain->getFormat();
 
+		_backBuffers.resize(_frameCount);
 		_backBufferViews.resize(_frameCount);
 		for (uint32_t i = 0; i < _frameCount; i++)
 		{
-			auto texture = _swapchain->getBackBuffer(i);
-			_backBufferViews[i] = texture->createView({});
+			_backBuffers[i] = _swapchain->getBackBuffer(i);
+			_backBufferViews[i] = _backBuffers[i]->createView({});
 		}
 
 		_lastWidth = _desc.width;
@@ -270,6 +406,61 @@ namespace kdGfx
 		onResize();
 	}
 
+	void WindowApp::_createOffscreenTargets()
+	{
+		_backBuffers.resize(_frameCount);
+		_backBufferViews.resize(_frameCount);
+		for (uint32_t i = 0; i < _frameCount; i++)
+		{
+			_backBuffers[i] = _device->createTexture
+			({
+				.usage = _desc.usage | TextureUsage::CopySrc,
+				.format = _desc.format,
+				.width = _desc.width,
+				.height = _desc.height,
+				.name = fmt::format("Offscreen Target {}", i)
+			});
+			_backBufferViews[i] = _backBuffers[i]->createView({});
+		}
+
+		_lastWidth = _desc.width;
+		_lastHeight = _desc.height;
+		_imGuiResourceValid = false;
+
+		onResize();
+	}
+
+	void WindowApp::_writeFrame(uint32_t frame, const void* data, size_t size)
+	{
+		if (_desc.frameCallback)
+			_desc.frameCallback(frame, data, size);
+
+		if (_frameOutputFile)
+		{
+			fwrite(data, 1, size, _frameOutputFile);
+		}
+		else if (!_desc.frameOutput.empty())
+		{
+			std::string fileName;
+			try
+			{
+				fileName = fmt::vformat(_desc.frameOutput, fmt::make_format_args(frame));
+			}
+			catch (const fmt::format_error& e)
+			{
+				spdlog::error("invalid frame output {}: {}", _desc.frameOutput, e.what());
+				return;
+			}
+			std::ofstream file(fileName, std::ios::binary);
+			if (!file)
+			{
+				spdlog::error("failed to write frame {}", fileName);
+				return;
+			}
+			file.write(static_cast<const char*>(data), size);
+		}
+	}
+
 	void WindowApp::_initImGui()
 	{
 		IMGUI_CHECKVERSION();
@@ -286,13 +477,16 @@ namespace kdGfx
 		io.Fonts->AddFontFromFileTTF("c:/Windows/Fonts/segoeui.ttf", 16.0f * _dpiScale);
 #endif // _WIN32
 
-		ImGui_ImplGlfw_InitForOther(gWindow, true);
+		if (gWindow)
+			ImGui_ImplGlfw_InitForOther(gWindow, true);
+		else
+			io.DisplaySize = ImVec2((float)_desc.width, (float)_desc.height);
 
 		_imGuiRenderer = new ImGuiRenderer();
 		_imGuiRenderer->init({ _desc.backend, _device, _desc.format, _frameCount });
 	}
 
-	void WindowApp::_renderImGui()
+	void WindowApp::_renderImGui(float deltaTime)
 	{
 		if (!_imGuiResourceValid)
 		{
@@ -303,7 +497,10 @@ namespace kdGfx
 		
 		_imGuiRenderer->newFrame();
 
-		ImGui_ImplGlfw_NewFrame();
+		if (gWindow)
+			ImGui_ImplGlfw_NewFrame();
+		else
+			ImGui::GetIO().DeltaTime = std::max(deltaTime, 1e-6f);
 		ImGui::NewFrame();
 		onImGui();
 		ImGui::Render();
@@ -312,7 +509,8 @@ namespace kdGfx
 	void WindowApp::_destroyImGui()
 	{
 		_imGuiRenderer->shutdown();
-		ImGui_ImplGlfw_Shutdown();
+		if (gWindow)
+			ImGui_ImplGlfw_Shutdown();
 		ImNodes::DestroyContext();
 		ImGui::DestroyContext();
 
@@ -41,6 +41,19 @@ namespace kdGfx
         Format format = Format::Undefined;
         TextureUsage usage = TextureUsage::ColorAttachment;
         bool vsync = false;
+        // 管线缓存文件，为空时不加载和保存，例如设置成"pipeline.cache"
+        std::string pipelineCacheFile;
+        // 无窗口模式，不创建窗口和交换链，渲染到离屏目标的环上
+        bool headless = false;
+        // 无窗口模式渲染的帧数，0不限制，直到调用requestExit
+        uint32_t frameLimit = 0;
+        // 无窗口模式离屏目标的个数，也是同时在GPU上的帧数，限制在1到MaxFrameLatency。默认每帧等待上一帧完成
+        // 大于1时onRender每帧写入的host可见资源需要按帧区分，否则会覆盖GPU还在使用的数据
+        uint32_t framesInFlight = 1;
+        // 无窗口模式的帧输出，"-"写到标准输出，包含{}时按帧号每帧一个文件，否则所有帧依次写到同一个文件
+        std::string frameOutput;
+        // 无窗口模式完成的帧，data在回调返回后失效
+        std::function<void(uint32_t frame, const void* data, size_t size)> frameCallback;
 
         void parseArgs(int argc, char* argv[])
         {
@@ -57,6 +70,14 @@ namespace kdGfx
                     width = std::stoi(argv[++i]);
                 else if (arg == "--height")
                     height = std::stoi(argv[++i]);
+                else if (arg == "--headless")
+                    headless = true;
+                else if (arg == "--frames")
+                    frameLimit = std::stoi(argv[++i]);
+                else if (arg == "--output")
+                    frameOutput = argv[++i];
+                else if (arg == "--frames-in-flight")
+                    framesInFlight = std::stoi(argv[++i]);
             }
         }
     };
@@ -70,6 +91,8 @@ namespace kdGfx
 
         bool init(const WindowAppDesc& desc);
         void mainLoop();
+        // 当前帧结束后退出主循环
+        void requestExit();
         // 窗口函数
 		void setWindowSize(uint32_t width, uint32_t height);
         glm::vec2 getCursorPos();
@@ -91,15 +114,20 @@ namespace kdGfx
         inline uint32_t getWidth() { return _desc.width; }
         inline uint32_t getHeight() { return _desc.height; }
         inline float getDpiScale() { return _dpiScale; }
+        inline bool isHeadless() { return _desc.headless; }
         std::tuple<std::shared_ptr<Texture>, std::shared_ptr<TextureView>> getBackBuffer(uint32_t index)
         {
-            return std::make_tuple(_swapchain->getBackBuffer(index), _backBufferViews.at(index));
+            return std::make_tuple(_backBuffers.at(index), _backBufferViews.at(index));
         }
         
     private:
+        void _windowLoop();
+        void _headlessLoop();
         void _reCreateSwapchain();
+        void _createOffscreenTargets();
+        void _writeFrame(uint32_t frame, const void* data, size_t size);
         void _initImGui();
-		void _renderImGui();
+		void _renderImGui(float deltaTime);
         void _destroyImGui();
 
     protected:
@@ -118,12 +146,19 @@ namespace kdGfx
         uint32_t _frameCount = 2;
         uint32_t _frameIndex = 0;
         std::shared_ptr<Swapchain> _swapchain;
+        // 无窗口模式下是离屏目标
+        std::vector<std::shared_ptr<Texture>> _backBuffers;
         std::vector<std::shared_ptr<TextureView>> _backBufferViews;
         
     private:
         uint64_t _fenceValue = 1;
         std::shared_ptr<Fence> _fence;
         std::shared_ptr<CommandList> _commandList;
+        // 无窗口模式每个离屏目标一个命令列表
+        std::vector<std::shared_ptr<CommandList>> _frameCommandLists;
+        std::vector<uint64_t> _frameFenceValues;
+        std::FILE* _frameOutputFile = nullptr;
+        bool _exitRequested = false;
         uint32_t _lastWidth = 0;
         uint32_t _lastHeight = 0;
         ImGuiRenderer* _imGuiRenderer = nullptr;